@@ -0,0 +1,133 @@
+#ifndef __BENCH_UTILS_HPP__
+#define __BENCH_UTILS_HPP__
+
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <malloc.h>
+#include <unistd.h>
+
+#include "file_system_emulator.hpp"
+
+/**
+ * @brief Returns the current resident set size of the process in kilobytes.
+ */
+inline long
+rss_kb()
+{
+  long pages__ = 0;
+  long resident__ = 0;
+
+  std::ifstream{ "/proc/self/statm" } >> pages__ >> resident__;
+  return resident__ * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/**
+ * @brief Returns memory freed by earlier benchmarks to the system and the resident set size after it in kilobytes,
+ * so that the growth of the resident set counts memory of the measured operations rather than reuse of freed one.
+ */
+inline long
+trimmed_rss_kb()
+{
+  malloc_trim(0);
+  return rss_kb();
+}
+
+/**
+ * @brief Measures wall-clock time and growth of the resident set since construction.
+ */
+class Stopwatch
+{
+public:
+  Stopwatch() : m_start_rss_kb(trimmed_rss_kb()), m_start(std::chrono::steady_clock::now()){};
+
+  /**
+   * @brief Returns the number of nanoseconds elapsed since construction.
+   */
+  double
+  elapsed_ns() const noexcept
+  {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - m_start).count();
+  }
+
+  /**
+   * @brief Returns the growth of the resident set since construction in kilobytes, negative if memory was given
+   * back to the system. Memory freed and reused in between doesn't count, nor does memory freed but kept by malloc.
+   */
+  long
+  rss_growth_kb() const
+  {
+    return rss_kb() - m_start_rss_kb;
+  }
+
+private:
+  long m_start_rss_kb;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+/**
+ * @brief Prints a single result line of a benchmark.
+ *
+ * @param name The name of the measured operation.
+ * @param nodes The size of the tree the operation was measured on.
+ * @param ops The number of operations measured.
+ * @param total_ns The total time of all operations.
+ * @param rss_growth_kb The growth of the resident set over all operations, see Stopwatch::rss_growth_kb().
+ */
+inline void
+report(const char* name, std::size_t nodes, std::size_t ops, double total_ns, long rss_growth_kb)
+{
+  std::printf("%-24s nodes=%-10zu ops=%-10zu %12.1f ns/op   rss=%+ld KiB\n", name, nodes, ops, total_ns / ops,
+              rss_growth_kb);
+}
+
+/**
+ * @brief Populates a balanced synthetic tree under the given directory. Every directory gets up to %fanout
+ * children, every other child being a file.
+ *
+ * @param fse The emulator to populate.
+ * @param root The absolute path of an existing directory the tree is built in.
+ * @param nodes The number of nodes to create.
+ * @param fanout The number of children of every directory.
+ * @param files If not null, receives absolute paths of the created files.
+ * @return The number of created nodes.
+ */
+inline std::size_t
+build_tree(File_system_emulator& fse, const std::string& root, std::size_t nodes, std::size_t fanout,
+           std::vector<std::string>* files = nullptr)
+{
+  std::deque<std::string> dirs__{ root };
+  std::size_t created__ = 0;
+
+  while(created__ < nodes && !dirs__.empty())
+    {
+      std::string parent__ = std::move(dirs__.front());
+      dirs__.pop_front();
+
+      for(std::size_t i = 0; i < fanout && created__ < nodes; ++i, ++created__)
+        {
+          std::string path__ = parent__ + '\\' + (i % 2 ? "f" : "d") + std::to_string(i);
+
+          if(i % 2)
+            {
+              fse.make_file(path__ + ".txt");
+
+              if(files)
+                files->push_back(path__ + ".txt");
+            }
+          else
+            {
+              fse.make_dir(path__);
+              dirs__.push_back(std::move(path__));
+            }
+        }
+    }
+
+  return created__;
+}
+
+#endif
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_utils.hpp"
+
+/**
+ * @brief Measures lookups of %readers threads in published views while one writer keeps mutating the tree and
+ * publishes a new view after every %publish_every mutations. Reported time per lookup is wall-clock time divided
+ * by lookups of all readers, so it goes down as reads scale with threads.
+ */
+static void
+bench_readers(File_system_emulator& fse, const std::vector<std::string>& files, std::size_t nodes, std::size_t readers,
+              std::size_t publish_every, double duration_ns)
+{
+  std::atomic<bool> done__{ false };
+  std::atomic<std::size_t> lookups__{ 0 };
+  std::vector<std::thread> threads__;
+
+  for(std::size_t r = 0; r < readers; ++r)
+    threads__.emplace_back([&fse, &files, &done__, &lookups__, r]() {
+      std::shared_ptr<const Tree_view> view__ = fse.view();
+      std::uint64_t state__ = 0x9E3779B97F4A7C15ull * (r + 1);
+      std::size_t lookups_count__ = 0;
+      std::size_t found__ = 0;
+
+      while(!done__.load(std::memory_order_relaxed))
+        {
+          fse.refresh_view(view__);
+
+          for(std::size_t i = 0; i < 256; ++i)
+            {
+              state__ ^= state__ << 13;
+              state__ ^= state__ >> 7;
+              state__ ^= state__ << 17;
+
+              found__ += view__->find(files[state__ % files.size()]) != nullptr;
+            }
+
+          lookups_count__ += 256;
+        }
+
+      if(found__ != lookups_count__)
+        std::printf("lost lookups: %zu\n", lookups_count__ - found__);
+
+      lookups__ += lookups_count__;
+    });
+
+  Stopwatch stopwatch__;
+  std::size_t mutations__ = 0;
+
+  while(stopwatch__.elapsed_ns() < duration_ns)
+    {
+      fse.make_file("C:\\Tree\\scratch.txt");
+      fse.remove_file("C:\\Tree\\scratch.txt");
+      mutations__ += 2;
+
+      if(mutations__ % publish_every == 0)
+        fse.publish_view();
+    }
+
+  done__.store(true, std::memory_order_relaxed);
+
+  for(std::thread& thread__ : threads__)
+    thread__.join();
+
+  double elapsed__ = stopwatch__.elapsed_ns();
+  long rss_growth_kb__ = stopwatch__.rss_growth_kb();
+
+  std::string name__ = "view lookup readers=" + std::to_string(readers);
+  report(name__.c_str(), nodes, lookups__.load(), elapsed__, rss_growth_kb__);
+  std::printf("%-24s %.0f reads/s\n", "", lookups__.load() / (elapsed__ * 1e-9));
+
+  name__ = "writer readers=" + std::to_string(readers);
+  report(name__.c_str(), nodes, mutations__, elapsed__, rss_growth_kb__);
+}
+
+/**
+ * Stress test of concurrent readers: lookups in published views from a growing number of threads while the tree
+ * is mutated, and the cost of publishing a view.
+ *
+ * Usage: concurrent_readers [nodes] [milliseconds] [readers], by default a tree of 100k nodes is read for 1000 ms
+ * per run by 1, 2, 4 and 8 readers.
+ */
+int
+main(int argc, char const* argv[])
+{
+  std::size_t nodes__ = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100'000;
+  double duration_ns__ = (argc > 2 ? std::strtod(argv[2], nullptr) : 1000.0) * 1e6;
+
+  File_system_emulator fse__;
+  std::vector<std::string> files__;
+
+  fse__.make_dir("C:\\Tree");
+  std::size_t created__ = build_tree(fse__, "C:\\Tree", nodes__, 16, &files__);
+
+  Stopwatch stopwatch__;
+  fse__.publish_view();
+  report("publish first view", created__, 1, stopwatch__.elapsed_ns(), stopwatch__.rss_growth_kb());
+
+  // Later views list again only the changed directory and its ancestors, the rest is shared.
+  constexpr std::size_t PUBLISHES = 1000;
+  Stopwatch changed__;
+
+  for(std::size_t i = 0; i < PUBLISHES; ++i)
+    {
+      fse__.make_file("C:\\Tree\\scratch.txt");
+      fse__.remove_file("C:\\Tree\\scratch.txt");
+      fse__.make_file(files__[i % files__.size()] + "." + std::to_string(i));
+      fse__.publish_view();
+    }
+
+  report("publish after a change", created__, PUBLISHES, changed__.elapsed_ns(), changed__.rss_growth_kb());
+
+  std::size_t cores__ = std::max(std::thread::hardware_concurrency(), 1u);
+  std::size_t max_readers__ = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 8;
+  max_readers__ = std::max<std::size_t>(max_readers__, 1);
+
+  if(max_readers__ > cores__)
+    std::printf("readers above %zu hardware threads share cores with the writer, their runs don't show read "
+                "scaling\n",
+                cores__);
+
+  for(std::size_t readers__ = 1; readers__ <= max_readers__; readers__ *= 2)
+    bench_readers(fse__, files__, created__, readers__, 4096, duration_ns__);
+
+  return 0;
+}
@@ -0,0 +1,398 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_utils.hpp"
+
+/**
+ * @brief Stream buffer that drops everything written to it, used to measure print() without a terminal.
+ */
+class Null_buffer : public std::streambuf
+{
+protected:
+  int_type
+  overflow(int_type ch) override
+  {
+    return traits_type::not_eof(ch);
+  }
+
+  std::streamsize
+  xsputn(const char*, std::streamsize count) override
+  {
+    return count;
+  }
+};
+
+/**
+ * @brief Measures make_dir and make_file while a tree of %nodes nodes is populated.
+ */
+static void
+bench_make(std::size_t nodes)
+{
+  File_system_emulator fse__;
+  fse__.make_dir("C:\\Tree");
+
+  Stopwatch stopwatch__;
+  std::size_t created__ = build_tree(fse__, "C:\\Tree", nodes, 16);
+
+  report("make_dir/make_file", created__, created__, stopwatch__.elapsed_ns(), stopwatch__.rss_growth_kb());
+}
+
+/**
+ * @brief Measures path resolution through change_dir on a path of the given depth, every level of which has
+ * %fanout siblings. Lookups are measured with and without the path cache.
+ */
+static void
+bench_lookup(std::size_t depth, std::size_t fanout)
+{
+  for(bool is_cached__ : { false, true })
+    {
+      File_system_emulator fse__;
+      std::string path__ = "C:";
+
+      if(!is_cached__)
+        fse__.set_path_cache_capacity(0);
+
+      for(std::size_t level__ = 0; level__ < depth; ++level__)
+        {
+          for(std::size_t i = 1; i < fanout; ++i)
+            fse__.make_dir(path__ + "\\s" + std::to_string(i));
+
+          path__ += "\\d" + std::to_string(level__ % 1000);
+          fse__.make_dir(path__);
+        }
+
+      std::size_t ops__ = 100'000;
+      Stopwatch stopwatch__;
+
+      for(std::size_t i = 0; i < ops__; ++i)
+        fse__.change_dir(path__);
+
+      std::string name__ = std::string(is_cached__ ? "lookup cached" : "lookup") + " d=" + std::to_string(depth)
+                           + " f=" + std::to_string(fanout);
+      report(name__.c_str(), depth * fanout, ops__, stopwatch__.elapsed_ns(), stopwatch__.rss_growth_kb());
+    }
+}
+
+/**
+ * @brief Measures creation of hard and dynamic links to every file of a populated tree, all links are placed
+ * into a single directory.
+ */
+static void
+bench_links(std::size_t nodes)
+{
+  File_system_emulator fse__;
+  fse__.make_dir("C:\\Tree");
+  fse__.make_dir("C:\\Links");
+
+  std::vector<std::string> targets__;
+  build_tree(fse__, "C:\\Tree", nodes, 16, &targets__);
+
+  std::size_t ops__ = 0;
+  Stopwatch stopwatch__;
+
+  for(const auto& target__ : targets__)
+    {
+      fse__.make_hlink(target__, "C:\\Links");
+      fse__.make_dlink(target__, "C:\\Links");
+      ops__ += 2;
+    }
+
+  report("make_hlink/make_dlink", nodes, ops__, stopwatch__.elapsed_ns(), stopwatch__.rss_growth_kb());
+}
+
+/**
+ * @brief Measures copy, move, print and delete_tree of a subtree of %nodes nodes. Each is reported per node of
+ * the subtree.
+ */
+static void
+bench_subtree(std::size_t nodes)
+{
+  File_system_emulator fse__;
+  fse__.make_dir("C:\\Tree");
+  fse__.make_dir("C:\\Copy");
+  fse__.make_dir("C:\\Moved");
+
+  std::size_t created__ = build_tree(fse__, "C:\\Tree", nodes, 16) + 1;
+
+  {
+    Stopwatch stopwatch__;
+    fse__.copy("C:\\Tree", "C:\\Copy");
+    report("copy per node", created__, created__, stopwatch__.elapsed_ns(), stopwatch__.rss_growth_kb());
+  }
+
+  {
+    Stopwatch stopwatch__;
+    fse__.move("C:\\Copy\\Tree", "C:\\Moved");
+    report("move", created__, 1, stopwatch__.elapsed_ns(), stopwatch__.rss_growth_kb());
+  }
+
+  {
+    Null_buffer null_buffer__;
+    std::streambuf* cout_buffer__ = std::cout.rdbuf(&null_buffer__);
+
+    Stopwatch stopwatch__;
+    fse__.print();
+    double elapsed__ = stopwatch__.elapsed_ns();
+    long rss_growth_kb__ = stopwatch__.rss_growth_kb();
+
+    std::cout.rdbuf(cout_buffer__);
+    report("print per node", 2 * created__, 2 * created__, elapsed__, rss_growth_kb__);
+  }
+
+  {
+    Stopwatch stopwatch__;
+    fse__.delete_tree("C:\\Moved\\Tree");
+    report("delete_tree per node", created__, created__, stopwatch__.elapsed_ns(), stopwatch__.rss_growth_kb());
+  }
+}
+
+/**
+ * @brief Measures copy of a subtree of %nodes nodes by 1, 2, 4... threads up to the number of hardware threads,
+ * reported per node.
+ */
+static void
+bench_parallel_copy(std::size_t nodes)
+{
+  File_system_emulator fse__;
+  fse__.make_dir("C:\\Tree");
+  fse__.make_dir("C:\\Copy");
+
+  std::size_t created__ = build_tree(fse__, "C:\\Tree", nodes, 16) + 1;
+  std::size_t max_threads__ = std::max(1u, std::thread::hardware_concurrency());
+
+  for(std::size_t threads__ = 1; threads__ <= max_threads__; threads__ *= 2)
+    {
+      fse__.set_parallel_copy(threads__ > 1 ? 1 : 0, threads__);
+
+      Stopwatch stopwatch__;
+      fse__.copy("C:\\Tree", "C:\\Copy");
+
+      std::string name__ = "copy per node threads=" + std::to_string(threads__);
+      report(name__.c_str(), created__, created__, stopwatch__.elapsed_ns(), stopwatch__.rss_growth_kb());
+
+      fse__.delete_tree("C:\\Copy\\Tree");
+    }
+}
+
+/**
+ * @brief Measures 64 copy-on-write copies of a subtree of %nodes nodes with a file made in each of them, reported
+ * per copy together with the number of entities the emulator ends up with.
+ */
+static void
+bench_copy_on_write(std::size_t nodes)
+{
+  const std::size_t copies__ = 64;
+
+  File_system_emulator fse__;
+  fse__.set_copy_on_write(true);
+  fse__.make_dir("C:\\Tree");
+  build_tree(fse__, "C:\\Tree", nodes, 16);
+
+  Stopwatch stopwatch__;
+
+  for(std::size_t i = 0; i < copies__; ++i)
+    {
+      std::string copy__ = "C:\\Copy" + std::to_string(i);
+
+      fse__.make_dir(copy__);
+      fse__.copy("C:\\Tree", copy__);
+      fse__.make_file(copy__ + "\\Tree\\edit.txt");
+    }
+
+  report("copy_on_write per copy", fse__.size(), copies__, stopwatch__.elapsed_ns(), stopwatch__.rss_growth_kb());
+}
+
+/**
+ * @brief Measures removal of a file with %nodes dynamic links to it, once with the links deleted by the removal
+ * and once with the links left dangling, followed by compact(). Each is reported per link.
+ */
+static void
+bench_dlink_removal(std::size_t nodes)
+{
+  for(bool deferred__ : { false, true })
+    {
+      File_system_emulator fse__;
+      fse__.set_deferred_dlink_removal(deferred__);
+      fse__.make_file("C:\\target.txt");
+
+      for(std::size_t i = 0; i < nodes; ++i)
+        {
+          std::string dir__ = "C:\\Dir" + std::to_string(i);
+
+          fse__.make_dir(dir__);
+          fse__.make_dlink("C:\\target.txt", dir__);
+        }
+
+      {
+        Stopwatch stopwatch__;
+        fse__.remove_file("C:\\target.txt");
+        report(deferred__ ? "remove_file deferred per dlink" : "remove_file per dlink", nodes, nodes,
+               stopwatch__.elapsed_ns(), stopwatch__.rss_growth_kb());
+      }
+
+      if(deferred__)
+        {
+          Stopwatch stopwatch__;
+          fse__.compact();
+          report("compact per dlink", nodes, nodes, stopwatch__.elapsed_ns(), stopwatch__.rss_growth_kb());
+        }
+    }
+}
+
+/**
+ * @brief Measures make_file and remove_file of %nodes files of a single directory in shuffled order of names, so
+ * the cost per operation shows whether it grows with the width of the directory. The directory is printed after
+ * the files are made.
+ */
+static void
+bench_wide_directory(std::size_t nodes)
+{
+  File_system_emulator fse__;
+  fse__.make_dir("C:\\Wide");
+
+  std::vector<std::string> paths__;
+  std::mt19937 random__(nodes);
+
+  for(std::size_t i = 0; i < nodes; ++i)
+    paths__.push_back("C:\\Wide\\f" + std::to_string(i) + ".txt");
+
+  std::shuffle(paths__.begin(), paths__.end(), random__);
+
+  {
+    Stopwatch stopwatch__;
+
+    for(const auto& path__ : paths__)
+      fse__.make_file(path__);
+
+    report("make_file in wide dir", nodes, nodes, stopwatch__.elapsed_ns(), stopwatch__.rss_growth_kb());
+  }
+
+  {
+    Null_buffer null_buffer__;
+    std::streambuf* cout_buffer__ = std::cout.rdbuf(&null_buffer__);
+
+    Stopwatch stopwatch__;
+    fse__.print();
+    double elapsed__ = stopwatch__.elapsed_ns();
+    long rss_growth_kb__ = stopwatch__.rss_growth_kb();
+
+    std::cout.rdbuf(cout_buffer__);
+    report("print wide dir per node", nodes, nodes, elapsed__, rss_growth_kb__);
+  }
+
+  std::shuffle(paths__.begin(), paths__.end(), random__);
+
+  {
+    Stopwatch stopwatch__;
+
+    for(const auto& path__ : paths__)
+      fse__.remove_file(path__);
+
+    report("remove_file in wide dir", nodes, nodes, stopwatch__.elapsed_ns(), stopwatch__.rss_growth_kb());
+  }
+}
+
+/**
+ * @brief Measures rollback of a transaction: a single change in a tree of %nodes nodes, and delete_tree of the
+ * whole tree reported per node.
+ */
+static void
+bench_rollback(std::size_t nodes)
+{
+  File_system_emulator fse__;
+  fse__.make_dir("C:\\Tree");
+
+  std::size_t created__ = build_tree(fse__, "C:\\Tree", nodes, 16) + 1;
+
+  {
+    fse__.begin();
+    fse__.make_dir("C:\\Tree\\New");
+
+    Stopwatch stopwatch__;
+    fse__.rollback();
+    report("rollback of make_dir", created__, 1, stopwatch__.elapsed_ns(), stopwatch__.rss_growth_kb());
+  }
+
+  fse__.begin();
+
+  {
+    Stopwatch stopwatch__;
+    fse__.delete_tree("C:\\Tree");
+    report("delete_tree in txn", created__, created__, stopwatch__.elapsed_ns(), stopwatch__.rss_growth_kb());
+  }
+
+  {
+    Stopwatch stopwatch__;
+    fse__.rollback();
+    report("rollback per node", created__, created__, stopwatch__.elapsed_ns(), stopwatch__.rss_growth_kb());
+  }
+}
+
+/**
+ * @brief Measures save_snapshot and load_snapshot of a tree of %nodes nodes, reported per node.
+ */
+static void
+bench_snapshot(std::size_t nodes)
+{
+  std::string path__ = "bench_core_operations.fse";
+  File_system_emulator fse__;
+  fse__.make_dir("C:\\Tree");
+
+  std::size_t created__ = build_tree(fse__, "C:\\Tree", nodes, 16) + 2;
+
+  {
+    Stopwatch stopwatch__;
+    fse__.save_snapshot(path__);
+    report("save_snapshot per node", created__, created__, stopwatch__.elapsed_ns(), stopwatch__.rss_growth_kb());
+  }
+
+  {
+    File_system_emulator loaded__;
+
+    Stopwatch stopwatch__;
+    loaded__.load_snapshot(path__);
+    report("load_snapshot per node", created__, created__, stopwatch__.elapsed_ns(), stopwatch__.rss_growth_kb());
+  }
+
+  std::remove(path__.c_str());
+}
+
+/**
+ * Runs the benchmarks of core operations of the emulator on synthetic trees and reports ns/op and the growth of
+ * the resident set over the measured operations. Memory freed by earlier benchmarks is given back to the system
+ * before every measurement, what malloc keeps of it may still be reused without growing the resident set.
+ *
+ * Usage: core_operations [max_nodes], by default trees from 1k up to 1M nodes are measured, pass 10000000 to
+ * include a 10M-node tree.
+ */
+int
+main(int argc, char const* argv[])
+{
+  std::size_t max_nodes__ = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+
+  for(std::size_t depth__ : { 4, 16, 64, 256 })
+    for(std::size_t fanout__ : { 16, 1024 })
+      bench_lookup(depth__, fanout__);
+
+  for(std::size_t nodes__ = 1'000; nodes__ <= max_nodes__; nodes__ *= 10)
+    {
+      bench_make(nodes__);
+      bench_links(nodes__);
+      bench_subtree(nodes__);
+      bench_parallel_copy(nodes__);
+      bench_copy_on_write(nodes__);
+      bench_dlink_removal(nodes__);
+      bench_wide_directory(nodes__);
+      bench_rollback(nodes__);
+      bench_snapshot(nodes__);
+    }
+
+  return 0;
+}
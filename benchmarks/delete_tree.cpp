@@ -0,0 +1,29 @@
+#include <cstdlib>
+
+#include "bench_utils.hpp"
+
+/**
+ * Measures delete_tree on subtrees of growing size. The time per node has to stay flat as the subtree grows.
+ *
+ * Usage: delete_tree [max_nodes], by default subtrees from 1k up to 1M nodes are measured.
+ */
+int
+main(int argc, char const* argv[])
+{
+  std::size_t max_nodes__ = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+
+  for(std::size_t nodes__ = 1'000; nodes__ <= max_nodes__; nodes__ *= 10)
+    {
+      File_system_emulator fse__;
+
+      fse__.make_dir("C:\\Tree");
+      std::size_t created__ = build_tree(fse__, "C:\\Tree", nodes__, 16) + 1;
+
+      Stopwatch stopwatch__;
+      fse__.delete_tree("C:\\Tree");
+
+      report("delete_tree per node", created__, created__, stopwatch__.elapsed_ns(), stopwatch__.rss_growth_kb());
+    }
+
+  return 0;
+}
@@ -0,0 +1,51 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "bench_utils.hpp"
+
+/**
+ * @brief Measures building a tree of %nodes nodes with journaling off (group size 0) or with the given number of
+ * records committed per fsync.
+ */
+static void
+bench_journal(std::size_t nodes, std::size_t group_size)
+{
+  std::string path__ = "bench_journal.log";
+  std::remove(path__.c_str());
+
+  File_system_emulator fse__;
+  fse__.make_dir("C:\\Tree");
+
+  if(group_size != 0)
+    fse__.open_journal(path__, group_size);
+
+  Stopwatch stopwatch__;
+  std::size_t created__ = build_tree(fse__, "C:\\Tree", nodes, 16);
+  fse__.close_journal();
+
+  std::string name__ = group_size ? "journal group=" + std::to_string(group_size) : std::string("journal off");
+  report(name__.c_str(), created__, created__, stopwatch__.elapsed_ns(), stopwatch__.rss_growth_kb());
+
+  std::remove(path__.c_str());
+}
+
+/**
+ * Measures the overhead journaling adds to every mutation, with different numbers of records committed per fsync.
+ * Committing every record on its own is measured on a 100 times smaller tree, as it's bound by the disk.
+ *
+ * Usage: journal [nodes], by default trees of 100k nodes are built.
+ */
+int
+main(int argc, char const* argv[])
+{
+  std::size_t nodes__ = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100'000;
+
+  bench_journal(nodes__, 0);
+  bench_journal(nodes__ / 100, 1);
+
+  for(std::size_t group_size__ : { 64, 1024, 16384 })
+    bench_journal(nodes__, group_size__);
+
+  return 0;
+}
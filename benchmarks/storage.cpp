@@ -0,0 +1,47 @@
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+#include "bench_utils.hpp"
+
+/**
+ * Measures the memory of a tree in the default and in the compact storage, see
+ * File_system_emulator::set_compact_storage(). The tree is built, then the memory it takes is reported per entity:
+ * the bytes of entities and indices counted by stats(), and the growth of the resident set. Names repeat in the
+ * synthetic tree, so they take next to nothing. Every storage is measured in a process of its own, as freed memory
+ * isn't always given back to the system.
+ *
+ * Usage: storage [nodes] [default|compact], by default 10M nodes in the compact storage.
+ */
+int
+main(int argc, char const* argv[])
+{
+  std::size_t nodes__ = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10'000'000;
+  bool is_compact__ = argc <= 2 || std::string_view{ argv[2] } != "default";
+
+  File_system_emulator fse__;
+  fse__.set_compact_storage(is_compact__);
+  fse__.make_dir("C:\\Tree");
+
+  long rss_kb__ = trimmed_rss_kb();
+
+  Stopwatch stopwatch__;
+  std::size_t created__ = build_tree(fse__, "C:\\Tree", nodes__, 16);
+  double elapsed_ns__ = stopwatch__.elapsed_ns();
+
+  // Paths queued by the build are freed before the resident set is measured.
+  rss_kb__ = trimmed_rss_kb() - rss_kb__;
+
+  File_system_emulator::Stats stats__ = fse__.stats();
+  std::size_t size__ = fse__.size();
+
+  report(is_compact__ ? "build compact" : "build default", created__, created__, elapsed_ns__, rss_kb__);
+  std::printf("%-24s nodes=%-10zu entities %.1f B/node   indices %.1f B/node   link lists %.1f B/node   "
+              "slack %.1f B/node   rss %.1f B/node\n",
+              is_compact__ ? "memory compact" : "memory default", size__,
+              static_cast<double>(stats__.m_node_bytes) / size__, static_cast<double>(stats__.m_index_bytes) / size__,
+              static_cast<double>(stats__.m_link_list_bytes) / size__,
+              static_cast<double>(stats__.m_slack_bytes) / size__, 1024.0 * rss_kb__ / size__);
+
+  return 0;
+}
@@ -1,10 +1,17 @@
 #ifndef __BASE_HPP__
 #define __BASE_HPP__
 
-#include <forward_list>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
 #include <memory>
-#include <set>
+#include <span>
 #include <string>
+#include <string_view>
+#include <vector>
+
+#include "name_table.hpp"
+#include "profiler.hpp"
 
 /**
  * @enum Enumerates the types of nodes that can exist within the file system emulator.
@@ -14,7 +21,7 @@
  * HLINK: Represents a hard link, which acts as another reference to a file or directory.
  * DLINK: Represents a dynamic (soft) link, which acts as a shortcut to another file or directory.
  */
-enum class NODE_TYPE
+enum class NODE_TYPE : std::uint8_t
 {
   DIRECTORY = 0,
   FILE,
@@ -23,53 +30,767 @@ enum class NODE_TYPE
 };
 
 struct Directory;
+struct Link;
+struct Linked_node;
 
 /**
  *@brief Represents the base node within the File System Emulator (FSE) tree. This is an abstract
  * base class for all nodes (directories, files, and links) within the file system.
+ *
+ * m_name: Identifier of the node's name in the name table of the emulator that owns the node. Links have no
+ * name of their own, it's derived from the path of their target when the link is printed.
+ * m_removed: Set on a file or a directory that's removed from the tree but stays allocated until its dynamic links
+ * are reclaimed, see File_system_emulator::set_deferred_dlink_removal().
+ *
+ * Nodes are allocated from type-segregated pools of the emulator and are always destroyed through their
+ * exact type, hence the hierarchy has no virtual destructor.
  */
 struct Node
 {
-  Node(NODE_TYPE type) noexcept : m_parent(nullptr), m_type(type), m_name(){};
-
-  virtual ~Node() = default;
+  Node(NODE_TYPE type) noexcept : m_parent(nullptr), m_name(0), m_type(type), m_removed(false){};
 
   Directory* m_parent;
+  Name_id m_name;
   NODE_TYPE m_type;
-  std::string m_name;
+  bool m_removed;
+};
+
+/**
+ * @brief Represents a hard or a dynamic link. The link refers to its target directly, so neither copying
+ * nor moving of the link or its target requires any path resolution.
+ *
+ * m_target: The file or directory the link points to.
+ * m_slot: Position of the link in the list of children of its parent, makes detaching from the parent O(1).
+ * m_target_slot: Position of the link in the list of links of its target.
+ */
+struct Link : Node
+{
+  Link(NODE_TYPE type) noexcept : Node(type), m_target(nullptr), m_slot(0), m_target_slot(0){};
+
+  Linked_node* m_target;
+  std::uint32_t m_slot;
+  std::uint32_t m_target_slot;
+};
+
+/**
+ * @brief Lists of links attached to a file or a directory.
+ *
+ * m_hlinks: A list of hard links to the node.
+ * m_dlinks: A list of dynamic links to the node.
+ */
+struct Link_lists
+{
+  std::vector<Link*> m_hlinks;
+  std::vector<Link*> m_dlinks;
 };
 
 /**
  * @brief Extends the basic Node structure to include support for hard and dynamic links.
  * This class serves as the base for nodes that can be linked to, such as files and directories.
  *
- * m_hlinks: A list of nodes that are hard-linked to this node.
- * m_dlinks: A list of nodes that are dynamic links to this node.
+ * m_links: Links attached to this node, allocated with the first link and released with the last one, so the
+ * majority of nodes that are never linked to pay only for a pointer.
+ *
+ * Order of links in the lists is unspecified, a link is detached by moving the last link of the list into its slot.
  */
 struct Linked_node : Node
 {
-  Linked_node(NODE_TYPE type) noexcept : Node(type), m_hlinks(), m_dlinks(){};
+  Linked_node(NODE_TYPE type) noexcept : Node(type), m_links(){};
+
+  /**
+   * @brief Returns the hard links attached to this node.
+   */
+  const std::vector<Link*>&
+  hlinks() const noexcept
+  {
+    return m_links ? m_links->m_hlinks : m_no_links();
+  }
+
+  /**
+   * @brief Returns the dynamic links attached to this node.
+   */
+  const std::vector<Link*>&
+  dlinks() const noexcept
+  {
+    return m_links ? m_links->m_dlinks : m_no_links();
+  }
 
-  std::forward_list<Node*> m_hlinks;
-  std::forward_list<Node*> m_dlinks;
+  /**
+   * @brief Attaches a link to this node, the link's target has to be set already.
+   *
+   * @param link The hard or dynamic link to attach.
+   */
+  void
+  add_link(Link* link)
+  {
+    if(!m_links)
+      m_links = std::make_unique<Link_lists>();
+
+    std::vector<Link*>& links__ = link->m_type == NODE_TYPE::HLINK ? m_links->m_hlinks : m_links->m_dlinks;
+
+    link->m_target_slot = static_cast<std::uint32_t>(links__.size());
+    links__.push_back(link);
+  }
+
+  /**
+   * @brief Detaches a link from this node in O(1).
+   *
+   * @param link The hard or dynamic link to detach.
+   */
+  void
+  remove_link(Link* link) noexcept
+  {
+    std::vector<Link*>& links__ = link->m_type == NODE_TYPE::HLINK ? m_links->m_hlinks : m_links->m_dlinks;
+    Link* last__ = links__.back();
+
+    links__[link->m_target_slot] = last__;
+    last__->m_target_slot = link->m_target_slot;
+    links__.pop_back();
+
+    if(m_links->m_hlinks.empty() && m_links->m_dlinks.empty())
+      m_links.reset();
+  }
+
+  /**
+   * @brief Detaches all dynamic links from this node at once.
+   *
+   * @return The detached links.
+   */
+  std::vector<Link*>
+  take_dlinks() noexcept
+  {
+    if(!m_links)
+      return {};
+
+    std::vector<Link*> dlinks__ = std::move(m_links->m_dlinks);
+
+    if(m_links->m_hlinks.empty())
+      m_links.reset();
+
+    return dlinks__;
+  }
+
+  std::unique_ptr<Link_lists> m_links;
+
+private:
+  /**
+   * @brief Returns the empty list of links reported by nodes without links.
+   */
+  static const std::vector<Link*>&
+  m_no_links() noexcept
+  {
+    static const std::vector<Link*> no_links__;
+    return no_links__;
+  }
+};
+
+/**
+ * @brief Checks whether a node is a dynamic link to a removed target. Such a link stays among children of its
+ * directory until it's reclaimed, but it's no longer a part of the tree: lookups, copies and printing skip it.
+ *
+ * @param node The node to check.
+ * @return True if the node is a dangling dynamic link.
+ */
+inline bool
+is_dangling(const Node* node) noexcept
+{
+  return node->m_type == NODE_TYPE::DLINK && static_cast<const Link*>(node)->m_target->m_removed;
+}
+
+/**
+ * @brief Key of a node among children of its parent directory. Files and directories share one namespace and
+ * are keyed by their names, links are keyed by their type and their target.
+ *
+ * m_type: NODE_TYPE::DIRECTORY for files and directories, the link's type for links.
+ * m_value: Name of a file or a directory, or the address of the target of a link.
+ */
+struct Child_key
+{
+  /**
+   * @brief Makes a key of a file or a directory with the given name.
+   */
+  static Child_key
+  named(Name_id name) noexcept
+  {
+    return { NODE_TYPE::DIRECTORY, name };
+  }
+
+  /**
+   * @brief Makes a key of a link of the given type to the given target.
+   */
+  static Child_key
+  link(NODE_TYPE type, const Linked_node* target) noexcept
+  {
+    return { type, reinterpret_cast<std::uintptr_t>(target) };
+  }
+
+  /**
+   * @brief Makes a key of an existing node.
+   */
+  static Child_key
+  of(const Node* node) noexcept
+  {
+    if(node->m_type == NODE_TYPE::HLINK || node->m_type == NODE_TYPE::DLINK)
+      return link(node->m_type, static_cast<const Link*>(node)->m_target);
+    return named(node->m_name);
+  }
+
+  bool
+  operator==(const Child_key& other) const noexcept = default;
+
+  NODE_TYPE m_type;
+  std::uintptr_t m_value;
+};
+
+/**
+ * @brief Files and directories of a large directory in order of their names. They're kept in a list of sorted
+ * chunks, so a node is found by binary searches and inserted or erased by moving at most a chunk of pointers, while
+ * printing walks the chunks one after another.
+ *
+ * m_chunks: Consecutive runs of nodes in order of their names, none of them empty.
+ */
+struct Name_order
+{
+  /**
+   * @brief Number of nodes a chunk is split at.
+   */
+  static constexpr std::size_t MAX_CHUNK = 512;
+
+  /**
+   * @brief Makes the order of nodes sorted already.
+   */
+  Name_order(Node* const* first, Node* const* last) : m_chunks()
+  {
+    for(; first != last; first += std::min<std::size_t>(last - first, MAX_CHUNK / 2))
+      m_chunks.emplace_back(first, first + std::min<std::size_t>(last - first, MAX_CHUNK / 2));
+  }
+
+  /**
+   * @brief Inserts a node at the place of its name. A chunk that outgrows MAX_CHUNK is split in halves.
+   */
+  void
+  insert(Node* node, const Name_table& names)
+  {
+    std::string_view name__ = names.name(node->m_name);
+    auto chunk__ = m_find_chunk(name__, names);
+    auto position__ = m_find_position(*chunk__, name__, names);
+
+    chunk__->insert(position__, node);
+
+    if(chunk__->size() > MAX_CHUNK)
+      {
+        std::vector<Node*> half__(chunk__->begin() + MAX_CHUNK / 2, chunk__->end());
+
+        chunk__->resize(MAX_CHUNK / 2);
+        m_chunks.insert(chunk__ + 1, std::move(half__));
+      }
+  }
+
+  /**
+   * @brief Erases a node. An emptied chunk is dropped, a chunk shrunk below a quarter of MAX_CHUNK is merged into a
+   * neighbour that has room for it.
+   */
+  void
+  erase(const Node* node, const Name_table& names)
+  {
+    std::string_view name__ = names.name(node->m_name);
+    auto chunk__ = m_find_chunk(name__, names);
+
+    chunk__->erase(m_find_position(*chunk__, name__, names));
+
+    if(chunk__->empty())
+      m_chunks.erase(chunk__);
+    else if(chunk__->size() < MAX_CHUNK / 4)
+      {
+        if(chunk__ + 1 != m_chunks.end() && chunk__->size() + chunk__[1].size() <= MAX_CHUNK)
+          {
+            chunk__->insert(chunk__->end(), chunk__[1].begin(), chunk__[1].end());
+            m_chunks.erase(chunk__ + 1);
+          }
+        else if(chunk__ != m_chunks.begin() && chunk__->size() + chunk__[-1].size() <= MAX_CHUNK)
+          {
+            chunk__[-1].insert(chunk__[-1].end(), chunk__->begin(), chunk__->end());
+            m_chunks.erase(chunk__);
+          }
+      }
+  }
+
+  std::vector<std::vector<Node*>> m_chunks;
+
+private:
+  /**
+   * @brief Finds the chunk a name belongs to: the first one whose last name isn't less than it, or the last one.
+   */
+  std::vector<std::vector<Node*>>::iterator
+  m_find_chunk(std::string_view name, const Name_table& names)
+  {
+    if(m_chunks.empty())
+      return m_chunks.emplace(m_chunks.end());
+
+    return std::lower_bound(m_chunks.begin(), m_chunks.end() - 1, name,
+                            [&names](const std::vector<Node*>& chunk, std::string_view name) {
+                              return names.name(chunk.back()->m_name) < name;
+                            });
+  }
+
+  /**
+   * @brief Finds the position of the first node of a chunk whose name isn't less than the given one.
+   */
+  static std::vector<Node*>::iterator
+  m_find_position(std::vector<Node*>& chunk, std::string_view name, const Name_table& names) noexcept
+  {
+    return std::lower_bound(chunk.begin(), chunk.end(), name, [&names](const Node* node, std::string_view name) {
+      return names.name(node->m_name) < name;
+    });
+  }
 };
 
 /**
  * @brief Represents a directory within the file system. It extends Linked_node to include
  * the capability to have child nodes, making it possible to build a hierarchical
  * structure of files and directories.
+ *
+ * m_childs: A list of nodes that are stored in this directory. Files and directories come first, links follow them
+ * in no particular order. Files and directories of a small directory are kept in order of their names, those of a
+ * large one in no particular order.
+ * m_table: Open addressing hash table of positions of files and directories in m_childs by their names, exists only
+ * in directories with more than LINEAR_SEARCH_LIMIT of them. Smaller directories are scanned instead.
+ * m_order: Files and directories of a directory with a table in order of their names, see sorted_run().
+ * m_named: Number of files and directories in m_childs.
+ * m_table_mask: Number of slots of m_table minus one.
+ * m_sharer_slot: Position of the directory in the list of sharers of m_shared.
+ * m_height: Number of levels below the directory, 0 if it has no children. A copy-on-write copy has the height of
+ * the directory it shares children of.
+ * m_tallest_childs: Number of children of m_childs that are m_height - 1 levels high, so removing a child rescans the
+ * rest only when the last of them is gone.
+ * m_subtree_hlinks: Number of hard links attached to this directory and to all entities below it.
+ * m_subtree_links: Number of links placed in this directory and in all directories below it.
+ * m_shared: Directory whose children this one shares as a copy-on-write copy, nullptr if it has children of its own.
+ * Only directories without links below them are shared, and never by another sharing one.
+ * m_sharers: A list of copies sharing children of this directory.
+ *
+ * A directory doesn't own its children, they're released by the emulator that allocated them.
  */
 struct Directory : Linked_node
 {
-  Directory() noexcept : Linked_node(NODE_TYPE::DIRECTORY), m_childs(){};
+  /**
+   * @brief Number of files and directories up to which a child is looked up by a linear scan.
+   */
+  static constexpr std::size_t LINEAR_SEARCH_LIMIT = 16;
+
+  Directory() noexcept
+      : Linked_node(NODE_TYPE::DIRECTORY), m_childs(), m_table(), m_order(), m_named(0), m_table_mask(0),
+        m_sharer_slot(0), m_height(0), m_tallest_childs(0), m_subtree_hlinks(0), m_subtree_links(0), m_shared(nullptr),
+        m_sharers(){};
+
+  /**
+   * @brief Returns the children of the directory, or the shared ones of a copy-on-write copy.
+   */
+  const std::vector<Node*>&
+  childs() const noexcept
+  {
+    return m_shared ? m_shared->m_childs : m_childs;
+  }
+
+  /**
+   * @brief Looks up a direct child by its key. A file or a directory is found by its name in the hash table or by a
+   * scan of a small directory, a link by a scan of either the links of this directory or the links of the target,
+   * whichever list is shorter.
+   *
+   * @param key The key of the child.
+   * @return A pointer to the child, or nullptr if there is no child with such key.
+   */
+  Node*
+  find_child(const Child_key& key) const noexcept
+  {
+    if(key.m_type == NODE_TYPE::DIRECTORY)
+      {
+        Name_id name__ = static_cast<Name_id>(key.m_value);
+
+        if(m_table)
+          {
+            for(std::size_t i = m_home(name__); m_table[i] != EMPTY_SLOT; i = (i + 1) & m_table_mask)
+              if(FSE_PROFILE_COMPARE(m_childs[m_table[i]]->m_name == name__))
+                return m_childs[m_table[i]];
+
+            return nullptr;
+          }
+
+        // Names are interned, so a few children are compared by identifiers only.
+        for(std::size_t i = 0; i < m_named; ++i)
+          if(FSE_PROFILE_COMPARE(m_childs[i]->m_name == name__))
+            return m_childs[i];
+
+        return nullptr;
+      }
+
+    const Linked_node* target__ = reinterpret_cast<const Linked_node*>(key.m_value);
+    const std::vector<Link*>& links__ = key.m_type == NODE_TYPE::HLINK ? target__->hlinks() : target__->dlinks();
+
+    if(links__.size() <= m_childs.size() - m_named)
+      {
+        for(Link* link__ : links__)
+          if(FSE_PROFILE_COMPARE(link__->m_parent == this))
+            return link__;
+      }
+    else
+      {
+        for(std::size_t i = m_named; i < m_childs.size(); ++i)
+          if(FSE_PROFILE_COMPARE(m_childs[i]->m_type == key.m_type
+                                 && static_cast<const Link*>(m_childs[i])->m_target == target__))
+            return m_childs[i];
+      }
+
+    return nullptr;
+  }
+
+  /**
+   * @brief Attaches a node as a child of this directory. The key of the node has to be unique in the directory.
+   * A link is appended, a file or a directory is inserted at the place of its name among at most
+   * LINEAR_SEARCH_LIMIT others in m_childs, or appended to m_childs of a larger directory and inserted into its
+   * m_order. Counters of links are updated along the chain of ancestors if the node is a link or has links below it.
+   *
+   * @param child The node to attach.
+   * @param names The table of names of the emulator that owns the directory.
+   */
+  void
+  add_child(Node* child, const Name_table& names)
+  {
+    child->m_parent = this;
+
+    if(child->m_type == NODE_TYPE::HLINK || child->m_type == NODE_TYPE::DLINK)
+      {
+        static_cast<Link*>(child)->m_slot = static_cast<std::uint32_t>(m_childs.size());
+        m_childs.push_back(child);
+      }
+    else
+      {
+        // The first link makes room behind files and directories by moving to the end.
+        m_childs.push_back(child);
+
+        if(m_named + 1 != m_childs.size())
+          {
+            m_childs.back() = m_childs[m_named];
+            static_cast<Link*>(m_childs.back())->m_slot = static_cast<std::uint32_t>(m_childs.size() - 1);
+          }
+
+        if(m_order)
+          {
+            m_childs[m_named] = child;
+            m_order->insert(child, names);
+          }
+        else
+          {
+            auto first__ = m_childs.begin();
+            auto position__ = m_find_position(names.name(child->m_name), names);
+
+            std::move_backward(position__, first__ + m_named, first__ + m_named + 1);
+            *position__ = child;
+          }
+
+        ++m_named;
+
+        // A directory that outgrows the linear search keeps its order in m_order from now on.
+        if(m_named > LINEAR_SEARCH_LIMIT)
+          {
+            if(!m_order)
+              m_order = std::make_unique<Name_order>(m_childs.data(), m_childs.data() + m_named);
+
+            m_table_insert(m_named - 1);
+          }
+      }
+
+    if(std::size_t links__ = links_below(child))
+      for(Directory* dir__ = this; dir__; dir__ = dir__->m_parent)
+        dir__->m_subtree_links += links__;
+  }
+
+  /**
+   * @brief Detaches a child from this directory without deleting it. A link is replaced by the last link. A file or
+   * a directory of a small directory is erased from m_childs, one of a larger directory is erased from m_order and
+   * replaced by the last file or directory in m_childs. The last link takes the place freed behind files and
+   * directories.
+   *
+   * @param child The node to detach.
+   * @param names The table of names of the emulator that owns the directory.
+   */
+  void
+  remove_child(Node* child, const Name_table& names)
+  {
+    if(child->m_type == NODE_TYPE::HLINK || child->m_type == NODE_TYPE::DLINK)
+      {
+        Link* last__ = static_cast<Link*>(m_childs.back());
+
+        m_childs[static_cast<Link*>(child)->m_slot] = last__;
+        last__->m_slot = static_cast<Link*>(child)->m_slot;
+      }
+    else
+      {
+        if(m_order)
+          {
+            std::size_t position__ = m_table_erase(child);
+
+            m_order->erase(child, names);
+            --m_named;
+
+            if(position__ != m_named)
+              {
+                m_childs[position__] = m_childs[m_named];
+                m_table_move(m_named, position__);
+              }
+          }
+        else
+          {
+            auto first__ = m_childs.begin();
+            auto position__ = std::find(first__, first__ + m_named, child);
+
+            std::move(position__ + 1, first__ + m_named, position__);
+            --m_named;
+          }
+
+        if(m_named + 1 != m_childs.size())
+          {
+            m_childs[m_named] = m_childs.back();
+            static_cast<Link*>(m_childs[m_named])->m_slot = m_named;
+          }
+
+        // A directory back within the linear search keeps its files and directories in order in m_childs again.
+        if(m_order && m_named <= LINEAR_SEARCH_LIMIT)
+          {
+            auto first__ = m_childs.begin();
+
+            for(const std::vector<Node*>& chunk__ : m_order->m_chunks)
+              first__ = std::copy(chunk__.begin(), chunk__.end(), first__);
+
+            m_order.reset();
+            m_table.reset();
+            m_table_mask = 0;
+          }
+      }
+
+    m_childs.pop_back();
+
+    if(std::size_t links__ = links_below(child))
+      for(Directory* dir__ = this; dir__; dir__ = dir__->m_parent)
+        dir__->m_subtree_links -= links__;
+  }
+
+  /**
+   * @brief Returns the number of runs that list files and directories of this directory in order of their names,
+   * see sorted_run().
+   */
+  std::size_t
+  sorted_runs() const noexcept
+  {
+    return m_order ? m_order->m_chunks.size() : m_named != 0;
+  }
+
+  /**
+   * @brief Returns a run of files and directories of this directory in order of their names. Runs follow each other
+   * in the same order.
+   *
+   * @param run The position of the run, less than sorted_runs().
+   */
+  std::span<Node* const>
+  sorted_run(std::size_t run) const noexcept
+  {
+    if(m_order)
+      return m_order->m_chunks[run];
+
+    return { m_childs.data(), m_named };
+  }
 
-  ~Directory() noexcept
+  /**
+   * @brief Registers a copy-on-write copy that shares children of this directory.
+   *
+   * @param sharer The copy, its m_shared has to be set already.
+   */
+  void
+  add_sharer(Directory* sharer)
   {
-    for(auto child__ : m_childs)
-      delete child__;
+    sharer->m_sharer_slot = static_cast<std::uint32_t>(m_sharers.size());
+    m_sharers.push_back(sharer);
   }
 
-  std::forward_list<Node*> m_childs;
+  /**
+   * @brief Forgets a copy-on-write copy in O(1), the last sharer is moved into its slot.
+   *
+   * @param sharer The copy to forget.
+   */
+  void
+  remove_sharer(Directory* sharer) noexcept
+  {
+    Directory* last__ = m_sharers.back();
+
+    m_sharers[sharer->m_sharer_slot] = last__;
+    last__->m_sharer_slot = sharer->m_sharer_slot;
+    m_sharers.pop_back();
+  }
+
+  /**
+   * @brief Returns the number of links a node brings along: 1 for a link, the count of links below a directory.
+   */
+  static std::size_t
+  links_below(const Node* node) noexcept
+  {
+    if(node->m_type == NODE_TYPE::DIRECTORY)
+      return static_cast<const Directory*>(node)->m_subtree_links;
+    return node->m_type == NODE_TYPE::FILE ? 0 : 1;
+  }
+
+  /**
+   * @brief Returns the number of levels below a node, 0 for files and links.
+   */
+  static std::uint32_t
+  levels_below(const Node* node) noexcept
+  {
+    return node->m_type == NODE_TYPE::DIRECTORY ? static_cast<const Directory*>(node)->m_height : 0;
+  }
+
+  /**
+   * @brief Raises the height of the directory to fit a child, counting the child among the tallest ones if it's as
+   * high as the directory allows. Heights of ancestors aren't updated.
+   *
+   * @param child The child, counted once.
+   */
+  void
+  fit_height(const Node* child) noexcept
+  {
+    std::uint32_t height__ = levels_below(child) + 1;
+
+    if(height__ > m_height)
+      {
+        m_height = height__;
+        m_tallest_childs = 1;
+      }
+    else if(height__ == m_height)
+      ++m_tallest_childs;
+  }
+
+  std::vector<Node*> m_childs;
+  std::unique_ptr<std::uint32_t[]> m_table;
+  std::unique_ptr<Name_order> m_order;
+  std::uint32_t m_named;
+  std::uint32_t m_table_mask;
+  std::uint32_t m_sharer_slot;
+  std::uint32_t m_height;
+  std::uint32_t m_tallest_childs;
+  std::size_t m_subtree_hlinks;
+  std::size_t m_subtree_links;
+  Directory* m_shared;
+  std::vector<Directory*> m_sharers;
+
+private:
+  /**
+   * @brief Marks a slot of m_table that holds no position.
+   */
+  static constexpr std::uint32_t EMPTY_SLOT = static_cast<std::uint32_t>(-1);
+
+  /**
+   * @brief Returns the slot of m_table a name hashes to, names are spread by Fibonacci hashing.
+   */
+  std::size_t
+  m_home(Name_id name) const noexcept
+  {
+    return static_cast<std::size_t>((name * 0x9E3779B97F4A7C15ull) >> 32) & m_table_mask;
+  }
+
+  /**
+   * @brief Adds the position of a file or a directory that is counted in m_named already to m_table. The table is
+   * built once the directory outgrows LINEAR_SEARCH_LIMIT and is rebuilt twice as large once it's three quarters
+   * full.
+   */
+  void
+  m_table_insert(std::size_t position)
+  {
+    if(m_table && m_named * 4 <= (std::size_t{ m_table_mask } + 1) * 3)
+      {
+        std::size_t i = m_home(m_childs[position]->m_name);
+
+        while(m_table[i] != EMPTY_SLOT)
+          i = (i + 1) & m_table_mask;
+
+        m_table[i] = static_cast<std::uint32_t>(position);
+        return;
+      }
+
+    std::size_t size__ = std::bit_ceil(std::size_t{ m_named } * 2);
+
+    m_table = std::make_unique_for_overwrite<std::uint32_t[]>(size__);
+    m_table_mask = static_cast<std::uint32_t>(size__ - 1);
+    std::fill_n(m_table.get(), size__, EMPTY_SLOT);
+
+    for(std::size_t i = 0; i < m_named; ++i)
+      {
+        std::size_t j = m_home(m_childs[i]->m_name);
+
+        while(m_table[j] != EMPTY_SLOT)
+          j = (j + 1) & m_table_mask;
+
+        m_table[j] = static_cast<std::uint32_t>(i);
+      }
+  }
+
+  /**
+   * @brief Removes a file or a directory from m_table. Entries following it are shifted back instead of leaving a
+   * tombstone.
+   *
+   * @return The position of the file or the directory in m_childs.
+   */
+  std::size_t
+  m_table_erase(const Node* child) noexcept
+  {
+    std::size_t i = m_home(child->m_name);
+
+    while(m_childs[m_table[i]] != child)
+      i = (i + 1) & m_table_mask;
+
+    std::size_t position__ = m_table[i];
+
+    for(std::size_t j = (i + 1) & m_table_mask; m_table[j] != EMPTY_SLOT; j = (j + 1) & m_table_mask)
+      {
+        // An entry may fill the hole only if the hole lies between its home slot and its current one.
+        if(((j - m_home(m_childs[m_table[j]]->m_name)) & m_table_mask) >= ((j - i) & m_table_mask))
+          {
+            m_table[i] = m_table[j];
+            i = j;
+          }
+      }
+
+    m_table[i] = EMPTY_SLOT;
+    return position__;
+  }
+
+  /**
+   * @brief Updates the entry of m_table of a file or a directory that has moved in m_childs.
+   *
+   * @param from The previous position of the file or the directory.
+   * @param to The position it's found at now.
+   */
+  void
+  m_table_move(std::size_t from, std::size_t to) noexcept
+  {
+    std::size_t i = m_home(m_childs[to]->m_name);
+
+    while(m_table[i] != from)
+      i = (i + 1) & m_table_mask;
+
+    m_table[i] = static_cast<std::uint32_t>(to);
+  }
+
+  /**
+   * @brief Finds the place of a name among files and directories of a small directory.
+   *
+   * @return The position of the first file or directory whose name isn't less than the given one.
+   */
+  std::vector<Node*>::iterator
+  m_find_position(std::string_view name, const Name_table& names) noexcept
+  {
+    auto first__ = m_childs.begin();
+
+    return std::lower_bound(first__, first__ + m_named, name,
+                            [&names](const Node* node, std::string_view name) { return names.name(node->m_name) < name; });
+  }
 };
 
 /**
@@ -80,8 +801,9 @@ struct Directory : Linked_node
 struct File : Linked_node
 {
   File() noexcept : Linked_node(NODE_TYPE::FILE){};
-
-  ~File() = default;
 };
 
+static_assert(sizeof(File) <= 3 * sizeof(void*) && sizeof(Link) <= 4 * sizeof(void*),
+              "Files and links are the bulk of large trees, keep them compact.");
+
 #endif
\ No newline at end of file
@@ -0,0 +1,123 @@
+#ifndef __COMMAND_HPP__
+#define __COMMAND_HPP__
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * @brief Commands of a script understood by the emulator.
+ */
+enum class COMMAND_TYPE : std::uint8_t
+{
+  UNKNOWN,
+  MAKE_DIR,
+  CHANGE_DIR,
+  REMOVE_DIR,
+  DELETE_TREE,
+  MAKE_FILE,
+  MAKE_HLINK,
+  MAKE_DLINK,
+  REMOVE_FILE,
+  COPY,
+  MOVE,
+  STATS,
+  FIND,
+  BEGIN,
+  COMMIT,
+  ROLLBACK
+};
+
+/**
+ * @brief Static description of a command.
+ *
+ * m_name: Name of the command as it's written in scripts, e.g. "MD".
+ * m_type: Type of the command.
+ * m_arity: Number of parameters the command requires.
+ */
+struct Command_info
+{
+  std::string_view m_name;
+  COMMAND_TYPE m_type;
+  std::size_t m_arity;
+};
+
+/**
+ * @brief All known commands, indexed by their COMMAND_TYPE.
+ */
+inline constexpr std::array<Command_info, 16> COMMANDS{ { { "", COMMAND_TYPE::UNKNOWN, 0 },
+                                                          { "MD", COMMAND_TYPE::MAKE_DIR, 1 },
+                                                          { "CD", COMMAND_TYPE::CHANGE_DIR, 1 },
+                                                          { "RD", COMMAND_TYPE::REMOVE_DIR, 1 },
+                                                          { "DELTREE", COMMAND_TYPE::DELETE_TREE, 1 },
+                                                          { "MF", COMMAND_TYPE::MAKE_FILE, 1 },
+                                                          { "MHL", COMMAND_TYPE::MAKE_HLINK, 2 },
+                                                          { "MDL", COMMAND_TYPE::MAKE_DLINK, 2 },
+                                                          { "DEL", COMMAND_TYPE::REMOVE_FILE, 1 },
+                                                          { "COPY", COMMAND_TYPE::COPY, 2 },
+                                                          { "MOVE", COMMAND_TYPE::MOVE, 2 },
+                                                          { "STATS", COMMAND_TYPE::STATS, 0 },
+                                                          { "FIND", COMMAND_TYPE::FIND, 1 },
+                                                          { "BEGIN", COMMAND_TYPE::BEGIN, 0 },
+                                                          { "COMMIT", COMMAND_TYPE::COMMIT, 0 },
+                                                          { "ROLLBACK", COMMAND_TYPE::ROLLBACK, 0 } } };
+
+/**
+ * @brief A parsed line of a script. Parameters refer to the characters of the line itself.
+ *
+ * m_type: Type of the command, UNKNOWN if the name of the command isn't recognized.
+ * m_args: The first two parameters of the command.
+ * m_argc: Number of parameters found on the line, including the ones not kept in m_args.
+ */
+struct Command
+{
+  COMMAND_TYPE m_type = COMMAND_TYPE::UNKNOWN;
+  std::array<std::string_view, 2> m_args{};
+  std::size_t m_argc = 0;
+};
+
+/**
+ * @brief Number of commands of a script or of a journal collected into one File_system_emulator::apply_batch().
+ */
+inline constexpr std::size_t COMMAND_BATCH_SIZE = 4096;
+
+/**
+ * @brief Packs a case-folded command name of up to 8 characters into an integer.
+ *
+ * @param name The name of a command.
+ * @return The packed name, or 0 if the name is empty or too long to be a command.
+ */
+constexpr std::uint64_t
+pack_command_name(std::string_view name) noexcept
+{
+  if(name.empty() || name.size() > sizeof(std::uint64_t))
+    return 0;
+
+  std::uint64_t key__ = 0;
+
+  for(char c__ : name)
+    key__ = (key__ << 8) | static_cast<std::uint8_t>(c__ >= 'A' && c__ <= 'Z' ? c__ - 'A' + 'a' : c__);
+
+  return key__;
+}
+
+/**
+ * @brief Finds a command by its name, ignoring the case. The lookup goes through a perfect hash of the known
+ * names built at compile time, so it costs the same for every command and allocates nothing.
+ *
+ * @param name The name of a command.
+ * @return The type of the command, or COMMAND_TYPE::UNKNOWN.
+ */
+COMMAND_TYPE
+find_command(std::string_view name) noexcept;
+
+/**
+ * @brief Splits a line of a script on spaces and recognizes its command.
+ *
+ * @param line The line to parse, has to outlive the returned command.
+ * @return The parsed command.
+ */
+Command
+parse_command(std::string_view line) noexcept;
+
+#endif
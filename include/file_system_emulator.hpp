@@ -1,9 +1,29 @@
 #ifndef __FILE_SYSTEM_EMULATOR_HPP__
 #define __FILE_SYSTEM_EMULATOR_HPP__
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <span>
+#include <string>
 #include <string_view>
+#include <unordered_map>
 
 #include "base.hpp"
+#include "command.hpp"
+#include "journal.hpp"
+#include "name_index.hpp"
+#include "node_pool.hpp"
+#include "node_table.hpp"
+#include "path_cache.hpp"
+#include "profiler.hpp"
+#include "task_pool.hpp"
+#include "tree_view.hpp"
+#include "tree_writer.hpp"
 
 /**
  * @class File_system_emulator
@@ -17,6 +37,62 @@
 class File_system_emulator
 {
 public:
+  /**
+   * @brief Default minimum number of nodes of a subtree that is copied by several threads.
+   */
+  static constexpr std::size_t DEFAULT_PARALLEL_COPY_THRESHOLD = 64 * 1024;
+
+  /**
+   * @brief Number of buckets of the fan-out histogram of Stats.
+   */
+  static constexpr std::size_t FANOUT_BUCKETS = 33;
+
+  /**
+   * @brief Number of dangling dynamic links reclaimed after every command of a batch, see
+   * set_deferred_dlink_removal().
+   */
+  static constexpr std::size_t DLINK_SWEEP_SLICE = 1024;
+
+  /**
+   * @brief Counters of the tree and of its memory, see stats().
+   *
+   * m_nodes: Number of entities of every type, indexed by NODE_TYPE. The drive counts as a directory, entities
+   * removed by an open transaction don't count, though they keep their memory until it's committed. Entities that
+   * copy-on-write copies share with their sources are stored once and count once, so a tree copied that way counts
+   * fewer entities than the same tree copied in full until the copies are changed.
+   * m_node_bytes: Memory of the entities and of their places in lists of children.
+   * m_name_bytes: Memory of interned names, their characters and views.
+   * m_index_bytes: Memory of the index of files and directories by their names, see find().
+   * m_link_list_bytes: Memory of lists of links attached to files and directories, spare capacity isn't counted.
+   * m_slack_bytes: Memory allocated for entities and names that isn't used, e.g. slots of removed entities.
+   * m_max_depth: Depth of the deepest entity, 0 if the drive is empty.
+   * m_fanout: Number of directories by the number of their children: bucket 0 counts empty directories, bucket k
+   * counts those with 2^(k-1) to 2^k - 1 children. Copy-on-write copies count only children of their own.
+   * m_dangling_links: Number of dynamic links to removed targets that aren't reclaimed yet. They aren't counted in
+   * m_nodes, but they take their memory and places among children of their directories until they're reclaimed.
+   */
+  struct Stats
+  {
+    std::array<std::size_t, 4> m_nodes;
+    std::size_t m_node_bytes;
+    std::size_t m_name_bytes;
+    std::size_t m_index_bytes;
+    std::size_t m_link_list_bytes;
+    std::size_t m_slack_bytes;
+    std::size_t m_max_depth;
+    std::array<std::size_t, FANOUT_BUCKETS> m_fanout;
+    std::size_t m_dangling_links;
+  };
+
+  /**
+   * @brief Returns the bucket of the fan-out histogram of a directory with the given number of children.
+   */
+  static std::size_t
+  fanout_bucket(std::size_t childs) noexcept
+  {
+    return std::min<std::size_t>(std::bit_width(childs), FANOUT_BUCKETS - 1);
+  }
+
   File_system_emulator() noexcept;
 
   ~File_system_emulator();
@@ -88,7 +164,8 @@ public:
   remove_file(std::string_view path);
 
   /**
-   * @brief Copies a directory along with its entire subtree to a new location.
+   * @brief Copies a directory along with its entire subtree to a new location. Nothing is copied if the destination
+   * already has an entity with the name of the source.
    *
    * @param source The source path from which to copy.
    * @param dest The destination path where the copy will be placed.
@@ -98,12 +175,13 @@ public:
   copy(std::string_view source, std::string_view dest);
 
   /**
-   * @brief Moves a directory along with its entire subtree to a new location.
+   * @brief Moves a directory along with its entire subtree to a new location. Nothing is moved if the destination
+   * already has an entity with the name of the source.
    *
    * @param source The source path to move from.
    * @param dest The destination path where the source will be moved.
    * @throws std::runtime_error If either the source or destination path is not found, the source has attached
-   * hard links, or if the source is the current or root directory.
+   * hard links, or if the destination is inside the source.
    */
   void
   move(std::string_view source, std::string_view dest);
@@ -111,32 +189,443 @@ public:
   /**
    * @brief Deletes an entire directory tree starting from the specified path.
    *
+   * The tree is either deleted completely or left untouched. Hard links placed inside the tree are deleted with
+   * it, whatever they're attached to.
+   *
    * @param path The root path of the tree to delete.
-   * @throws std::runtime_error If the path is not found, if any files within the subdirectories have attached
-   * hard links, or if the path is the current or root directory.
+   * @throws std::runtime_error If the path is not found, if any entity within the tree has hard links attached from
+   * outside of it, or if the tree is the root directory or contains the current directory.
    */
   void
   delete_tree(std::string_view path);
 
+  /**
+   * @brief Applies parsed commands in order, with the same semantics and errors as the individual calls.
+   *
+   * Parent directories of MD and MF commands are resolved once per batch: a parent path is walked from the
+   * longest of its prefixes resolved earlier, so runs of commands sharing a path prefix don't walk it again.
+   * Commands that may move or remove directories, or change the current one, start the resolution over. BEGIN,
+   * COMMIT and ROLLBACK open and close a transaction, see begin().
+   *
+   * @param commands The commands to apply, unknown commands are skipped. Their parameters have to stay valid
+   * during the call.
+   * @throws std::runtime_error If a command fails, commands before it remain applied.
+   */
+  void
+  apply_batch(std::span<const Command> commands);
+
+  /**
+   * @brief Opens a transaction. Changes made until commit() or rollback() are recorded in an undo log, entities
+   * removed meanwhile stay allocated, so rolling the changes back costs as much as making them, whatever the size
+   * of the tree. Dangling dynamic links aren't reclaimed while a transaction is open.
+   *
+   * @throws std::runtime_error If a transaction is already open, transactions don't nest.
+   */
+  void
+  begin();
+
+  /**
+   * @brief Keeps the changes of the open transaction and releases the entities it removed.
+   *
+   * @throws std::runtime_error If no transaction is open.
+   */
+  void
+  commit();
+
+  /**
+   * @brief Undoes the changes of the open transaction in reverse order, including the current directory. Entities
+   * created by the transaction are released, the removed ones are put back in their places.
+   *
+   * @throws std::runtime_error If no transaction is open.
+   */
+  void
+  rollback();
+
+  /**
+   * @brief Tells whether a transaction is open.
+   */
+  bool
+  in_transaction() const noexcept
+  {
+    return m_in_transaction;
+  }
+
+  /**
+   * @brief Writes the whole tree, names of its entities, targets of its links and the current directory into a
+   * binary snapshot, see snapshot.hpp for the format.
+   *
+   * @param path The path to the snapshot file, an existing file is overwritten.
+   * @throws std::runtime_error If the file can't be written.
+   */
+  void
+  save_snapshot(const std::string& path) const;
+
+  /**
+   * @brief Replaces the whole tree with the one stored in a snapshot. The snapshot is memory-mapped and its
+   * records are turned into nodes in a single linear pass, with no text parsing.
+   *
+   * @param path The path to the snapshot file.
+   * @throws std::runtime_error If the file can't be read or isn't a valid snapshot, the tree is left untouched
+   * then. Snapshots can't be loaded inside a transaction.
+   */
+  void
+  load_snapshot(const std::string& path);
+
+  /**
+   * @brief Starts journaling of successful mutations and directory changes. Records are committed to the disk in
+   * groups, see Journal.
+   *
+   * @param path The path to the journal file. An existing journal is appended to, it has to end where the
+   * current tree does, e.g. right after recover().
+   * @param group_size Number of records committed with one fsync.
+   * @throws std::runtime_error If the journal can't be opened, doesn't match the tree or a transaction is open.
+   */
+  void
+  open_journal(const std::string& path, std::size_t group_size = Journal::DEFAULT_GROUP_SIZE);
+
+  /**
+   * @brief Commits pending journal records and stops journaling.
+   *
+   * @throws std::runtime_error If pending records can't be written.
+   */
+  void
+  close_journal();
+
+  /**
+   * @brief Commits pending journal records without waiting for their group to fill up.
+   *
+   * @throws std::runtime_error If pending records can't be written.
+   */
+  void
+  commit_journal();
+
+  /**
+   * @brief Saves a snapshot of the tree and empties the journal, as the snapshot includes all of its records.
+   * The snapshot replaces the previous one atomically, a crash before the journal is emptied is detected by
+   * recover() through sequence numbers of the records.
+   *
+   * @param snapshot_path The path to the snapshot file.
+   * @throws std::runtime_error If the snapshot or the journal can't be written, or a transaction is open.
+   */
+  void
+  checkpoint(const std::string& snapshot_path);
+
+  /**
+   * @brief Restores the tree from the last checkpoint and replays the journal records made after it.
+   *
+   * @param snapshot_path The path to the snapshot of the last checkpoint. If it's empty, the journal is replayed
+   * onto the current tree, e.g. a new emulator when no checkpoint was ever made.
+   * @param journal_path The path to the journal.
+   * @throws std::runtime_error If the files can't be read, don't match each other, the journal or a transaction
+   * is open.
+   *
+   * A transaction the journal ends in stays open, so it can be committed or rolled back once the journal is
+   * reopened.
+   */
+  void
+  recover(const std::string& snapshot_path, const std::string& journal_path);
+
+  /**
+   * @brief Finds files and directories whose names match a pattern. Candidates come from the index of names rather
+   * than from a walk of the tree: a name without wildcards is looked up directly, a pattern ending in a plain
+   * extension checks only names with that extension, other patterns check every distinct name once. Entities of
+   * copy-on-write copies are found at every path they're seen at.
+   *
+   * @param pattern The pattern of names, '*' matches any sequence of characters and '?' any single character.
+   * @param root The path to the directory to search in, the whole drive if empty.
+   * @return Absolute paths of the found entities in lexicographical order.
+   * @throws std::runtime_error If the root is not found or isn't a directory.
+   */
+  std::vector<std::string>
+  find(std::string_view pattern, std::string_view root = {});
+
   /**
    * @brief Prints the structure of the file system to the standard output.
    */
   void
   print() const noexcept;
 
+  /**
+   * @brief Prints the structure of the file system to a stream. Entities are written in large chunks, children of
+   * a directory are kept in order of names, so only links of a directory are sorted while printing.
+   *
+   * @param stream The stream to print to.
+   */
+  void
+  print(std::ostream& stream) const;
+
+  /**
+   * @brief Publishes an immutable view of the current tree for concurrent readers, see view(). The previous view is
+   * released once its last reader drops it.
+   *
+   * Readers never block the writer, but publishing does: the view is built on the calling thread. Only directories
+   * changed since the previous view and their ancestors are listed again, the rest is shared with it, so a publish
+   * costs O(changed directories and their ancestors) rather than O(tree). The first view lists the whole tree.
+   * While views are published, moving an entity walks its subtree to find links whose names follow its path.
+   */
+  void
+  publish_view();
+
+  /**
+   * @brief Returns the last published view, nullptr until the first one is published. Safe to call from any
+   * thread while the emulator is being mutated, the writer never waits for readers. The view doesn't change while
+   * it's held, so a reader should hold it for a whole series of lookups.
+   */
+  std::shared_ptr<const Tree_view>
+  view() const;
+
+  /**
+   * @brief Replaces a held view with the last published one if it's newer. Checking costs a single atomic load,
+   * so readers polling for updates don't contend with each other. Safe to call from any thread.
+   *
+   * @param view The view held by the reader, may be nullptr.
+   * @return True if the view was replaced.
+   */
+  bool
+  refresh_view(std::shared_ptr<const Tree_view>& view) const;
+
+  /**
+   * @brief Returns the table of interned node names, e.g. to inspect its size and reuse counts.
+   */
+  const Name_table&
+  names() const noexcept
+  {
+    return m_names;
+  }
+
+#ifdef FSE_PROFILE
+  /**
+   * @brief Returns the counters of work and latencies of commands, exists only in builds with FSE_PROFILE.
+   */
+  const Profiler&
+  profiler() const noexcept
+  {
+    return m_profiler;
+  }
+#endif
+
+  /**
+   * @brief Returns the cache of resolved paths, e.g. to inspect its hit and miss counters.
+   */
+  const Path_cache&
+  path_cache() const noexcept
+  {
+    return m_path_cache;
+  }
+
+  /**
+   * @brief Changes the number of resolved paths kept by the cache, 0 disables caching.
+   *
+   * @param capacity The maximum number of cached paths.
+   */
+  void
+  set_path_cache_capacity(std::size_t capacity)
+  {
+    m_path_cache.set_capacity(capacity);
+  }
+
+  /**
+   * @brief Tunes copying of large directories on several threads, the result is the same as of a sequential copy.
+   *
+   * @param threshold Minimum number of nodes of a subtree that is copied in parallel, smaller ones are copied by
+   * the calling thread. 0 disables parallel copying.
+   * @param threads Number of threads of a parallel copy including the calling one, 0 for the number of hardware
+   * threads.
+   */
+  void
+  set_parallel_copy(std::size_t threshold, std::size_t threads = 0);
+
+  /**
+   * @brief Turns copy-on-write copies on or off, they're off by default. A copy of a directory without links below
+   * it is made in O(1) and shares the source's entities, private entities are made only along the paths of later
+   * changes of either side. Copies that exist already stay as they are when the mode changes.
+   *
+   * @param enabled True to share copied subtrees, False to duplicate them.
+   */
+  void
+  set_copy_on_write(bool enabled) noexcept
+  {
+    m_copy_on_write = enabled;
+  }
+
+  /**
+   * @brief Turns deferred removal of dynamic links on or off, it's off by default. Removing an entity deletes all
+   * dynamic links to it at once otherwise, which stalls the command for a popular target. In the deferred mode the
+   * links are left dangling in O(1): the target stays allocated just to mark them, and they're reclaimed by
+   * apply_batch() DLINK_SWEEP_SLICE links after every command, or all at once by compact(). Dangling links are
+   * never found, copied or printed.
+   *
+   * @param enabled True to leave dynamic links of removed entities dangling, False to delete them right away.
+   */
+  void
+  set_deferred_dlink_removal(bool enabled) noexcept
+  {
+    m_deferred_dlinks = enabled;
+  }
+
+  /**
+   * @brief Moves the tree to the compact storage or back, it's off by default. The compact storage keeps entities
+   * in arrays addressed by 32-bit indices, see Node_table, so an entity takes 25 bytes instead of about 150, names
+   * aside. Commands, their results and errors stay the same, journaling and recovery from a journal alone
+   * work as well. Transactions, snapshots, checkpoints and views aren't supported, they throw. Copy-on-write and
+   * parallel copies, deferred removal of dynamic links and the path cache aren't used, copies are made one entity at
+   * a time and removed entities take their dynamic links along. Depth and fan-out of stats() are found by a walk of
+   * the tree.
+   *
+   * @param enabled True to use the compact storage, False to use the default one.
+   * @throws std::runtime_error If the drive isn't empty or a transaction is open, the tree isn't converted.
+   */
+  void
+  set_compact_storage(bool enabled);
+
+  /**
+   * @brief Tells whether the tree is kept in the compact storage, see set_compact_storage().
+   */
+  bool
+  is_compact_storage() const noexcept
+  {
+    return m_table != nullptr;
+  }
+
+  /**
+   * @brief Reclaims all dangling dynamic links and releases their removed targets. Does nothing inside a
+   * transaction.
+   */
+  void
+  compact();
+
+  /**
+   * @brief Returns the number of entities allocated by the emulator, shared entities of copies are counted once.
+   */
+  std::size_t
+  size() const noexcept
+  {
+    return m_table ? m_table->size() : m_directories.size() + m_files.size() + m_links.size();
+  }
+
+  /**
+   * @brief Returns the counters of the tree. They're maintained along with the tree, so the call doesn't depend on
+   * its size.
+   */
+  Stats
+  stats() const noexcept;
+
 private:
   /**
-   * @brief Converts a relative path to an absolute path based on a specified starting directory.
+   * @brief Nodes allocated by one thread of a parallel copy, moved to the pools of the emulator once it's done.
+   *
+   * m_links_to_attach: Copied links, attached to their targets after the copy as targets are shared by threads.
+   * m_fanout: Fan-out histogram of the copied directories, added to the one of the emulator after the copy.
+   * m_named_copies: Copied files and directories, added to the index of names after the copy.
+   */
+  struct alignas(64) Copy_worker
+  {
+    Node_pool<Directory> m_directories;
+    Node_pool<File> m_files;
+    Node_pool<Link> m_links;
+    std::vector<Link*> m_links_to_attach;
+    std::array<std::size_t, FANOUT_BUCKETS> m_fanout{};
+    std::vector<Node*> m_named_copies;
+  };
+
+  /**
+   * @brief Kinds of changes recorded in the undo log of a transaction, see Undo_record.
+   *
+   * NEW_NODE: A node was allocated, it's released on rollback.
+   * FREE_NODE: A node was released, it's kept allocated until commit and put back on rollback.
+   * ADD_CHILD: A node was added to a directory.
+   * REMOVE_CHILD: A node was removed from a directory.
+   * ATTACH_LINK: A link was attached to its target.
+   * DETACH_LINK: A link was detached from its target.
+   * SHARE: A directory became a copy-on-write copy of another one.
+   * MATERIALIZE: A copy-on-write copy got children of its own. Copies made by the materialization aren't recorded
+   * one by one, they're all released on rollback.
+   * CHANGE_DIR: The current directory changed.
+   */
+  enum class UNDO_TYPE : std::uint8_t
+  {
+    NEW_NODE,
+    FREE_NODE,
+    ADD_CHILD,
+    REMOVE_CHILD,
+    ATTACH_LINK,
+    DETACH_LINK,
+    SHARE,
+    MATERIALIZE,
+    CHANGE_DIR
+  };
+
+  /**
+   * @brief A record of the undo log.
    *
-   * @param path The relative or absolute path to convert.
-   * @param dir The directory from which relative paths should start.
+   * m_type: The kind of the change.
+   * m_height: Height of a materialized copy before the change.
+   * m_node: The changed node, or the previous current directory.
+   * m_other: The directory of an added or removed child, the target of a link, or the directory a copy-on-write
+   * copy shares children of.
+   */
+  struct Undo_record
+  {
+    UNDO_TYPE m_type;
+    std::uint32_t m_height;
+    Node* m_node;
+    Node* m_other;
+  };
+
+  /**
+   * @brief An entry of the traversal stack.
+   *
+   * m_node: The node to visit.
+   * m_parent: The directory the copy of the node goes to, used by m_copy().
+   * m_depth: The depth of the node, used by m_print().
+   */
+  struct Traversal_entry
+  {
+    Node* m_node;
+    Directory* m_parent;
+    std::size_t m_depth;
+  };
+
+  /**
+   * @brief Task of a parallel copy: copies the children of a directory into its copy.
+   */
+  struct Copy_task
+  {
+    const Directory* m_source;
+    Directory* m_copy;
+  };
+
+  /**
+   * @brief Builds the absolute path of a node by walking up to the drive.
+   *
+   * @param node The file or directory whose path to build.
    * @return The absolute path as a string.
    */
   std::string
-  m_to_absolute_path(std::string_view path, Directory* dir);
+  m_to_absolute_path(const Node* node) const;
+
+  /**
+   * @brief Writes the absolute path of a node into a buffer. The cost is linear in the length of the path, the
+   * buffer's memory is reused between calls.
+   *
+   * @param node The file or directory whose path to write.
+   * @param buffer The buffer that receives the path, its previous content is replaced.
+   */
+  void
+  m_write_absolute_path(const Node* node, std::string& buffer) const;
+
+  /**
+   * @brief Returns the name of a node as it's printed. Names of links are rendered from the current path
+   * of their targets, e.g. "dlink[C:\Dir1\file1.txt]".
+   *
+   * @param node The node whose name to render.
+   * @return The name of the node.
+   */
+  std::string
+  m_display_name(const Node* node) const;
 
   /**
-   * @brief Finds a node in the file system tree by a given path.
+   * @brief Finds a node in the file system tree by a given path, consulting the cache of resolved paths first.
    *
    * @param path The path to search for.
    * @return A pointer to the found node, or nullptr if the node was not found.
@@ -145,28 +634,180 @@ private:
   m_find_node_by_path(std::string_view path);
 
   /**
-   * @brief Creates a new node in the file system tree at the specified path.
+   * @brief Finds a node in the file system tree by walking a given path segment by segment.
+   *
+   * @param path The path to search for.
+   * @return A pointer to the found node, or nullptr if the node was not found.
+   */
+  Node*
+  m_resolve_path(std::string_view path);
+
+  /**
+   * @brief Resolves the parent directory of an MD or MF command of a batch, starting from the longest prefix of
+   * the path resolved earlier in the batch.
+   *
+   * @param path The path to the parent directory as written in the command.
+   * @return A pointer to the found node, or nullptr if the node was not found.
+   */
+  Node*
+  m_find_batch_parent(std::string_view path);
+
+  /**
+   * @brief Creates a new node in the file system tree in the specified directory.
    *
-   * @param path The path where the new node should be created.
+   * @param parent The directory where the new node should be created, as found by its path.
    * @param name The name of the new node.
    * @param type The type of the new node (e.g., file or directory).
-   * @throws std::runtime_error If the specified path is not found or valid.
-   * @return A pointer to the created node.
+   * @throws std::runtime_error If the parent is not found or isn't a directory.
+   * @return A pointer to the created node, or nullptr if the same entity already exists.
    */
   Node*
-  m_make_node(std::string_view path, std::string_view name, NODE_TYPE type);
+  m_make_node(Node* parent, std::string_view name, NODE_TYPE type);
 
   /**
    * @brief Creates a new link (hard or dynamic) and connects it to a source node.
    *
    * @param source The path to the file/directory to which the link will be attached.
    * @param dest The destination path where the new link will be placed.
-   * @param name The name of the new link.
    * @param type The type of the link (hard or dynamic).
-   * @throws std::runtime_error If the source or destination path is not found or is invalid.
+   * @throws std::runtime_error If the source or destination path is not found or is invalid, or if the
+   * source is a link itself.
+   */
+  void
+  m_make_link(std::string_view source, std::string_view dest, NODE_TYPE type);
+
+  /**
+   * @brief Appends a record of a successful operation to the journal, if journaling is on.
+   *
+   * @param type The type of the operation.
+   * @param first The first parameter of the operation.
+   * @param second The second parameter of the operation.
+   */
+  void
+  m_log(COMMAND_TYPE type, std::string_view first, std::string_view second = {});
+
+  /**
+   * @brief Allocates a new detached node of the given type from the pool of that type.
+   *
+   * @param type The type of the new node.
+   * @return A pointer to the allocated node.
+   */
+  Node*
+  m_new_node(NODE_TYPE type);
+
+  /**
+   * @brief Destroys a node and returns its memory to the pool of its type. Children of a directory are
+   * not released. A file or a directory with dynamic links still attached is only marked as removed, it's
+   * released once its links are reclaimed. Inside a transaction the node stays allocated until commit().
+   *
+   * @param node The node to release, has to be already detached from the tree.
+   */
+  void
+  m_free_node(Node* node);
+
+  /**
+   * @brief Returns the memory of a released node to the pool of its type.
+   *
+   * @param node The node to destroy.
+   */
+  void
+  m_destroy_node(Node* node) noexcept;
+
+  /**
+   * @brief Puts back a node released by the open transaction, undoing the bookkeeping of m_free_node().
+   *
+   * @param node The released node, it's added to its directory separately.
+   */
+  void
+  m_restore_node(Node* node);
+
+  /**
+   * @brief Appends a change to the undo log if a transaction is recording. Records are made before the changes, so
+   * a failed change leaves nothing to undo but itself.
+   *
+   * @param type The kind of the change.
+   * @param node The changed node.
+   * @param other The related node, see Undo_record.
+   * @param height The height to restore, see Undo_record.
+   */
+  void
+  m_record(UNDO_TYPE type, Node* node, Node* other = nullptr, std::uint32_t height = 0)
+  {
+    if(m_recording)
+      m_undo_log.push_back({ type, height, node, other });
+  }
+
+  /**
+   * @brief Undoes a single change of the undo log. Later changes have to be undone already.
+   *
+   * @param record The record of the change.
+   */
+  void
+  m_undo(const Undo_record& record);
+
+  /**
+   * @brief Marks a removed file or directory that still has dynamic links attached, so the links become dangling.
+   * Room for the node in m_removed_targets has to be reserved before the removal starts.
+   *
+   * @param node The removed node.
+   * @return True if the node is kept until its links are reclaimed, False if it can be released.
+   */
+  bool
+  m_keep_removed(Linked_node* node) noexcept;
+
+  /**
+   * @brief Detaches a dynamic link from its target, removes it from its directory and releases it.
+   *
+   * @param dlink The dynamic link to release.
+   */
+  void
+  m_release_dlink(Link* dlink);
+
+  /**
+   * @brief Reclaims dangling dynamic links placed in a directory and in its subtree.
+   *
+   * @param dir The directory to reclaim the links of.
+   */
+  void
+  m_release_dangling(Directory* dir);
+
+  /**
+   * @brief Reclaims dangling dynamic links, the most recently removed targets first. A target is released once
+   * all of its links are gone.
+   *
+   * @param budget The maximum number of links to reclaim.
+   */
+  void
+  m_sweep_dlinks(std::size_t budget);
+
+  /**
+   * @brief Adds a child to a directory, updating the fan-out histogram and heights of the directory's ancestors.
+   * Raising heights stops at the first ancestor that is high enough already.
+   *
+   * @param dir The directory to add the child to.
+   * @param child The node to add.
+   */
+  void
+  m_add_child(Directory* dir, Node* child);
+
+  /**
+   * @brief Removes a child from a directory, updating the fan-out histogram and heights of the directory's
+   * ancestors. Children of an ancestor are scanned only if the removed child was the one that made it that high.
+   *
+   * @param dir The directory to remove the child from.
+   * @param child The node to remove.
    */
   void
-  m_make_link(std::string_view source, std::string_view dest, std::string_view name, NODE_TYPE type);
+  m_remove_child(Directory* dir, Node* child);
+
+  /**
+   * @brief Detaches all dynamic links from a file or a directory, see Linked_node::take_dlinks().
+   *
+   * @param node The node to detach the links from.
+   * @return The detached links.
+   */
+  std::vector<Link*>
+  m_take_dlinks(Linked_node* node);
 
   /**
    * @brief Removes a node from the file system tree.
@@ -178,43 +819,192 @@ private:
   m_remove_node(Node* node);
 
   /**
-   * @brief Recursively copies a node (and its subtree) to a new location.
+   * @brief Points a link to its target and registers the link in the target. Counters of hard-linked entities
+   * are updated along the target's chain of ancestors.
+   *
+   * @param link The hard or dynamic link to attach.
+   * @param target The file or directory the link points to.
+   */
+  void
+  m_attach_link(Link* link, Linked_node* target);
+
+  /**
+   * @brief Makes the target of a link forget about the link. The link itself stays in the tree. Counters of
+   * hard-linked entities are updated along the target's chain of ancestors.
+   *
+   * @param link The hard or dynamic link to detach.
+   */
+  void
+  m_detach_link(Link* link);
+
+  /**
+   * @brief Copies a node and its subtree. Directories without links below them are shared instead in the
+   * copy-on-write mode.
+   *
+   * @param source The node to copy from.
+   * @return The copy, not attached to any directory yet.
+   */
+  Node*
+  m_copy(Node* source);
+
+  /**
+   * @brief Copies a single node, a copy of a directory is empty and a copy of a link is attached to its target.
    *
    * @param source The node to copy from.
-   * @param destination The directory where the copied subtree will be placed.
+   * @return The copy, not attached to any directory yet.
+   */
+  Node*
+  m_copy_node(const Node* source);
+
+  /**
+   * @brief Copies a directory and its subtree on the threads of the copy pool. Every thread allocates nodes from
+   * its own pools, links are attached to their targets and nodes are moved to the pools of the emulator once all
+   * threads are done.
+   *
+   * @param source The directory to copy from.
+   * @return The copy, not attached to any directory yet.
+   */
+  Directory*
+  m_parallel_copy(const Directory* source);
+
+  /**
+   * @brief Makes a directory a copy-on-write copy that shares children of another one.
+   *
+   * @param dir The empty directory that becomes the copy.
+   * @param source The directory with children of its own to share.
+   */
+  void
+  m_share(Directory* dir, Directory* source);
+
+  /**
+   * @brief Gives a copy-on-write copy children of its own: files are duplicated, directories share children of
+   * the directories they're copied from. The copy looks the same afterwards.
+   *
+   * @param dir The copy to materialize.
+   */
+  void
+  m_materialize(Directory* dir);
+
+  /**
+   * @brief Prepares a directory for a change of its children. The directory gets children of its own, and copies
+   * sharing children of the directory or of any of its ancestors get private directories down to it, so none of
+   * them sees the change.
+   *
+   * @param dir The directory about to change.
+   */
+  void
+  m_unshare(Directory* dir);
+
+  /**
+   * @brief Prepares a subtree for deletion: copies sharing children of any directory of the subtree are fully
+   * materialized.
+   *
+   * @param dir The root of the subtree.
+   */
+  void
+  m_unshare_subtree(Directory* dir);
+
+  /**
+   * @brief Counts the nodes of a subtree, stopping once a limit is reached.
+   *
+   * @param node The root of the subtree.
+   * @param limit The number of nodes to stop at.
+   * @return The number of nodes of the subtree, or %limit if there are more of them.
+   */
+  std::size_t
+  m_count_nodes(Node* node, std::size_t limit) const;
+
+  /**
+   * @brief Appends the paths a node is seen at below a directory. A node inside a directory shared by copy-on-write
+   * copies is seen through every copy as well.
+   *
+   * @param node The file or directory.
+   * @param root_path The absolute path of the directory, paths outside of it are skipped.
+   * @param paths Receives the paths.
    */
   void
-  m_copy(Node* source, Directory* destination);
+  m_append_visible_paths(const Node* node, std::string_view root_path, std::vector<std::string>& paths) const;
 
   /**
-   * @brief Checks for the presence of hard links attached to a node, recursively examining sub-nodes.
+   * @brief Checks for the presence of hard links attached to a node or to any node of its subtree in O(1),
+   * using the counters maintained by directories.
    *
    * @param node The node to check.
    * @return True if hard links are found, otherwise False.
    */
   bool
-  m_check_on_hlinks(Node* node);
+  m_check_on_hlinks(const Node* node) const noexcept;
 
   /**
-   * @brief Updates the paths of hard and dynamic links associated with a node.
+   * @brief Checks for hard links placed outside of a directory's subtree that are attached to the directory or to
+   * any node below it. Hard links placed inside the subtree are matched with their targets, so the subtree is
+   * walked only when the counter of the directory isn't 0.
    *
-   * @param node The node whose links need to be updated.
+   * @param dir The root of the subtree.
+   * @return True if such hard links are found, otherwise False.
    */
-  void
-  m_update_links(Node* node);
+  bool
+  m_check_on_outer_hlinks(const Directory* dir) const;
 
   /**
-   * @brief Recursively prints a node and its children to the standard output, with indentation representing depth.
+   * @brief Prints a node and its subtree, with indentation representing depth.
    *
    * @param node The node to start printing from.
-   * @param depth The current depth in the tree, used to determine indentation.
+   * @param writer The writer of the output.
    */
   void
-  m_print(Node* node, std::size_t depth) const noexcept;
+  m_print(Node* node, Tree_writer& writer) const;
 
 private:
-  Directory* m_root;         ///> root node of a tree, contains C: drive as it's child.
-  Directory* m_curr_catalog; ///> Pointer to current directory in the tree.
+  Name_table m_names;                 ///> Interned names of all nodes in the tree.
+  Name_index m_index;                 ///> Files and directories of the tree by their names.
+  Node_pool<Directory> m_directories; ///> Storage of all directories of the tree.
+  Node_pool<File> m_files;            ///> Storage of all files of the tree.
+  Node_pool<Link> m_links;            ///> Storage of all hard and dynamic links of the tree.
+  Directory* m_root;                  ///> root node of a tree, contains C: drive as it's child.
+  Directory* m_curr_catalog;          ///> Pointer to current directory in the tree.
+  std::string m_curr_catalog_path;    ///> Absolute path of the current directory.
+  Path_cache m_path_cache;            ///> Nodes by their absolute paths, dropped when the nodes move or get removed.
+  std::string m_path_buffer;          ///> Reusable buffer for building absolute paths.
+
+  mutable std::vector<Traversal_entry> m_traversal; ///> Reusable stack of traversals, keeps deep trees off the call stack.
+
+  std::unordered_map<std::string_view, Directory*> m_batch_parents; ///> Directories resolved by the current batch.
+
+  std::unique_ptr<Node_table> m_table; ///> Compact storage of the tree, nullptr unless it's turned on.
+
+  Journal m_journal;        ///> Journal of operations, closed unless journaling is on.
+  std::uint64_t m_sequence; ///> Sequence number of the next journal record.
+
+  mutable std::mutex m_view_mutex;           ///> Guards m_view, held only to copy or replace the pointer.
+  std::shared_ptr<const Tree_view> m_view;   ///> Last published view, shared with readers.
+  std::atomic<std::uint64_t> m_view_version; ///> Version of the last published view, 0 until the first one.
+  Listing_cache m_view_listings;             ///> Listings of the last published view and directories changed since.
+
+  std::size_t m_parallel_copy_threshold;                    ///> Minimum size of a subtree copied in parallel, 0 if off.
+  std::size_t m_copy_threads;                               ///> Number of threads of a parallel copy.
+  std::unique_ptr<Task_pool<Copy_task>> m_copy_pool;        ///> Threads of parallel copies, started by the first one.
+  std::vector<std::unique_ptr<Copy_worker>> m_copy_workers; ///> Node storage of every thread of a parallel copy.
+
+  bool m_copy_on_write;       ///> Tells whether copies share subtrees of their sources.
+  std::size_t m_sharing_dirs; ///> Number of copy-on-write copies that share children of another directory.
+
+  std::array<std::size_t, FANOUT_BUCKETS> m_fanout; ///> Fan-out histogram of directories below the root, see Stats.
+  std::size_t m_linked_nodes;                       ///> Number of files and directories with links attached to them.
+
+  bool m_deferred_dlinks;                       ///> Tells whether dynamic links of removed entities are left dangling.
+  std::vector<Linked_node*> m_removed_targets; ///> Removed files and directories waiting for their links to go.
+  std::size_t m_removed_dirs;                  ///> Number of directories in m_removed_targets.
+  std::size_t m_dangling_links;                ///> Number of dynamic links attached to m_removed_targets.
+
+  bool m_in_transaction;                      ///> Tells whether a transaction is open.
+  bool m_recording;                           ///> Tells whether changes go to the undo log, off while it's replayed.
+  std::vector<Undo_record> m_undo_log;        ///> Changes made by the open transaction, in order.
+  std::array<std::size_t, 4> m_retired_nodes; ///> Nodes released by the open transaction by NODE_TYPE.
+
+#ifdef FSE_PROFILE
+  mutable Profiler m_profiler; ///> Counters of work and latencies of commands, print() is profiled as well.
+#endif
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,179 @@
+#ifndef __JOURNAL_HPP__
+#define __JOURNAL_HPP__
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "command.hpp"
+
+/**
+ * @brief Header of a journal file.
+ *
+ * m_magic: Equals JOURNAL_MAGIC.
+ * m_version: Version of the format.
+ * m_reserved: Always 0.
+ * m_sequence: Sequence number of the first record of the journal.
+ */
+struct Journal_header
+{
+  char m_magic[8];
+  std::uint32_t m_version;
+  std::uint32_t m_reserved;
+  std::uint64_t m_sequence;
+};
+
+/**
+ * @brief Fixed part of a journal record, it's followed by the characters of its parameters.
+ *
+ * m_checksum: FNV-1a hash of the rest of the record, detects records torn by a crash.
+ * m_type: COMMAND_TYPE of the journaled operation.
+ * m_argc: Number of parameters of the operation.
+ * m_sizes: Lengths of the parameters.
+ */
+struct Journal_record
+{
+  std::uint32_t m_checksum;
+  std::uint16_t m_type;
+  std::uint16_t m_argc;
+  std::uint32_t m_sizes[2];
+};
+
+/**
+ * @brief Magic bytes every journal starts with.
+ */
+inline constexpr char JOURNAL_MAGIC[8] = "FSEJRNL";
+
+/**
+ * @brief Version of the journal format, bumped on every incompatible change.
+ */
+inline constexpr std::uint32_t JOURNAL_VERSION = 1;
+
+/**
+ * @class Journal
+ *
+ * Append-only binary log of operations applied to a file system. Records are buffered and reach the disk in
+ * groups: one write and one fsync per group of records, so the cost of an fsync is shared by the whole group.
+ * Records of a group that wasn't committed yet are lost on a crash, a record torn by a crash is dropped on
+ * the next read.
+ */
+class Journal
+{
+public:
+  /**
+   * @brief Default number of records committed with one fsync.
+   */
+  static constexpr std::size_t DEFAULT_GROUP_SIZE = 64;
+
+  Journal() noexcept;
+
+  Journal(const Journal&) = delete;
+
+  Journal&
+  operator=(const Journal&) = delete;
+
+  /**
+   * @brief Commits pending records and closes the journal.
+   */
+  ~Journal();
+
+  /**
+   * @brief Opens a journal for appending, the file is created if it doesn't exist. A torn record at the end of an
+   * existing journal is cut off.
+   *
+   * @param path The path to the journal file.
+   * @param sequence Sequence number the next record gets, has to match the end of an existing journal.
+   * @param group_size Number of records committed with one fsync, at least 1.
+   * @throws std::runtime_error If the file can't be opened, isn't a journal or doesn't end at %sequence.
+   */
+  void
+  open(const std::string& path, std::uint64_t sequence, std::size_t group_size);
+
+  /**
+   * @brief Commits pending records and closes the journal, does nothing if it's not open.
+   */
+  void
+  close();
+
+  /**
+   * @brief Tells whether the journal is open.
+   */
+  bool
+  is_open() const noexcept
+  {
+    return m_fd != -1;
+  }
+
+  /**
+   * @brief Appends a record of an applied operation, commits the group once it's full.
+   *
+   * @param command The operation.
+   * @throws std::runtime_error If a commit fails or the journal has failed before.
+   */
+  void
+  append(const Command& command);
+
+  /**
+   * @brief Writes pending records to the file and waits until they're on the disk. If that fails, the file is cut
+   * back to the end of the last commit and the records stay pending, so a retry writes them once. If the file
+   * can't be cut back, the journal fails and refuses further records until it's opened again.
+   *
+   * @throws std::runtime_error If the records can't be written or the journal has failed before.
+   */
+  void
+  commit();
+
+  /**
+   * @brief Drops all records, e.g. once they're saved by a snapshot.
+   *
+   * @param sequence Sequence number the next record gets.
+   * @throws std::runtime_error If the file can't be rewritten.
+   */
+  void
+  reset(std::uint64_t sequence);
+
+  /**
+   * @brief Reads the records of a journal in order, records torn by a crash end the journal.
+   *
+   * @param path The path to the journal file.
+   * @param sequence Sequence number of the first record to read, earlier records are skipped.
+   * @param apply Receives the records in batches, parameters refer to the file and stay valid during the call.
+   * @return Sequence number following the last record of the journal.
+   * @throws std::runtime_error If the file can't be read or isn't a journal.
+   */
+  static std::uint64_t
+  replay(const std::string& path, std::uint64_t sequence, const std::function<void(std::span<const Command>)>& apply);
+
+private:
+  /**
+   * @brief Writes a header followed by no records.
+   */
+  void
+  m_write_header(std::uint64_t sequence);
+
+  /**
+   * @brief Writes the whole buffer to the file.
+   */
+  void
+  m_write(const char* data, std::size_t size);
+
+  /**
+   * @brief Throws if the journal has failed.
+   */
+  void
+  m_check_on_failure() const;
+
+private:
+  int m_fd;                   ///> Descriptor of the journal file, -1 if the journal is closed.
+  std::size_t m_group_size;   ///> Number of records committed with one fsync.
+  std::size_t m_pending;      ///> Number of buffered records.
+  std::vector<char> m_buffer; ///> Buffered records not written to the file yet.
+  off_t m_end;                ///> Size of the file up to the end of the last commit.
+  bool m_is_failed;           ///> Whether the file may hold a torn commit it couldn't be cut back from.
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef __MAPPED_FILE_HPP__
+#define __MAPPED_FILE_HPP__
+
+#include <cstddef>
+
+/**
+ * @class Mapped_file
+ *
+ * Read-only memory mapping of a whole file. The content is paged in by the kernel on demand, so opening a file
+ * costs the same regardless of its size.
+ */
+class Mapped_file
+{
+public:
+  /**
+   * @brief Maps a file into memory.
+   *
+   * @param path The path to the file, is_open() tells whether it was mapped.
+   */
+  explicit Mapped_file(const char* path) noexcept;
+
+  /**
+   * @brief Maps a file opened by the caller into memory.
+   *
+   * @param fd The descriptor of the file, it stays owned by the caller. is_open() is false for anything but a
+   * regular file.
+   */
+  explicit Mapped_file(int fd) noexcept;
+
+  Mapped_file(const Mapped_file&) = delete;
+
+  Mapped_file&
+  operator=(const Mapped_file&) = delete;
+
+  ~Mapped_file();
+
+  /**
+   * @brief Tells whether the file was opened. An empty file is open and has no data.
+   */
+  bool
+  is_open() const noexcept
+  {
+    return m_is_open;
+  }
+
+  /**
+   * @brief Returns the content of the file, nullptr for empty files.
+   */
+  const char*
+  data() const noexcept
+  {
+    return m_data;
+  }
+
+  /**
+   * @brief Returns the size of the file in bytes.
+   */
+  std::size_t
+  size() const noexcept
+  {
+    return m_size;
+  }
+
+private:
+  /**
+   * @brief Maps a regular file from its descriptor, leaves the file closed for anything else.
+   */
+  void
+  m_map(int fd) noexcept;
+
+  const char* m_data; ///> Mapped content of the file, nullptr for empty files.
+  std::size_t m_size; ///> Size of the file in bytes.
+  bool m_is_open;     ///> Whether the file was opened.
+};
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef __NAME_INDEX_HPP__
+#define __NAME_INDEX_HPP__
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "base.hpp"
+#include "name_table.hpp"
+
+/**
+ * @class Name_index
+ *
+ * Files and directories of a tree by their names, so nodes of a name are found without walking the tree. Nodes
+ * of every name are kept in a list in no particular order, a node is removed by moving the last node of the list
+ * into its place. Lists with more than LINEAR_SEARCH_LIMIT nodes find that place through an open addressing table
+ * of positions keyed by addresses of nodes. Names are also grouped by their extensions, so patterns like "*.tmp"
+ * check only names with the right extension.
+ */
+class Name_index
+{
+public:
+  /**
+   * @brief Number of nodes of a name up to which a node is looked up by a linear scan of the list.
+   */
+  static constexpr std::size_t LINEAR_SEARCH_LIMIT = 16;
+
+  /**
+   * @brief Creates an empty index of names of a table.
+   *
+   * @param names The table the names of indexed nodes come from, has to outlive the index.
+   */
+  explicit Name_index(const Name_table& names) noexcept
+      : m_names(names), m_entries(), m_extensions(), m_size(0), m_table_slots(0){};
+
+  Name_index(const Name_index&) = delete;
+
+  Name_index&
+  operator=(const Name_index&) = delete;
+
+  /**
+   * @brief Adds a named file or directory to the index.
+   *
+   * @param node The node to add, its name has to be set.
+   */
+  void
+  insert(Node* node);
+
+  /**
+   * @brief Removes a file or directory from the index in O(1).
+   *
+   * @param node The node to remove, its name has to be the one it was added with.
+   */
+  void
+  erase(Node* node) noexcept;
+
+  /**
+   * @brief Removes all nodes from the index.
+   */
+  void
+  clear() noexcept;
+
+  /**
+   * @brief Returns the nodes with the given name.
+   */
+  std::span<Node* const>
+  nodes(Name_id name) const noexcept
+  {
+    if(name >= m_entries.size())
+      return {};
+    return m_entries[name].m_nodes;
+  }
+
+  /**
+   * @brief Returns identifiers of names with the given extension, the part after the last dot. Names without a dot
+   * have an empty extension. Names stay in the list even if no node has them anymore.
+   */
+  std::span<const Name_id>
+  with_extension(std::string_view extension) const noexcept;
+
+  /**
+   * @brief Returns the number of name identifiers known to the index, every smaller identifier may have nodes.
+   */
+  std::size_t
+  names() const noexcept
+  {
+    return m_entries.size();
+  }
+
+  /**
+   * @brief Returns the number of indexed nodes.
+   */
+  std::size_t
+  size() const noexcept
+  {
+    return m_size;
+  }
+
+  /**
+   * @brief Returns the memory of the lists and tables of the index, spare capacity isn't counted.
+   */
+  std::size_t
+  bytes() const noexcept
+  {
+    return m_entries.size() * (sizeof(Entry) + sizeof(Name_id)) + m_size * sizeof(Node*)
+           + m_table_slots * sizeof(std::uint32_t);
+  }
+
+  /**
+   * @brief Matches a name against a pattern, where '*' stands for any sequence of characters, '?' for any single
+   * character and every other character for itself.
+   *
+   * @param pattern The pattern.
+   * @param name The name to match.
+   * @return True if the whole name matches the pattern.
+   */
+  static bool
+  matches(std::string_view pattern, std::string_view name) noexcept;
+
+private:
+  /**
+   * @brief Nodes of a single name.
+   *
+   * m_nodes: The nodes in no particular order.
+   * m_table: Positions in m_nodes plus one by addresses of nodes, 0 for an empty slot. Exists only for lists with
+   * more than LINEAR_SEARCH_LIMIT nodes.
+   * m_table_mask: Number of slots of m_table minus one.
+   */
+  struct Entry
+  {
+    std::vector<Node*> m_nodes;
+    std::unique_ptr<std::uint32_t[]> m_table;
+    std::uint32_t m_table_mask = 0;
+  };
+
+  /**
+   * @brief Returns the slot of the table of an entry a node hashes to, addresses are spread by Fibonacci hashing.
+   */
+  static std::size_t
+  m_home(const Entry& entry, const Node* node) noexcept
+  {
+    return static_cast<std::size_t>((reinterpret_cast<std::uintptr_t>(node) * 0x9E3779B97F4A7C15ull) >> 32)
+           & entry.m_table_mask;
+  }
+
+  /**
+   * @brief Returns the slot of the table of an entry that holds the position of a node.
+   */
+  static std::size_t
+  m_find_slot(const Entry& entry, const Node* node) noexcept;
+
+  /**
+   * @brief Adds the position of the last node of an entry to its table. The table is built once the list outgrows
+   * LINEAR_SEARCH_LIMIT and is rebuilt twice as large once it's three quarters full.
+   */
+  static void
+  m_table_insert(Entry& entry);
+
+  /**
+   * @brief Removes a slot of the table of an entry, shifting the entries that follow it back.
+   */
+  static void
+  m_table_erase(Entry& entry, std::size_t slot) noexcept;
+
+private:
+  const Name_table& m_names;                                                ///> Table of names of indexed nodes.
+  std::vector<Entry> m_entries;                                             ///> Nodes by identifiers of their names.
+  std::unordered_map<std::string_view, std::vector<Name_id>> m_extensions; ///> Names known to the index by extension.
+  std::size_t m_size;                                                       ///> Number of indexed nodes.
+  std::size_t m_table_slots;                                                ///> Number of slots of all tables.
+};
+
+#endif
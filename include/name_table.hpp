@@ -0,0 +1,116 @@
+#ifndef __NAME_TABLE_HPP__
+#define __NAME_TABLE_HPP__
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Compact identifier of an interned name. Equal names always get equal identifiers, so names
+ * can be compared as integers.
+ */
+using Name_id = std::uint32_t;
+
+/**
+ * @class Name_table
+ *
+ * Interns node names so every distinct name is stored exactly once. Characters are packed into large
+ * chunks that are never moved or freed while the table is alive, thus views returned by the table stay
+ * valid for its whole lifetime. Identifier 0 is reserved for the empty name.
+ */
+class Name_table
+{
+public:
+  /**
+   * @brief Sentinel returned by find() when a name has never been interned.
+   */
+  static constexpr Name_id npos = static_cast<Name_id>(-1);
+
+  /**
+   * @brief Usage statistics of the table.
+   *
+   * m_names: Number of distinct names stored.
+   * m_bytes: Number of bytes occupied by characters of the stored names.
+   * m_capacity: Number of bytes allocated for characters, including unused tail of the last chunk.
+   * m_interns: Number of intern() requests.
+   * m_reuses: Number of intern() requests that were served by an already stored name.
+   */
+  struct Stats
+  {
+    std::size_t m_names;
+    std::size_t m_bytes;
+    std::size_t m_capacity;
+    std::size_t m_interns;
+    std::size_t m_reuses;
+  };
+
+  Name_table();
+
+  Name_table(const Name_table&) = delete;
+
+  Name_table&
+  operator=(const Name_table&) = delete;
+
+  /**
+   * @brief Returns an identifier of a name, storing the name if it's seen for the first time.
+   *
+   * @param name The name to intern.
+   * @return The identifier of the name.
+   */
+  Name_id
+  intern(std::string_view name);
+
+  /**
+   * @brief Looks up an identifier of a name without storing it.
+   *
+   * @param name The name to look up.
+   * @return The identifier of the name, or npos if the name is not in the table.
+   */
+  Name_id
+  find(std::string_view name) const noexcept;
+
+  /**
+   * @brief Returns the characters of an interned name.
+   *
+   * @param id The identifier of the name.
+   * @return A view that stays valid as long as the table is alive.
+   */
+  std::string_view
+  name(Name_id id) const noexcept
+  {
+    return m_views[id];
+  }
+
+  /**
+   * @brief Returns current usage statistics of the table.
+   */
+  Stats
+  stats() const noexcept;
+
+private:
+  /**
+   * @brief Copies characters of a name into chunk storage.
+   *
+   * @param name The name to store.
+   * @return A view of the stored copy.
+   */
+  std::string_view
+  m_store(std::string_view name);
+
+private:
+  static constexpr std::size_t CHUNK_SIZE = 64 * 1024;
+
+  std::vector<std::unique_ptr<char[]>> m_chunks; ///> Storage of characters, filled one after another.
+  std::size_t m_chunk_used;                      ///> Number of used bytes in the last chunk.
+  std::size_t m_capacity;                        ///> Total number of allocated bytes in all chunks.
+  std::size_t m_bytes;                           ///> Total number of stored characters.
+  std::size_t m_interns;                         ///> Number of intern() requests.
+  std::size_t m_reuses;                          ///> Number of intern() requests that hit an existing name.
+
+  std::vector<std::string_view> m_views;                 ///> Stored names by their identifiers.
+  std::unordered_map<std::string_view, Name_id> m_ids; ///> Identifiers by stored names.
+};
+
+#endif
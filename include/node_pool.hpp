@@ -0,0 +1,251 @@
+#ifndef __NODE_POOL_HPP__
+#define __NODE_POOL_HPP__
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @class Node_pool
+ *
+ * Slab allocator for nodes of a single type. Objects are placed into slots of large slabs that grow
+ * geometrically, slots of destroyed objects are kept in a free list and handed out again before the pool
+ * takes a fresh slot. Destroying the pool releases all slabs at once; destructors of the objects that are
+ * still alive are run only if the type actually has a non-trivial destructor.
+ *
+ * @tparam T Type of the objects stored in the pool.
+ */
+template <typename T>
+class Node_pool
+{
+  union Slot
+  {
+    Slot* m_next;
+    alignas(T) unsigned char m_storage[sizeof(T)];
+  };
+
+  struct Slab
+  {
+    std::unique_ptr<Slot[]> m_slots;
+    std::size_t m_size;
+  };
+
+public:
+  Node_pool() noexcept : m_slabs(), m_used(0), m_free(nullptr), m_live(0), m_capacity(0){};
+
+  Node_pool(const Node_pool&) = delete;
+
+  Node_pool&
+  operator=(const Node_pool&) = delete;
+
+  ~Node_pool()
+  {
+    clear();
+  }
+
+  /**
+   * @brief Constructs a new object in a free slot of the pool.
+   *
+   * @param args Arguments forwarded to the constructor of T.
+   * @return A pointer to the constructed object.
+   */
+  template <typename... Args>
+  T*
+  create(Args&&... args)
+  {
+    Slot* slot__ = m_free;
+
+    if(slot__)
+      m_free = slot__->m_next;
+    else
+      {
+        if(m_slabs.empty() || m_used == m_slabs.back().m_size)
+          m_grow();
+
+        slot__ = &m_slabs.back().m_slots[m_used++];
+      }
+
+    ++m_live;
+    return ::new(static_cast<void*>(slot__->m_storage)) T(std::forward<Args>(args)...);
+  }
+
+  /**
+   * @brief Destroys an object and returns its slot to the free list.
+   *
+   * @param object The object to destroy, has to be created by this pool.
+   */
+  void
+  destroy(T* object) noexcept
+  {
+    object->~T();
+    m_release(reinterpret_cast<Slot*>(object));
+
+    --m_live;
+  }
+
+  /**
+   * @brief Takes over all objects and memory of another pool, e.g. one filled by another thread. Objects stay
+   * where they are and are destroyed through this pool from now on.
+   *
+   * @param other The pool to take from, it's left empty.
+   */
+  void
+  merge(Node_pool& other)
+  {
+    if(other.m_slabs.empty())
+      return;
+
+    m_slabs.reserve(m_slabs.size() + other.m_slabs.size());
+
+    // Only the last slab takes fresh slots, so slots the other pool has never handed out become free ones.
+    Slab& last__ = other.m_slabs.back();
+
+    for(std::size_t i = other.m_used; i < last__.m_size; ++i)
+      m_release(&last__.m_slots[i]);
+
+    for(Slot* slot__ = other.m_free; slot__;)
+      {
+        Slot* next__ = slot__->m_next;
+        m_release(slot__);
+        slot__ = next__;
+      }
+
+    // Own last slab stays the last one, unless there is none.
+    if(m_slabs.empty())
+      m_used = last__.m_size;
+
+    m_slabs.insert(m_slabs.begin(), std::make_move_iterator(other.m_slabs.begin()),
+                   std::make_move_iterator(other.m_slabs.end()));
+
+    m_live += other.m_live;
+    m_capacity += other.m_capacity;
+
+    other.m_slabs.clear();
+    other.m_used = 0;
+    other.m_free = nullptr;
+    other.m_live = 0;
+    other.m_capacity = 0;
+  }
+
+  /**
+   * @brief Destroys all objects that are still alive and releases memory of the pool.
+   */
+  void
+  clear() noexcept
+  {
+    if constexpr(!std::is_trivially_destructible_v<T>)
+      {
+        if(m_live != 0)
+          m_destroy_live();
+      }
+
+    m_slabs.clear();
+    m_used = 0;
+    m_free = nullptr;
+    m_live = 0;
+    m_capacity = 0;
+  }
+
+  /**
+   * @brief Returns the number of objects that are alive.
+   */
+  std::size_t
+  size() const noexcept
+  {
+    return m_live;
+  }
+
+  /**
+   * @brief Returns the number of slots allocated by the pool.
+   */
+  std::size_t
+  capacity() const noexcept
+  {
+    return m_capacity;
+  }
+
+private:
+  /**
+   * @brief Puts a slot on the free list.
+   */
+  void
+  m_release(Slot* slot) noexcept
+  {
+    slot->m_next = m_free;
+    m_free = slot;
+  }
+
+  /**
+   * @brief Allocates a new slab twice as large as the previous one, up to MAX_SLAB_SIZE slots.
+   */
+  void
+  m_grow()
+  {
+    std::size_t size__ = m_slabs.empty() ? MIN_SLAB_SIZE : std::min(m_slabs.back().m_size * 2, MAX_SLAB_SIZE);
+
+    m_slabs.push_back({ std::make_unique<Slot[]>(size__), size__ });
+    m_used = 0;
+    m_capacity += size__;
+  }
+
+  /**
+   * @brief Runs destructors of all objects that are still alive. Free slots are told apart from the live ones
+   * by walking the free list once.
+   */
+  void
+  m_destroy_live() noexcept
+  {
+    // Slabs sorted by their addresses, so the slab of a free slot can be found by a binary search.
+    std::vector<std::size_t> order__(m_slabs.size());
+
+    for(std::size_t i = 0; i < order__.size(); ++i)
+      order__[i] = i;
+
+    std::sort(order__.begin(), order__.end(), [this](std::size_t lhs, std::size_t rhs) {
+      return std::less<Slot*>()(m_slabs[lhs].m_slots.get(), m_slabs[rhs].m_slots.get());
+    });
+
+    std::vector<std::vector<bool>> is_free__(m_slabs.size());
+
+    for(std::size_t i = 0; i < m_slabs.size(); ++i)
+      is_free__[i].resize(m_slabs[i].m_size, false);
+
+    for(Slot* slot__ = m_free; slot__; slot__ = slot__->m_next)
+      {
+        auto it__ = std::upper_bound(order__.begin(), order__.end(), slot__, [this](Slot* slot, std::size_t idx) {
+          return std::less<Slot*>()(slot, m_slabs[idx].m_slots.get());
+        });
+
+        std::size_t slab_idx__ = *(it__ - 1);
+        is_free__[slab_idx__][slot__ - m_slabs[slab_idx__].m_slots.get()] = true;
+      }
+
+    for(std::size_t i = 0; i < m_slabs.size(); ++i)
+      {
+        // Only the last slab may be partially used.
+        std::size_t used__ = (i + 1 == m_slabs.size()) ? m_used : m_slabs[i].m_size;
+
+        for(std::size_t j = 0; j < used__; ++j)
+          if(!is_free__[i][j])
+            reinterpret_cast<T*>(m_slabs[i].m_slots[j].m_storage)->~T();
+      }
+  }
+
+private:
+  static constexpr std::size_t MIN_SLAB_SIZE = 64;
+  static constexpr std::size_t MAX_SLAB_SIZE = 64 * 1024;
+
+  std::vector<Slab> m_slabs; ///> Allocated slabs, only the last one takes fresh slots.
+  std::size_t m_used;        ///> Number of slots of the last slab that have been handed out at least once.
+  Slot* m_free;              ///> Head of the list of slots that were released.
+  std::size_t m_live;        ///> Number of objects that are alive.
+  std::size_t m_capacity;    ///> Total number of slots in all slabs.
+};
+
+#endif
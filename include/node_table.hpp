@@ -0,0 +1,454 @@
+#ifndef __NODE_TABLE_HPP__
+#define __NODE_TABLE_HPP__
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "base.hpp"
+#include "name_table.hpp"
+
+/**
+ * @class Node_table
+ *
+ * Compact storage of a file system tree for File_system_emulator::set_compact_storage(). Entities are addressed by
+ * 32-bit indices and every field lives in an array of its own, so an entity takes NODE_BYTES and a walk over the
+ * tree touches only the fields it reads. Children of a directory form a doubly linked list in no particular order,
+ * links attached to a file or a directory form another one, so an entity leaves either list in O(1). Directories with more than LINEAR_SEARCH_LIMIT files
+ * and directories get an open addressing table of children by name, the only per-directory allocation.
+ *
+ * Slots of removed entities are reused by new ones, the arrays never shrink. Errors and their messages are the same
+ * as of the emulator.
+ */
+class Node_table
+{
+public:
+  /**
+   * @brief Index of no entity, e.g. the parent of the drive.
+   */
+  static constexpr std::uint32_t npos = static_cast<std::uint32_t>(-1);
+
+  /**
+   * @brief Index of the drive, it's never removed.
+   */
+  static constexpr std::uint32_t DRIVE = 0;
+
+  /**
+   * @brief Number of files and directories up to which a child is looked up by a walk of the list of children.
+   */
+  static constexpr std::size_t LINEAR_SEARCH_LIMIT = 16;
+
+  /**
+   * @brief Memory of a single entity in the arrays of the table.
+   */
+  static constexpr std::size_t NODE_BYTES = sizeof(NODE_TYPE) + 6 * sizeof(std::uint32_t);
+
+  /**
+   * @brief Makes a table with just the drive, which is the current directory.
+   *
+   * @param names The table of names of the emulator, it has to outlive this table.
+   */
+  explicit Node_table(Name_table& names);
+
+  Node_table(const Node_table&) = delete;
+
+  Node_table&
+  operator=(const Node_table&) = delete;
+
+  /**
+   * @brief Creates a directory, see File_system_emulator::make_dir().
+   */
+  void
+  make_dir(std::string_view path);
+
+  /**
+   * @brief Creates a file, see File_system_emulator::make_file().
+   */
+  void
+  make_file(std::string_view path);
+
+  /**
+   * @brief Creates a hard link, see File_system_emulator::make_hlink().
+   */
+  void
+  make_hlink(std::string_view source, std::string_view dest);
+
+  /**
+   * @brief Creates a dynamic link, see File_system_emulator::make_dlink().
+   */
+  void
+  make_dlink(std::string_view source, std::string_view dest);
+
+  /**
+   * @brief Changes the current directory, see File_system_emulator::change_dir().
+   */
+  void
+  change_dir(std::string_view path);
+
+  /**
+   * @brief Removes an empty directory, see File_system_emulator::remove_dir().
+   */
+  void
+  remove_dir(std::string_view path);
+
+  /**
+   * @brief Removes a file or a link, see File_system_emulator::remove_file().
+   */
+  void
+  remove_file(std::string_view path);
+
+  /**
+   * @brief Copies an entity with its subtree, see File_system_emulator::copy().
+   */
+  void
+  copy(std::string_view source, std::string_view dest);
+
+  /**
+   * @brief Moves an entity with its subtree, see File_system_emulator::move().
+   */
+  void
+  move(std::string_view source, std::string_view dest);
+
+  /**
+   * @brief Deletes a directory with its subtree, see File_system_emulator::delete_tree().
+   */
+  void
+  delete_tree(std::string_view path);
+
+  /**
+   * @brief Finds files and directories whose names match a pattern by a walk of the subtree of the root, see
+   * File_system_emulator::find().
+   */
+  std::vector<std::string>
+  find(std::string_view pattern, std::string_view root) const;
+
+  /**
+   * @brief Prints the structure of the tree the same way File_system_emulator::print() does. Children of every
+   * directory are sorted while printing, as the table keeps them in no particular order.
+   *
+   * @param stream The stream to print to.
+   */
+  void
+  print(std::ostream& stream) const;
+
+  /**
+   * @brief Returns the number of entities of the tree including the drive.
+   */
+  std::size_t
+  size() const noexcept
+  {
+    return m_types.size() - m_free_slots;
+  }
+
+  /**
+   * @brief Returns the number of entities of the given type, the drive counts as a directory.
+   */
+  std::size_t
+  count(NODE_TYPE type) const noexcept
+  {
+    return m_counts[static_cast<std::size_t>(type)];
+  }
+
+  /**
+   * @brief Returns the memory of the arrays of entities, spare capacity isn't counted.
+   */
+  std::size_t
+  node_bytes() const noexcept
+  {
+    return m_types.size() * NODE_BYTES;
+  }
+
+  /**
+   * @brief Returns the memory of the tables of children of large directories and of the counters of hard links.
+   */
+  std::size_t
+  index_bytes() const noexcept;
+
+  /**
+   * @brief Returns the memory allocated for entities that isn't used, spare capacity and slots of removed entities.
+   */
+  std::size_t
+  slack_bytes() const noexcept
+  {
+    return (m_types.capacity() - m_types.size() + m_free_slots) * NODE_BYTES;
+  }
+
+  /**
+   * @brief Visits every directory of the tree in pre-order without allocating memory, the walk follows the indices
+   * of parents back up.
+   *
+   * @param visitor Called with the depth of a directory, 0 for the drive, and the number of its children.
+   */
+  template <typename Visitor>
+  void
+  visit_directories(Visitor&& visitor) const noexcept
+  {
+    std::uint32_t node__ = DRIVE;
+    std::size_t depth__ = 0;
+
+    while(true)
+      {
+        if(m_types[node__] == NODE_TYPE::DIRECTORY)
+          {
+            std::size_t childs__ = 0;
+
+            for(std::uint32_t child__ = m_first_childs[node__]; child__ != npos; child__ = m_next_siblings[child__])
+              ++childs__;
+
+            visitor(depth__, childs__);
+
+            if(m_first_childs[node__] != npos)
+              {
+                node__ = m_first_childs[node__];
+                ++depth__;
+                continue;
+              }
+          }
+
+        // Climb until a directory with a next sibling, the drive has none.
+        while(node__ != DRIVE && m_next_siblings[node__] == npos)
+          {
+            node__ = m_parents[node__];
+            --depth__;
+          }
+
+        if(node__ == DRIVE)
+          return;
+
+        node__ = m_next_siblings[node__];
+      }
+  }
+
+private:
+  /**
+   * @brief Table of files and directories of a large directory by their names.
+   *
+   * m_slots: Open addressing slots holding indices of children, npos for an empty slot. The size is a power of two.
+   * m_named: Number of files and directories of the directory.
+   */
+  struct Child_table
+  {
+    std::vector<std::uint32_t> m_slots;
+    std::uint32_t m_named;
+  };
+
+  /**
+   * @brief Index of the root above the drive a resolution of an absolute path starts at, the drive is its only child.
+   */
+  static constexpr std::uint32_t ROOT = npos - 1;
+
+  /**
+   * @brief Parent index of entities of a subtree being deleted, see delete_tree().
+   */
+  static constexpr std::uint32_t DELETED = npos - 2;
+
+  /**
+   * @brief Tells whether an entity is a hard or a dynamic link.
+   */
+  bool
+  m_is_link(std::uint32_t node) const noexcept
+  {
+    return m_types[node] == NODE_TYPE::HLINK || m_types[node] == NODE_TYPE::DLINK;
+  }
+
+  /**
+   * @brief Takes a slot for a new detached entity, a slot of a removed one if there is any.
+   *
+   * @param type The type of the entity.
+   * @param name The name of a file or a directory, the index of the target of a link.
+   * @return The index of the entity.
+   */
+  std::uint32_t
+  m_allocate(NODE_TYPE type, std::uint32_t name);
+
+  /**
+   * @brief Puts the slot of a detached entity on the list of free slots.
+   *
+   * @param node The index of the entity.
+   */
+  void
+  m_release(std::uint32_t node);
+
+  /**
+   * @brief Finds an entity by its path, an empty path is the current directory.
+   *
+   * @return The index of the entity, or npos if the path doesn't exist.
+   */
+  std::uint32_t
+  m_find(std::string_view path) const;
+
+  /**
+   * @brief Finds a file or a directory among children of a directory by its name.
+   *
+   * @param dir The directory, or ROOT.
+   * @param name The name of the child.
+   * @return The index of the child, or npos if there is no such child.
+   */
+  std::uint32_t
+  m_find_named(std::uint32_t dir, Name_id name) const noexcept;
+
+  /**
+   * @brief Finds a link of a directory by walking the links attached to the target.
+   *
+   * @param dir The directory.
+   * @param type The type of the link.
+   * @param target The file or directory the link points to.
+   * @return The index of the link, or npos if there is no such link.
+   */
+  std::uint32_t
+  m_find_link(std::uint32_t dir, NODE_TYPE type, std::uint32_t target) const noexcept;
+
+  /**
+   * @brief Finds a child of a directory with the same key as an entity: the name of a file or a directory, the
+   * type and the target of a link.
+   */
+  std::uint32_t
+  m_find_same(std::uint32_t dir, std::uint32_t node) const noexcept;
+
+  /**
+   * @brief Creates a file or a directory, see File_system_emulator::m_make_node().
+   */
+  void
+  m_make_node(std::string_view path, NODE_TYPE type);
+
+  /**
+   * @brief Creates a hard or a dynamic link, see File_system_emulator::m_make_link().
+   */
+  void
+  m_make_link(std::string_view source, std::string_view dest, NODE_TYPE type);
+
+  /**
+   * @brief Removes a file, an empty directory or a link with the dynamic links attached to it.
+   *
+   * @throws std::runtime_error If hard links are attached to the entity.
+   */
+  void
+  m_remove_node(std::uint32_t node);
+
+  /**
+   * @brief Puts an entity at the head of the list of children of a directory. A table of children is built once
+   * the directory has more than LINEAR_SEARCH_LIMIT files and directories.
+   */
+  void
+  m_add_child(std::uint32_t dir, std::uint32_t child);
+
+  /**
+   * @brief Unlinks an entity from the list of children of its parent in O(1).
+   */
+  void
+  m_remove_child(std::uint32_t child);
+
+  /**
+   * @brief Points a link to its target and puts it at the head of the links of the target. A hard link is counted
+   * by the target and by all its ancestors.
+   */
+  void
+  m_attach_link(std::uint32_t link, std::uint32_t target);
+
+  /**
+   * @brief Unlinks a link from the links of its target and takes a hard link off the counters. The link stays in
+   * the tree.
+   */
+  void
+  m_detach_link(std::uint32_t link);
+
+  /**
+   * @brief Unlinks a link from the links of its target in O(1), counters stay as they are.
+   */
+  void
+  m_unlink_link(std::uint32_t link) noexcept;
+
+  /**
+   * @brief Adds or subtracts a hard link from the counters of its target and of the target's ancestors.
+   */
+  void
+  m_count_hlink(std::uint32_t target, bool is_added);
+
+  /**
+   * @brief Tells whether hard links are attached to an entity, or to any entity below a directory.
+   */
+  bool
+  m_has_hlinks(std::uint32_t node) const noexcept;
+
+  /**
+   * @brief Tells whether hard links placed outside of a subtree are attached to any entity of it.
+   *
+   * @param subtree The entities of the subtree, its root first.
+   */
+  bool
+  m_has_outer_hlinks(const std::vector<std::uint32_t>& subtree) const;
+
+  /**
+   * @brief Copies an entity with its subtree, the copy isn't attached to any directory yet.
+   *
+   * @return The index of the copy.
+   */
+  std::uint32_t
+  m_copy(std::uint32_t source);
+
+  /**
+   * @brief Copies a single entity, a copy of a directory is empty and a copy of a link is attached to its target.
+   */
+  std::uint32_t
+  m_copy_node(std::uint32_t source);
+
+  /**
+   * @brief Adds a file or a directory to a table of children, rebuilding it twice as large once it's three quarters
+   * full. The child has to be counted in m_named already.
+   */
+  void
+  m_table_insert(Child_table& table, std::uint32_t child);
+
+  /**
+   * @brief Removes a file or a directory from a table of children, entries following it are shifted back instead
+   * of leaving a tombstone.
+   */
+  void
+  m_table_erase(Child_table& table, std::uint32_t child) noexcept;
+
+  /**
+   * @brief Returns the slot of a table a name hashes to, names are spread by Fibonacci hashing.
+   */
+  static std::size_t
+  m_home(Name_id name, std::size_t mask) noexcept
+  {
+    return static_cast<std::size_t>((name * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+  }
+
+  /**
+   * @brief Writes the absolute path of an entity into a buffer, its previous content is replaced.
+   */
+  void
+  m_write_path(std::uint32_t node, std::string& buffer) const;
+
+  /**
+   * @brief Writes the name of an entity as it's printed into a buffer, e.g. "dlink[C:\Dir1\file1.txt]".
+   */
+  void
+  m_write_display_name(std::uint32_t node, std::string& buffer) const;
+
+private:
+  Name_table& m_name_table; ///> Interned names, owned by the emulator.
+
+  std::vector<NODE_TYPE> m_types;             ///> Types of entities.
+  std::vector<std::uint32_t> m_parents;       ///> Parent directories of entities, npos for the drive and free slots.
+  std::vector<std::uint32_t> m_first_childs;  ///> First children of directories, previous links of the same target.
+  std::vector<std::uint32_t> m_prev_siblings; ///> Previous children of the same directory.
+  std::vector<std::uint32_t> m_next_siblings; ///> Next children of the same directory, next free slots.
+  std::vector<std::uint32_t> m_names;         ///> Names of files and directories, targets of links.
+  std::vector<std::uint32_t> m_links;         ///> First links of files and directories, next links of the same target.
+
+  std::unordered_map<std::uint32_t, Child_table> m_child_tables;     ///> Tables of children of large directories.
+  std::unordered_map<std::uint32_t, std::uint32_t> m_subtree_hlinks; ///> Hard links to directories and below them.
+
+  std::uint32_t m_current;             ///> Index of the current directory.
+  std::uint32_t m_free;                ///> First free slot, npos if there are none.
+  std::size_t m_free_slots;            ///> Number of free slots.
+  std::array<std::size_t, 4> m_counts; ///> Number of entities by NODE_TYPE.
+};
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef __PATH_CACHE_HPP__
+#define __PATH_CACHE_HPP__
+
+#include <functional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "base.hpp"
+
+/**
+ * @class Path_cache
+ *
+ * Bounded cache of resolved absolute paths. Lookups are served by a hash map, an ordered view of the same keys
+ * lets the cache drop a path together with every path below it, so entries are invalidated precisely when an
+ * entity is moved or removed. Once the cache is full, one entry is evicted per insertion by the CLOCK algorithm:
+ * the hand skips entries found since it last passed them. New entries aren't marked as found, so a working set a
+ * little larger than the capacity evicts mostly the entries just inserted and keeps hitting the rest.
+ */
+class Path_cache
+{
+public:
+  /**
+   * @brief Default number of paths kept by the cache.
+   */
+  static constexpr std::size_t DEFAULT_CAPACITY = 64 * 1024;
+
+  /**
+   * @brief Counters of the cache.
+   *
+   * m_hits: Number of lookups served by the cache.
+   * m_misses: Number of lookups not found in the cache.
+   * m_invalidated: Number of entries dropped because their entity was moved or removed.
+   * m_evicted: Number of entries dropped because the cache was full.
+   * m_size: Number of entries in the cache.
+   */
+  struct Stats
+  {
+    std::size_t m_hits;
+    std::size_t m_misses;
+    std::size_t m_invalidated;
+    std::size_t m_evicted;
+    std::size_t m_size;
+  };
+
+  explicit Path_cache(std::size_t capacity = DEFAULT_CAPACITY);
+
+  /**
+   * @brief Looks up a node by its absolute path.
+   *
+   * @param path The absolute path to look up.
+   * @return The cached node, or nullptr if the path is not cached.
+   */
+  Node*
+  find(std::string_view path) noexcept;
+
+  /**
+   * @brief Remembers the node an absolute path resolves to.
+   *
+   * @param path The absolute path.
+   * @param node The node the path resolves to.
+   */
+  void
+  insert(std::string_view path, Node* node);
+
+  /**
+   * @brief Drops the path and every path that goes through it.
+   *
+   * @param path The absolute path of a moved or removed entity.
+   */
+  void
+  invalidate(std::string_view path);
+
+  /**
+   * @brief Drops all entries.
+   */
+  void
+  clear() noexcept;
+
+  /**
+   * @brief Changes the maximum number of entries, capacity 0 disables the cache.
+   *
+   * @param capacity The new capacity.
+   */
+  void
+  set_capacity(std::size_t capacity);
+
+  /**
+   * @brief Returns current counters of the cache.
+   */
+  Stats
+  stats() const noexcept;
+
+private:
+  std::size_t m_capacity;    ///> Maximum number of entries.
+  std::size_t m_hits;        ///> Number of lookups served by the cache.
+  std::size_t m_misses;      ///> Number of lookups not found in the cache.
+  std::size_t m_invalidated; ///> Number of entries dropped by invalidate().
+  std::size_t m_evicted;     ///> Number of entries dropped because the cache was full.
+
+  /**
+   * @brief Transparent hash of the keys, lets the cache be searched by std::string_view.
+   */
+  struct Path_hash
+  {
+    using is_transparent = void;
+
+    std::size_t
+    operator()(std::string_view path) const noexcept
+    {
+      return std::hash<std::string_view>()(path);
+    }
+  };
+
+  /**
+   * @brief Cached node of a path.
+   *
+   * m_node: The node the path resolves to.
+   * m_slot: Position of the entry in m_clock.
+   * m_is_found: Whether the entry was found since the hand of the clock last passed it.
+   */
+  struct Entry
+  {
+    Node* m_node;
+    std::size_t m_slot;
+    bool m_is_found;
+  };
+
+  using Entries = std::unordered_map<std::string, Entry, Path_hash, std::equal_to<>>;
+
+  Entries m_entries;                               ///> Cached nodes by their paths.
+  std::set<std::string_view, std::less<>> m_order; ///> Keys of m_entries in lexicographical order.
+  std::vector<Entries::value_type*> m_clock;       ///> Entries in the order the hand of the clock visits them.
+  std::size_t m_hand;                              ///> Position of the hand of the clock in m_clock.
+
+  /**
+   * @brief Moves the hand of the clock to the next entry that wasn't found since the hand last passed it.
+   *
+   * @return The position of the entry to evict.
+   */
+  std::size_t
+  m_find_victim() noexcept;
+
+  /**
+   * @brief Drops an entry, the last entry of m_clock takes its position.
+   *
+   * @param slot The position of the entry in m_clock.
+   */
+  void
+  m_erase(std::size_t slot) noexcept;
+};
+
+#endif
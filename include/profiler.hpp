@@ -0,0 +1,276 @@
+#ifndef __PROFILER_HPP__
+#define __PROFILER_HPP__
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+
+#include "command.hpp"
+
+/**
+ * @brief Work counted by the profiler of the emulator.
+ *
+ * PATH_SEGMENTS: Segments of paths resolved by walking the tree, cached paths aren't walked.
+ * CHILD_COMPARISONS: Children compared by lookups of a child in a directory.
+ * COPIED_NODES: Nodes created by copies, including private nodes of copy-on-write copies.
+ * LINK_UPDATES: Links attached to and detached from their targets.
+ * DELETED_NODES: Nodes released by removals, including dynamic links removed with their targets.
+ * PRINTED_NODES: Lines written by print().
+ */
+enum class PROFILE_COUNTER : std::uint8_t
+{
+  PATH_SEGMENTS,
+  CHILD_COMPARISONS,
+  COPIED_NODES,
+  LINK_UPDATES,
+  DELETED_NODES,
+  PRINTED_NODES
+};
+
+/**
+ * @brief Names of the counters in the profile, indexed by PROFILE_COUNTER.
+ */
+inline constexpr std::array<std::string_view, 6> PROFILE_COUNTER_NAMES{
+  "path_segments", "child_comparisons", "copied_nodes", "link_updates", "deleted_nodes", "printed_nodes"
+};
+
+/**
+ * @brief Returns the number of child comparisons made by the calling thread since the end of the last profiled
+ * scope. Lookups are counted here rather than by the profiler, a directory doesn't know its emulator.
+ */
+inline std::uint64_t&
+profile_comparisons() noexcept
+{
+  static thread_local std::uint64_t comparisons__ = 0;
+  return comparisons__;
+}
+
+#ifdef FSE_PROFILE
+/**
+ * @brief Counts a comparison of a child and evaluates to its result.
+ */
+#define FSE_PROFILE_COMPARE(expr) (++profile_comparisons(), (expr))
+/**
+ * @brief Adds to a counter of a profiler.
+ */
+#define FSE_PROFILE_COUNT(profiler, counter, n) (profiler).count(PROFILE_COUNTER::counter, (n))
+/**
+ * @brief Records the time until the end of the enclosing scope in a latency histogram of a profiler.
+ */
+#define FSE_PROFILE_SCOPE(profiler, histogram) Profile_scope profile_scope__{ (profiler), (histogram) }
+#else
+#define FSE_PROFILE_COMPARE(expr) (expr)
+#define FSE_PROFILE_COUNT(profiler, counter, n) ((void)0)
+#define FSE_PROFILE_SCOPE(profiler, histogram) ((void)0)
+#endif
+
+/**
+ * @class Latency_histogram
+ *
+ * Histogram of latencies in nanoseconds with a bounded relative error, in the manner of HdrHistogram. Values are
+ * grouped by powers of two, and every power of two is split into SUB_BUCKETS linear buckets, so a value is
+ * reported within 1/SUB_BUCKETS of itself whatever its magnitude. Recording is a few arithmetic operations.
+ */
+class Latency_histogram
+{
+public:
+  /**
+   * @brief Every power of two is split into 2^SUB_BUCKET_BITS linear buckets.
+   */
+  static constexpr std::size_t SUB_BUCKET_BITS = 4;
+  static constexpr std::size_t SUB_BUCKETS = std::size_t{ 1 } << SUB_BUCKET_BITS;
+
+  /**
+   * @brief Number of buckets enough for any 64-bit value.
+   */
+  static constexpr std::size_t BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+  Latency_histogram() noexcept : m_counts(), m_count(0), m_total(0), m_min(UINT64_MAX), m_max(0){};
+
+  /**
+   * @brief Records a value.
+   *
+   * @param value The latency in nanoseconds.
+   */
+  void
+  record(std::uint64_t value) noexcept;
+
+  /**
+   * @brief Returns the number of recorded values.
+   */
+  std::uint64_t
+  count() const noexcept
+  {
+    return m_count;
+  }
+
+  /**
+   * @brief Returns the sum of recorded values.
+   */
+  std::uint64_t
+  total() const noexcept
+  {
+    return m_total;
+  }
+
+  /**
+   * @brief Returns the smallest recorded value, 0 if there is none.
+   */
+  std::uint64_t
+  min() const noexcept
+  {
+    return m_count ? m_min : 0;
+  }
+
+  /**
+   * @brief Returns the largest recorded value, 0 if there is none.
+   */
+  std::uint64_t
+  max() const noexcept
+  {
+    return m_max;
+  }
+
+  /**
+   * @brief Returns the value below or at which the given percentage of recorded values lie, rounded up to the
+   * highest value of its bucket.
+   *
+   * @param percentile The percentage, from 0 to 100.
+   * @return The value, 0 if nothing is recorded.
+   */
+  std::uint64_t
+  percentile(double percentile) const noexcept;
+
+private:
+  /**
+   * @brief Returns the bucket of a value.
+   */
+  static std::size_t
+  m_bucket(std::uint64_t value) noexcept;
+
+  /**
+   * @brief Returns the highest value that falls into a bucket.
+   */
+  static std::uint64_t
+  m_highest(std::size_t bucket) noexcept;
+
+private:
+  std::array<std::uint64_t, BUCKETS> m_counts; ///> Number of values in every bucket.
+  std::uint64_t m_count;                       ///> Number of recorded values.
+  std::uint64_t m_total;                       ///> Sum of recorded values.
+  std::uint64_t m_min;                         ///> Smallest recorded value.
+  std::uint64_t m_max;                         ///> Largest recorded value.
+};
+
+/**
+ * @class Profiler
+ *
+ * Counters of work done by the emulator and latencies of its commands. The emulator keeps one only when it's built
+ * with FSE_PROFILE, otherwise instrumented places compile to nothing.
+ */
+class Profiler
+{
+public:
+  Profiler() noexcept : m_counters(), m_latencies(), m_print_latencies(){};
+
+  /**
+   * @brief Adds to a counter.
+   *
+   * @param counter The counter to add to.
+   * @param n The amount of work to add.
+   */
+  void
+  count(PROFILE_COUNTER counter, std::uint64_t n) noexcept
+  {
+    m_counters[static_cast<std::size_t>(counter)] += n;
+  }
+
+  /**
+   * @brief Returns the value of a counter.
+   */
+  std::uint64_t
+  counter(PROFILE_COUNTER counter) const noexcept
+  {
+    return m_counters[static_cast<std::size_t>(counter)];
+  }
+
+  /**
+   * @brief Returns the histogram of latencies of a command.
+   */
+  Latency_histogram&
+  latencies(COMMAND_TYPE type) noexcept
+  {
+    return m_latencies[static_cast<std::size_t>(type)];
+  }
+
+  const Latency_histogram&
+  latencies(COMMAND_TYPE type) const noexcept
+  {
+    return m_latencies[static_cast<std::size_t>(type)];
+  }
+
+  /**
+   * @brief Returns the histogram of latencies of printing the tree.
+   */
+  Latency_histogram&
+  print_latencies() noexcept
+  {
+    return m_print_latencies;
+  }
+
+  const Latency_histogram&
+  print_latencies() const noexcept
+  {
+    return m_print_latencies;
+  }
+
+  /**
+   * @brief Writes the counters and percentiles of latencies as a JSON object. Operations that never ran are
+   * left out.
+   *
+   * @param stream The stream to write to.
+   */
+  void
+  write_json(std::ostream& stream) const;
+
+private:
+  std::array<std::uint64_t, PROFILE_COUNTER_NAMES.size()> m_counters; ///> Counters indexed by PROFILE_COUNTER.
+  std::array<Latency_histogram, COMMANDS.size()> m_latencies;         ///> Latencies indexed by COMMAND_TYPE.
+  Latency_histogram m_print_latencies;                                ///> Latencies of print().
+};
+
+/**
+ * @class Profile_scope
+ *
+ * Measures the time of a scope into a latency histogram. Child comparisons made by the calling thread meanwhile
+ * are added to the profiler as well.
+ */
+class Profile_scope
+{
+public:
+  Profile_scope(Profiler& profiler, Latency_histogram& histogram) noexcept
+      : m_profiler(profiler), m_histogram(histogram), m_start(std::chrono::steady_clock::now()){};
+
+  Profile_scope(const Profile_scope&) = delete;
+
+  Profile_scope&
+  operator=(const Profile_scope&) = delete;
+
+  ~Profile_scope()
+  {
+    auto elapsed__ = std::chrono::steady_clock::now() - m_start;
+
+    m_histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed__).count());
+    m_profiler.count(PROFILE_COUNTER::CHILD_COMPARISONS, profile_comparisons());
+    profile_comparisons() = 0;
+  }
+
+private:
+  Profiler& m_profiler;                          ///> Profiler that receives the child comparisons.
+  Latency_histogram& m_histogram;                ///> Histogram that receives the time.
+  std::chrono::steady_clock::time_point m_start; ///> Start of the scope.
+};
+
+#endif
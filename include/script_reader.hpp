@@ -0,0 +1,104 @@
+#ifndef __SCRIPT_READER_HPP__
+#define __SCRIPT_READER_HPP__
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "mapped_file.hpp"
+
+/**
+ * @class Script_reader
+ *
+ * Reads a script line by line straight from a memory-mapped file. Lines are returned as views into the mapping,
+ * so reading a script allocates nothing regardless of its size. Scripts that can't be mapped, e.g. pipes, are read
+ * through a buffer in blocks as the lines are asked for, the blocks are recycled once their lines are released.
+ */
+class Script_reader
+{
+public:
+  /**
+   * @brief Maps the script into memory or prepares it for buffered reads.
+   *
+   * @param path The path to the script, is_open() tells whether it was opened.
+   */
+  explicit Script_reader(const char* path) noexcept;
+
+  Script_reader(const Script_reader&) = delete;
+
+  Script_reader&
+  operator=(const Script_reader&) = delete;
+
+  ~Script_reader();
+
+  /**
+   * @brief Tells whether the script was opened. An empty script is open and has no lines.
+   */
+  bool
+  is_open() const noexcept
+  {
+    return m_is_open;
+  }
+
+  /**
+   * @brief Reads the next line of the script, without its line break. Throws an exception if the script can`t be
+   * read or there is no memory left to buffer it.
+   *
+   * @param line Receives the line, valid until release() is called after a later line is read.
+   * @return False if the end of the script is reached.
+   */
+  bool
+  next_line(std::string_view& line);
+
+  /**
+   * @brief Tells the reader that lines returned so far aren't used anymore, except the last one. Blocks that hold
+   * none of the lines are freed, the largest of them is kept for the next block. Does nothing for a mapped script.
+   */
+  void
+  release() noexcept;
+
+  /**
+   * @brief Returns the number of bytes of the blocks a script that isn't mapped is read through.
+   */
+  std::size_t
+  buffered_bytes() const noexcept;
+
+private:
+  static constexpr std::size_t BLOCK_SIZE = 64 * 1024; ///> Minimal size of a block of buffered reads.
+
+  /**
+   * @brief A block of a script that isn't mapped.
+   *
+   * m_bytes: Content of the block.
+   * m_capacity: Number of bytes the block can hold.
+   */
+  struct Block
+  {
+    std::unique_ptr<char[]> m_bytes;
+    std::size_t m_capacity;
+  };
+
+  /**
+   * @brief Reads more of a script that isn't mapped into the current block.
+   *
+   * A full block is replaced by a new one that starts with the unfinished line. Filled blocks are kept until
+   * release(), since the lines returned before are views into them.
+   *
+   * @return False if nothing is left to read.
+   */
+  bool
+  m_fill();
+
+  int m_fd;                     ///> Descriptor of a script read through blocks, -1 when all is read.
+  Mapped_file m_file;           ///> Mapped content of the script.
+  std::vector<Block> m_blocks;  ///> Blocks of a script that isn't mapped holding unreleased lines, the current last.
+  Block m_spare;                ///> A released block kept to be reused, or an empty one.
+  const char* m_data;           ///> Content being read, the mapping or the current block.
+  std::size_t m_size;                           ///> Number of bytes in m_data.
+  std::size_t m_capacity;                       ///> Number of bytes m_data can hold.
+  std::size_t m_pos;                            ///> Offset of the next line.
+  std::size_t m_scanned;                        ///> Offset up to which the next line has no line break.
+  bool m_is_open;                               ///> Whether the script was opened.
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef __SNAPSHOT_HPP__
+#define __SNAPSHOT_HPP__
+
+#include <cstdint>
+
+/**
+ * Binary snapshot of a file system tree. The file is laid out as:
+ *
+ *   Snapshot_header
+ *   std::uint32_t[m_names]      lengths of the names, a name's identifier is its position plus one
+ *   char[m_name_bytes]          characters of the names, one after another, padded to 4 bytes
+ *   Snapshot_record[m_nodes]    nodes of the tree in pre-order, starting with the drive
+ *
+ * Integers are stored in the byte order of the machine that wrote the snapshot, m_byte_order tells it apart.
+ */
+
+/**
+ * @brief Magic bytes every snapshot starts with.
+ */
+inline constexpr char SNAPSHOT_MAGIC[8] = "FSESNAP";
+
+/**
+ * @brief Version of the format, bumped on every incompatible change.
+ */
+inline constexpr std::uint32_t SNAPSHOT_VERSION = 2;
+
+/**
+ * @brief Value of Snapshot_header::m_byte_order as it's read on a machine of the writer's byte order.
+ */
+inline constexpr std::uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+/**
+ * @brief Index of a node in a snapshot, the drive's parent is stored as SNAPSHOT_NONE.
+ */
+inline constexpr std::uint32_t SNAPSHOT_NONE = static_cast<std::uint32_t>(-1);
+
+/**
+ * @brief Header of a snapshot.
+ *
+ * m_magic: Equals SNAPSHOT_MAGIC.
+ * m_version: Version of the format.
+ * m_byte_order: Equals SNAPSHOT_BYTE_ORDER.
+ * m_names: Number of names in the snapshot, the empty name with identifier 0 isn't stored.
+ * m_name_bytes: Number of characters of all names, without padding.
+ * m_nodes: Number of nodes in the snapshot.
+ * m_curr_catalog: Index of the current directory.
+ * m_sequence: Sequence number of the first journal record not included in the snapshot.
+ */
+struct Snapshot_header
+{
+  char m_magic[8];
+  std::uint32_t m_version;
+  std::uint32_t m_byte_order;
+  std::uint64_t m_names;
+  std::uint64_t m_name_bytes;
+  std::uint64_t m_nodes;
+  std::uint64_t m_curr_catalog;
+  std::uint64_t m_sequence;
+};
+
+/**
+ * @brief A node of a snapshot. Every node but the drive comes after its parent.
+ *
+ * m_parent: Index of the parent directory.
+ * m_type: NODE_TYPE of the node.
+ * m_value: Identifier of the name of a file or a directory, or index of the target of a link.
+ */
+struct Snapshot_record
+{
+  std::uint32_t m_parent;
+  std::uint32_t m_type;
+  std::uint32_t m_value;
+};
+
+#endif
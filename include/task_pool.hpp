@@ -0,0 +1,252 @@
+#ifndef __TASK_POOL_HPP__
+#define __TASK_POOL_HPP__
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class Task_pool
+ *
+ * Work-stealing pool of threads that run tasks of a single type. Every worker keeps its own deque of tasks: it takes
+ * the task it spawned last, so a worker walks its part of the work depth-first, and an idle worker steals the oldest
+ * task of another one, which tends to be the largest. The thread that calls run() works as worker 0, the others
+ * sleep between runs.
+ *
+ * @tparam Task Type of the tasks, has to be default constructible and movable.
+ */
+template <typename Task>
+class Task_pool
+{
+public:
+  /**
+   * @brief Function that runs a task, receives the task and the index of the worker that runs it.
+   */
+  using Handler = std::function<void(Task&, std::size_t)>;
+
+  /**
+   * @brief Starts the threads of the pool.
+   *
+   * @param workers Number of workers including the calling thread, at least 1.
+   */
+  explicit Task_pool(std::size_t workers)
+      : m_queues(), m_threads(), m_generation(0), m_stop(false), m_handler(nullptr), m_pending(0), m_failed(false),
+        m_mutex(), m_error()
+  {
+    for(std::size_t i = 0; i < std::max<std::size_t>(workers, 1); ++i)
+      m_queues.push_back(std::make_unique<Queue>());
+
+    try
+      {
+        for(std::size_t i = 1; i < m_queues.size(); ++i)
+          m_threads.emplace_back(&Task_pool::m_work, this, i);
+      }
+    catch(...)
+      {
+        m_join();
+        throw;
+      }
+  }
+
+  Task_pool(const Task_pool&) = delete;
+
+  Task_pool&
+  operator=(const Task_pool&) = delete;
+
+  ~Task_pool()
+  {
+    m_join();
+  }
+
+  /**
+   * @brief Returns the number of workers including the calling thread.
+   */
+  std::size_t
+  size() const noexcept
+  {
+    return m_queues.size();
+  }
+
+  /**
+   * @brief Runs a task and all tasks spawned by it, returns once all of them are done. Once a task throws, tasks
+   * that haven't started yet are dropped.
+   *
+   * @param task The first task.
+   * @param handler The function that runs the tasks.
+   * @throws The first exception thrown by a task.
+   */
+  void
+  run(Task task, const Handler& handler)
+  {
+    m_handler = &handler;
+    m_failed.store(false, std::memory_order_relaxed);
+    m_error = nullptr;
+
+    spawn(0, std::move(task));
+
+    m_generation.fetch_add(1, std::memory_order_release);
+    m_generation.notify_all();
+    m_drain(0);
+
+    std::lock_guard<std::mutex> lock__{ m_mutex };
+
+    if(m_error)
+      std::rethrow_exception(m_error);
+  }
+
+  /**
+   * @brief Adds a task to the deque of a worker, to be called by a running task.
+   *
+   * @param worker The index of the worker that runs the calling task.
+   * @param task The new task.
+   */
+  void
+  spawn(std::size_t worker, Task task)
+  {
+    Queue& queue__ = *m_queues[worker];
+    std::lock_guard<std::mutex> lock__{ queue__.m_mutex };
+
+    // Nobody can take the task before the lock is released, so it's counted only once it's actually added.
+    queue__.m_tasks.push_back(std::move(task));
+    m_pending.fetch_add(1, std::memory_order_relaxed);
+  }
+
+private:
+  /**
+   * @brief Deque of tasks of a single worker, aligned so workers don't share cache lines.
+   */
+  struct alignas(64) Queue
+  {
+    std::mutex m_mutex;
+    std::deque<Task> m_tasks;
+  };
+
+  /**
+   * @brief Main loop of a worker thread, sleeps until the next run.
+   */
+  void
+  m_work(std::size_t worker)
+  {
+    std::uint64_t seen__ = 0;
+
+    while(true)
+      {
+        m_generation.wait(seen__, std::memory_order_acquire);
+        seen__ = m_generation.load(std::memory_order_acquire);
+
+        if(m_stop.load(std::memory_order_acquire))
+          return;
+
+        m_drain(worker);
+      }
+  }
+
+  /**
+   * @brief Runs own and stolen tasks until all tasks of the run are done.
+   */
+  void
+  m_drain(std::size_t worker)
+  {
+    Task task__;
+
+    while(m_pending.load(std::memory_order_acquire) != 0)
+      {
+        if(!m_take(worker, task__))
+          {
+            std::this_thread::yield();
+            continue;
+          }
+
+        if(!m_failed.load(std::memory_order_relaxed))
+          {
+            try
+              {
+                (*m_handler)(task__, worker);
+              }
+            catch(...)
+              {
+                std::lock_guard<std::mutex> lock__{ m_mutex };
+
+                if(!m_error)
+                  m_error = std::current_exception();
+
+                m_failed.store(true, std::memory_order_relaxed);
+              }
+          }
+
+        m_pending.fetch_sub(1, std::memory_order_acq_rel);
+      }
+  }
+
+  /**
+   * @brief Takes the newest task of the worker's own deque, or steals the oldest task of another worker.
+   *
+   * @return False if all deques are empty.
+   */
+  bool
+  m_take(std::size_t worker, Task& task)
+  {
+    {
+      Queue& queue__ = *m_queues[worker];
+      std::lock_guard<std::mutex> lock__{ queue__.m_mutex };
+
+      if(!queue__.m_tasks.empty())
+        {
+          task = std::move(queue__.m_tasks.back());
+          queue__.m_tasks.pop_back();
+          return true;
+        }
+    }
+
+    for(std::size_t i = 1; i < m_queues.size(); ++i)
+      {
+        Queue& queue__ = *m_queues[(worker + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock__{ queue__.m_mutex };
+
+        if(!queue__.m_tasks.empty())
+          {
+            task = std::move(queue__.m_tasks.front());
+            queue__.m_tasks.pop_front();
+            return true;
+          }
+      }
+
+    return false;
+  }
+
+  /**
+   * @brief Stops and joins the worker threads.
+   */
+  void
+  m_join() noexcept
+  {
+    m_stop.store(true, std::memory_order_release);
+    m_generation.fetch_add(1, std::memory_order_release);
+    m_generation.notify_all();
+
+    for(std::thread& thread__ : m_threads)
+      thread__.join();
+
+    m_threads.clear();
+  }
+
+private:
+  std::vector<std::unique_ptr<Queue>> m_queues; ///> Deques of tasks, one per worker.
+  std::vector<std::thread> m_threads;           ///> Threads of workers 1 and up.
+  std::atomic<std::uint64_t> m_generation;      ///> Bumped to wake sleeping workers up for a run or to stop.
+  std::atomic<bool> m_stop;                     ///> Tells workers to exit.
+  const Handler* m_handler;                     ///> Function of the current run.
+  std::atomic<std::size_t> m_pending;           ///> Number of tasks of the current run that aren't done yet.
+  std::atomic<bool> m_failed;                   ///> Set once a task of the current run throws.
+  std::mutex m_mutex;                           ///> Guards m_error.
+  std::exception_ptr m_error;                   ///> First exception of the current run.
+};
+
+#endif
@@ -0,0 +1,251 @@
+#ifndef __TREE_VIEW_HPP__
+#define __TREE_VIEW_HPP__
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "base.hpp"
+
+class Listing_cache;
+
+/**
+ * @class Tree_view
+ *
+ * Immutable copy of a file system tree, safe to read from any number of threads. Every directory is copied into a
+ * listing of its children sorted by name, so a path is resolved by binary searches over contiguous ranges.
+ * Listings never change once they're built and are shared by views: a new view rebuilds only the listings of
+ * directories changed since the previous one and of their ancestors, see Listing_cache.
+ */
+class Tree_view
+{
+public:
+  struct Listing;
+
+  /**
+   * @brief An entity of the view.
+   *
+   * m_type: Type of the entity.
+   * m_name: Name of the entity as it's printed, e.g. "dlink[C:\Dir1\file1.txt]" for links.
+   * m_listing: Children of a directory, nullptr for other entities.
+   */
+  struct Entry
+  {
+    NODE_TYPE m_type;
+    std::string_view m_name;
+    std::shared_ptr<const Listing> m_listing;
+  };
+
+  /**
+   * @brief Children of a directory.
+   *
+   * m_names: Characters of names of the children.
+   * m_entries: The children sorted by name, their names point into m_names.
+   * m_size: Number of entities below the directory.
+   */
+  struct Listing
+  {
+    Listing() = default;
+
+    // Names of entries point into the listing itself.
+    Listing(const Listing&) = delete;
+
+    Listing&
+    operator=(const Listing&) = delete;
+
+    /**
+     * @brief Releases listings of a deep tree one by one instead of recursively.
+     */
+    ~Listing();
+
+    std::string m_names;
+    std::vector<Entry> m_entries;
+    std::size_t m_size;
+  };
+
+  // Entry of the drive points into the view itself, so a copied or moved view would refer to a name of another one.
+  Tree_view(const Tree_view&) = delete;
+
+  Tree_view(Tree_view&&) = delete;
+
+  Tree_view&
+  operator=(const Tree_view&) = delete;
+
+  Tree_view&
+  operator=(Tree_view&&) = delete;
+
+  /**
+   * @brief Builds a view of a tree. Listings of directories that haven't changed since the cache was last used are
+   * reused, the others are built and kept in the cache for the next view.
+   *
+   * @param drive The drive of the tree.
+   * @param current_path The absolute path of the current directory of the tree.
+   * @param names The table of names of the tree.
+   * @param version The version of the view, grows with every published view.
+   * @param cache Listings of the previous view and directories changed since.
+   * @return The view.
+   */
+  static std::shared_ptr<const Tree_view>
+  build(const Directory* drive, std::string_view current_path, const Name_table& names, std::uint64_t version,
+        Listing_cache& cache);
+
+  /**
+   * @brief Finds an entity by its path, relative paths start at the current directory of the view.
+   *
+   * @param path The path to the entity.
+   * @return The entity, or nullptr if the path doesn't exist.
+   */
+  const Entry*
+  find(std::string_view path) const;
+
+  /**
+   * @brief Returns the drive.
+   */
+  const Entry&
+  root() const noexcept
+  {
+    return m_root;
+  }
+
+  /**
+   * @brief Returns the children of a directory sorted by name.
+   */
+  static std::span<const Entry>
+  childs(const Entry& dir) noexcept
+  {
+    if(!dir.m_listing)
+      return {};
+
+    return dir.m_listing->m_entries;
+  }
+
+  /**
+   * @brief Prints the structure of the tree the same way File_system_emulator::print() does.
+   *
+   * @param stream The stream to print to.
+   */
+  void
+  print(std::ostream& stream) const;
+
+  /**
+   * @brief Returns the current directory of the tree.
+   */
+  const Entry&
+  current() const noexcept
+  {
+    return *m_current;
+  }
+
+  /**
+   * @brief Returns the absolute path of the current directory of the tree.
+   */
+  std::string_view
+  current_path() const noexcept
+  {
+    return m_current_path;
+  }
+
+  /**
+   * @brief Returns the number of entities in the view.
+   */
+  std::size_t
+  size() const noexcept
+  {
+    return 1 + m_root.m_listing->m_size;
+  }
+
+  /**
+   * @brief Returns the version of the view.
+   */
+  std::uint64_t
+  version() const noexcept
+  {
+    return m_version;
+  }
+
+private:
+  Tree_view() = default;
+
+  /**
+   * @brief Builds the listing of a directory, listings of its child directories have to be in the cache already.
+   *
+   * @param dir The directory.
+   * @param names The table of names of the tree.
+   * @param cache Listings of the child directories.
+   * @return The listing.
+   */
+  static std::shared_ptr<const Listing>
+  m_list(const Directory* dir, const Name_table& names, const Listing_cache& cache);
+
+  /**
+   * @brief Finds a child of a directory by its name.
+   *
+   * @return The child, or nullptr if there is no such child.
+   */
+  static const Entry*
+  m_find_child(const Entry& dir, std::string_view name) noexcept;
+
+private:
+  std::string m_root_name;     ///> Name of the drive.
+  Entry m_root;                ///> The drive.
+  std::string m_current_path;  ///> Absolute path of the current directory.
+  const Entry* m_current;      ///> The current directory.
+  std::uint64_t m_version;     ///> Version of the view.
+};
+
+/**
+ * @class Listing_cache
+ *
+ * Listings of directories of the last published view, kept by the writer so the next view shares them. The writer
+ * reports every directory whose children change, the directory and its ancestors get new listings, the rest of
+ * the tree is shared. Nothing is tracked until the first view is built.
+ */
+class Listing_cache
+{
+public:
+  /**
+   * @brief Marks a directory whose children changed, together with its ancestors and copy-on-write copies sharing
+   * any of them.
+   *
+   * @param dir The changed directory.
+   */
+  void
+  touch(const Directory* dir);
+
+  /**
+   * @brief Marks directories holding links to an entity or to anything below it, names of the links follow the
+   * path of the entity. The entity's subtree is walked, so this is linear in its size.
+   *
+   * @param node The moved entity.
+   */
+  void
+  touch_links(const Node* node);
+
+  /**
+   * @brief Drops the listing of a directory that's released, another one may get its address.
+   */
+  void
+  forget(const Directory* dir) noexcept;
+
+  /**
+   * @brief Drops all listings, the next view is built from scratch.
+   */
+  void
+  clear() noexcept;
+
+private:
+  friend class Tree_view;
+
+  std::unordered_map<const Directory*, std::shared_ptr<const Tree_view::Listing>> m_listings; ///> Listings by directory.
+  std::unordered_set<const Directory*> m_changed; ///> Directories whose listings are out of date.
+  std::vector<const Directory*> m_pending;        ///> Reusable stack of directories to mark.
+  std::vector<const Node*> m_stack;               ///> Reusable stack of entities whose links to mark.
+};
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef __TREE_WRITER_HPP__
+#define __TREE_WRITER_HPP__
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+/**
+ * @class Tree_writer
+ *
+ * Writes the structure of a tree line by line in the format of File_system_emulator::print(): every entity is
+ * printed on a line of its own, indented by "| " per level with the last level drawn as "|_". Lines are collected
+ * in a buffer that goes to the stream in large chunks, so printing a big tree costs few stream calls.
+ */
+class Tree_writer
+{
+public:
+  /**
+   * @brief Number of buffered characters that makes the writer pass the buffer to the stream.
+   */
+  static constexpr std::size_t CHUNK_SIZE = 64 * 1024;
+
+  /**
+   * @brief Starts the output with an empty line.
+   *
+   * @param stream The stream to write to.
+   */
+  explicit Tree_writer(std::ostream& stream) : m_stream(stream), m_buffer(), m_indent()
+  {
+    m_buffer.reserve(CHUNK_SIZE + 256);
+    m_buffer += '\n';
+  }
+
+  Tree_writer(const Tree_writer&) = delete;
+
+  Tree_writer&
+  operator=(const Tree_writer&) = delete;
+
+  /**
+   * @brief Writes a line of an entity.
+   *
+   * @param depth The depth of the entity, 0 for the drive.
+   * @param name The name of the entity as it's printed.
+   */
+  void
+  line(std::size_t depth, std::string_view name)
+  {
+    if(depth != 0)
+      {
+        // The indentation of every depth is a prefix of the indentation of a deeper one.
+        while(m_indent.size() < 2 * depth)
+          m_indent += "| ";
+
+        m_buffer.append(m_indent, 0, 2 * depth - 2);
+        m_buffer += "|_";
+      }
+
+    m_buffer += name;
+    m_buffer += '\n';
+
+    if(m_buffer.size() >= CHUNK_SIZE)
+      m_write();
+  }
+
+  /**
+   * @brief Ends the output with an empty line and flushes the stream.
+   */
+  void
+  finish()
+  {
+    m_buffer += '\n';
+    m_write();
+    m_stream.flush();
+  }
+
+private:
+  /**
+   * @brief Passes the buffer to the stream.
+   */
+  void
+  m_write()
+  {
+    m_stream.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+    m_buffer.clear();
+  }
+
+private:
+  std::ostream& m_stream; ///> Stream the output goes to.
+  std::string m_buffer;   ///> Lines that aren't written to the stream yet.
+  std::string m_indent;   ///> "| " repeated for the deepest entity written so far.
+};
+
+#endif
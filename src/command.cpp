@@ -0,0 +1,91 @@
+#include "command.hpp"
+
+namespace
+{
+
+constexpr std::size_t HASH_BITS = 5;
+constexpr std::uint64_t HASH_MULTIPLIER = 0xDBCF34D896A8DAB3ull;
+
+/**
+ * @brief Maps a packed command name to a slot of the command table.
+ */
+constexpr std::size_t
+hash_command_name(std::uint64_t key) noexcept
+{
+  return (key * HASH_MULTIPLIER) >> (64 - HASH_BITS);
+}
+
+/**
+ * @brief Builds the table of commands by the hash of their names.
+ */
+constexpr std::array<COMMAND_TYPE, 1 << HASH_BITS>
+make_command_table() noexcept
+{
+  std::array<COMMAND_TYPE, 1 << HASH_BITS> table__{};
+
+  for(std::size_t i = 1; i < COMMANDS.size(); ++i)
+    table__[hash_command_name(pack_command_name(COMMANDS[i].m_name))] = COMMANDS[i].m_type;
+
+  return table__;
+}
+
+constexpr std::array<COMMAND_TYPE, 1 << HASH_BITS> COMMAND_TABLE = make_command_table();
+
+/**
+ * @brief Checks that no two commands share a slot of the table, i.e. the hash is perfect.
+ */
+constexpr bool
+is_perfect_hash() noexcept
+{
+  for(std::size_t i = 1; i < COMMANDS.size(); ++i)
+    if(COMMANDS[i].m_type != static_cast<COMMAND_TYPE>(i)
+       || COMMAND_TABLE[hash_command_name(pack_command_name(COMMANDS[i].m_name))] != COMMANDS[i].m_type)
+      return false;
+
+  return true;
+}
+
+static_assert(is_perfect_hash(), "Names of commands collide in the command table.");
+
+} // namespace
+
+COMMAND_TYPE
+find_command(std::string_view name) noexcept
+{
+  std::uint64_t key__ = pack_command_name(name);
+  COMMAND_TYPE type__ = COMMAND_TABLE[hash_command_name(key__)];
+
+  // A slot may be taken by another command or be empty, so the name is compared as well.
+  if(key__ == 0 || pack_command_name(COMMANDS[static_cast<std::size_t>(type__)].m_name) != key__)
+    return COMMAND_TYPE::UNKNOWN;
+
+  return type__;
+}
+
+Command
+parse_command(std::string_view line) noexcept
+{
+  Command command__;
+  std::size_t token__ = 0;
+  std::size_t left_pos__ = 0;
+
+  for(std::size_t curr_pos__ = 0, end__ = line.size(); curr_pos__ <= end__; ++curr_pos__)
+    {
+      if(curr_pos__ != end__ && line[curr_pos__] != ' ')
+        continue;
+
+      std::string_view part__ = line.substr(left_pos__, curr_pos__ - left_pos__);
+      left_pos__ = curr_pos__ + 1;
+
+      if(token__ == 0)
+        command__.m_type = find_command(part__);
+      else if(token__ <= command__.m_args.size())
+        command__.m_args[token__ - 1] = part__;
+
+      ++token__;
+    }
+
+  command__.m_argc = token__ - 1;
+
+  return command__;
+}
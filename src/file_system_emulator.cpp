@@ -1,12 +1,15 @@
 #include <algorithm>
 #include <iostream>
-#include <queue>
 #include <stdexcept>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "file_system_emulator.hpp"
 
 static constexpr char DRIVE[3] = "C:";
+static constexpr char HLINK_PREFIX[7] = "hlink[";
+static constexpr char DLINK_PREFIX[7] = "dlink[";
 
 /*
  * *****************************************************************
@@ -87,18 +90,44 @@ split_path(std::string_view path)
 }
 
 /**
- * @brief Extracts the name of the entity to which a hard or dynamic link points from the link's name.
+ * @brief Splits the name of a hard or dynamic link into the link's type and the path to the entity the link
+ * points to.
  *
- * @param name The name of the link, including the target entity's name in square brackets.
- * @return A std::string_view of the target entity's name. If the name does not conform to the expected
- * format, the behavior is undefined.
+ * @param name The name of the link, including the target entity's path in square brackets.
+ * @param type Receives the type of the link.
+ * @param target_path Receives the path to the target entity.
+ * @return True if the name has the format of a link's name, otherwise False.
  */
-static std::string_view
-get_link_basename(std::string_view name)
+static bool
+parse_link_name(std::string_view name, NODE_TYPE& type, std::string_view& target_path)
 {
+  if(name.starts_with(HLINK_PREFIX))
+    type = NODE_TYPE::HLINK;
+  else if(name.starts_with(DLINK_PREFIX))
+    type = NODE_TYPE::DLINK;
+  else
+    return false;
+
   std::size_t left__ = name.find_first_of('[');
-  std::size_t right__ = name.find_first_of(']');
-  return name.substr(left__ + 1, right__ - left__ - 1);
+  std::size_t right__ = name.find_last_of(']');
+
+  if(right__ == std::string::npos || right__ < left__)
+    return false;
+
+  target_path = name.substr(left__ + 1, right__ - left__ - 1);
+  return true;
+}
+
+/**
+ * @brief Determines if a link can point to the node.
+ *
+ * @param node The node to evaluate.
+ * @return True if the node is a file or a directory, otherwise False.
+ */
+static bool
+is_linkable(const Node* node)
+{
+  return node->m_type == NODE_TYPE::FILE || node->m_type == NODE_TYPE::DIRECTORY;
 }
 
 /*
@@ -107,18 +136,38 @@ get_link_basename(std::string_view name)
  * *****************************************************************
  */
 
-File_system_emulator::File_system_emulator() noexcept
+File_system_emulator::File_system_emulator() noexcept : m_index(m_names)
 {
-  m_curr_catalog = new Directory();
-  m_curr_catalog->m_name = DRIVE;
-
-  m_root = new Directory();
-  m_root->m_childs.push_front(m_curr_catalog);
+  m_curr_catalog = m_directories.create();
+  m_curr_catalog->m_name = m_names.intern(DRIVE);
+  m_index.insert(m_curr_catalog);
+
+  m_root = m_directories.create();
+  m_root->add_child(m_curr_catalog, m_names);
+
+  // Drive has no parent, absolute paths end on it.
+  m_curr_catalog->m_parent = nullptr;
+  m_curr_catalog_path = DRIVE;
+  m_sequence = 0;
+  m_view_version.store(0, std::memory_order_relaxed);
+  m_parallel_copy_threshold = DEFAULT_PARALLEL_COPY_THRESHOLD;
+  m_copy_threads = std::thread::hardware_concurrency();
+  m_copy_on_write = false;
+  m_sharing_dirs = 0;
+  m_fanout = {};
+  m_fanout[0] = 1;
+  m_linked_nodes = 0;
+  m_deferred_dlinks = false;
+  m_removed_dirs = 0;
+  m_dangling_links = 0;
+  m_in_transaction = false;
+  m_recording = false;
+  m_retired_nodes = {};
 };
 
 File_system_emulator::~File_system_emulator()
 {
-  delete m_root;
+  // Whole tree is released at once by the pools, so there is no need to walk it.
 }
 
 void
@@ -126,7 +175,13 @@ File_system_emulator::make_dir(std::string_view path)
 {
   std::string_view parent_path__ = get_parent_path(path);
   std::string_view node_name__ = get_path_basename(path);
-  m_make_node(parent_path__, node_name__, NODE_TYPE::DIRECTORY);
+
+  if(m_table)
+    m_table->make_dir(path);
+  else
+    m_make_node(m_find_node_by_path(parent_path__), node_name__, NODE_TYPE::DIRECTORY);
+
+  m_log(COMMAND_TYPE::MAKE_DIR, path);
 }
 
 void
@@ -134,41 +189,68 @@ File_system_emulator::make_file(std::string_view path)
 {
   std::string_view parent_path__ = get_parent_path(path);
   std::string_view node_name__ = get_path_basename(path);
-  m_make_node(parent_path__, node_name__, NODE_TYPE::FILE);
+
+  if(m_table)
+    m_table->make_file(path);
+  else
+    m_make_node(m_find_node_by_path(parent_path__), node_name__, NODE_TYPE::FILE);
+
+  m_log(COMMAND_TYPE::MAKE_FILE, path);
 }
 
 void
 File_system_emulator::make_hlink(std::string_view source, std::string_view dest)
 {
-  // Make correct hlink destination path 'cause %dest doesn't contain name of a hlink.
-  std::string full_path_to_source__ = m_to_absolute_path(source, m_curr_catalog);
-  std::string link_name__ = "hlink[" + full_path_to_source__ + "]";
-  m_make_link(source, dest, link_name__, NODE_TYPE::HLINK);
+  if(m_table)
+    m_table->make_hlink(source, dest);
+  else
+    m_make_link(source, dest, NODE_TYPE::HLINK);
+
+  m_log(COMMAND_TYPE::MAKE_HLINK, source, dest);
 }
 
 void
 File_system_emulator::make_dlink(std::string_view source, std::string_view dest)
 {
-  // Make correct dlink destination path 'cause %dest doesn't contain name of a dlink.
-  std::string full_path_to_source__ = m_to_absolute_path(source, m_curr_catalog);
-  std::string link_name__ = "dlink[" + full_path_to_source__ + "]";
-  m_make_link(source, dest, link_name__, NODE_TYPE::DLINK);
+  if(m_table)
+    m_table->make_dlink(source, dest);
+  else
+    m_make_link(source, dest, NODE_TYPE::DLINK);
+
+  m_log(COMMAND_TYPE::MAKE_DLINK, source, dest);
 }
 
 void
 File_system_emulator::change_dir(std::string_view path)
 {
+  if(m_table)
+    {
+      m_table->change_dir(path);
+      m_log(COMMAND_TYPE::CHANGE_DIR, path);
+      return;
+    }
+
   Node* node_ptr__ = m_find_node_by_path(path);
 
   if(!node_ptr__ || node_ptr__->m_type != NODE_TYPE::DIRECTORY)
     throw std::runtime_error("ERROR: Path not found.");
 
+  m_record(UNDO_TYPE::CHANGE_DIR, m_curr_catalog);
   m_curr_catalog = static_cast<Directory*>(node_ptr__);
+  m_write_absolute_path(m_curr_catalog, m_curr_catalog_path);
+  m_log(COMMAND_TYPE::CHANGE_DIR, path);
 }
 
 void
 File_system_emulator::remove_dir(std::string_view path)
 {
+  if(m_table)
+    {
+      m_table->remove_dir(path);
+      m_log(COMMAND_TYPE::REMOVE_DIR, path);
+      return;
+    }
+
   Node* node_ptr__ = m_find_node_by_path(path);
 
   if(!node_ptr__ || node_ptr__->m_type != NODE_TYPE::DIRECTORY)
@@ -182,26 +264,48 @@ File_system_emulator::remove_dir(std::string_view path)
   if(dir_ptr__ == m_curr_catalog)
     throw std::runtime_error("ERROR: Can`t delete current directory.");
 
-  if(!dir_ptr__->m_childs.empty())
+  const std::vector<Node*>& childs__ = dir_ptr__->childs();
+
+  if(!std::all_of(childs__.begin(), childs__.end(), is_dangling))
     throw std::runtime_error("ERROR: Can`t delete non-empty directory");
 
+  // Dangling links don't make a directory any less empty, they're reclaimed along with it.
+  while(!dir_ptr__->m_childs.empty())
+    m_release_dlink(static_cast<Link*>(dir_ptr__->m_childs.back()));
+
   m_remove_node(node_ptr__);
+  m_log(COMMAND_TYPE::REMOVE_DIR, path);
 }
 
 void
 File_system_emulator::remove_file(std::string_view path)
 {
+  if(m_table)
+    {
+      m_table->remove_file(path);
+      m_log(COMMAND_TYPE::REMOVE_FILE, path);
+      return;
+    }
+
   Node* node_ptr__ = m_find_node_by_path(path);
 
   if(!node_ptr__ || node_ptr__->m_type == NODE_TYPE::DIRECTORY)
     throw std::runtime_error("ERROR: Path is not found.");
 
   m_remove_node(node_ptr__);
+  m_log(COMMAND_TYPE::REMOVE_FILE, path);
 }
 
 void
 File_system_emulator::copy(std::string_view source, std::string_view dest)
 {
+  if(m_table)
+    {
+      m_table->copy(source, dest);
+      m_log(COMMAND_TYPE::COPY, source, dest);
+      return;
+    }
+
   Node* source_stpr__ = m_find_node_by_path(source);
 
   if(!source_stpr__)
@@ -212,12 +316,44 @@ File_system_emulator::copy(std::string_view source, std::string_view dest)
   if(!dest_ptr__ || dest_ptr__->m_type != NODE_TYPE::DIRECTORY)
     throw std::runtime_error("ERROR: Path is not found.");
 
-  m_copy(source_stpr__, static_cast<Directory*>(dest_ptr__));
+  Directory* dest_dir_ptr__ = static_cast<Directory*>(dest_ptr__);
+  m_unshare(dest_dir_ptr__);
+
+  // Names are unique within a directory, so a copy over an existing name creates nothing, like MD does.
+  if(dest_dir_ptr__->find_child(Child_key::of(source_stpr__)))
+    return;
+
+  // Copies take heights over from their sources, which count dangling links the copies leave out.
+  if(m_dangling_links != 0 && source_stpr__->m_type == NODE_TYPE::DIRECTORY)
+    m_release_dangling(static_cast<Directory*>(source_stpr__));
+
+  Node* copy__;
+
+  // Counting stops at the threshold, so small subtrees are never walked twice in full.
+  if(source_stpr__->m_type == NODE_TYPE::DIRECTORY && !m_copy_on_write && m_parallel_copy_threshold != 0
+     && m_copy_threads > 1 && m_count_nodes(source_stpr__, m_parallel_copy_threshold) == m_parallel_copy_threshold)
+    copy__ = m_parallel_copy(static_cast<Directory*>(source_stpr__));
+  else
+    copy__ = m_copy(source_stpr__);
+
+  // Attach the copy only after its subtree is built, so copying a directory into its own subtree terminates. A
+  // shared copy of an ancestor of the destination gets private directories down to it first for the same reason.
+  m_unshare(dest_dir_ptr__);
+  m_add_child(dest_dir_ptr__, copy__);
+
+  m_log(COMMAND_TYPE::COPY, source, dest);
 }
 
 void
 File_system_emulator::move(std::string_view source, std::string_view dest)
 {
+  if(m_table)
+    {
+      m_table->move(source, dest);
+      m_log(COMMAND_TYPE::MOVE, source, dest);
+      return;
+    }
+
   Node* source_ptr__ = m_find_node_by_path(source);
 
   if(!source_ptr__)
@@ -228,39 +364,49 @@ File_system_emulator::move(std::string_view source, std::string_view dest)
   if(!dest_ptr__ || dest_ptr__->m_type != NODE_TYPE::DIRECTORY)
     throw std::runtime_error("ERROR: Path is not found.");
 
-  if(dest_ptr__ == source_ptr__ || source_ptr__ == m_root->m_childs.front())
+  if(dest_ptr__ == source_ptr__ || source_ptr__ == m_root->m_childs.front() || source_ptr__->m_parent == dest_ptr__)
     return;
 
-  if(source_ptr__->m_type == NODE_TYPE::DIRECTORY)
-    {
-      Directory* dir_ptr__ = static_cast<Directory*>(source_ptr__);
+  Directory* dest_dir_ptr__ = static_cast<Directory*>(dest_ptr__);
 
-      // Traverse tree from current source directory to try find any entity that have attached hard link.
-      if(m_check_on_hlinks(dir_ptr__))
-        throw std::runtime_error("ERROR: Can't move source with attached hard link.");
-    }
-  else if(source_ptr__->m_type == NODE_TYPE::FILE)
-    {
-      File* file_ptr__ = static_cast<File*>(source_ptr__);
+  // A directory moved below itself would be cut off from the drive together with its subtree.
+  for(Directory* dir__ = dest_dir_ptr__->m_parent; dir__; dir__ = dir__->m_parent)
+    if(dir__ == source_ptr__)
+      throw std::runtime_error("ERROR: Can`t move directory into its own subtree.");
 
-      if(!file_ptr__->m_hlinks.empty())
-        throw std::runtime_error("ERROR: Can't move source with attached hard link.");
-    }
+  m_unshare(dest_dir_ptr__);
+
+  // Names are unique within a directory, so the source stays where it is if the destination holds its name.
+  if(dest_dir_ptr__->find_child(Child_key::of(source_ptr__)))
+    return;
 
-  Directory* source_parent_dir_ptr__ = static_cast<Directory*>(source_ptr__->m_parent);
-  source_parent_dir_ptr__->m_childs.remove(source_ptr__);
+  if(m_check_on_hlinks(source_ptr__))
+    throw std::runtime_error("ERROR: Can't move source with attached hard link.");
 
-  Directory* dest_dir_ptr__ = static_cast<Directory*>(dest_ptr__);
-  dest_dir_ptr__->m_childs.push_front(source_ptr__);
+  m_unshare(source_ptr__->m_parent);
 
-  source_ptr__->m_parent = dest_dir_ptr__;
+  m_write_absolute_path(source_ptr__, m_path_buffer);
+  m_path_cache.invalidate(m_path_buffer);
 
-  m_update_links(source_ptr__);
+  // Links refer to their targets directly, so nothing inside the moved subtree has to be updated.
+  m_remove_child(source_ptr__->m_parent, source_ptr__);
+  m_add_child(dest_dir_ptr__, source_ptr__);
+
+  // Current directory may be a part of the moved subtree.
+  m_write_absolute_path(m_curr_catalog, m_curr_catalog_path);
+  m_log(COMMAND_TYPE::MOVE, source, dest);
 }
 
 void
 File_system_emulator::delete_tree(std::string_view path)
 {
+  if(m_table)
+    {
+      m_table->delete_tree(path);
+      m_log(COMMAND_TYPE::DELETE_TREE, path);
+      return;
+    }
+
   Node* node_ptr__ = m_find_node_by_path(path);
 
   if(!node_ptr__ || node_ptr__->m_type != NODE_TYPE::DIRECTORY)
@@ -274,344 +420,1595 @@ File_system_emulator::delete_tree(std::string_view path)
   if(target_dir_ptr__ == m_curr_catalog)
     throw std::runtime_error("ERROR: Can`t delete current directory.");
 
-  // Apply BFS to delete one by one each element from current tree.
-  // Deletion continues until either current tree is empty either throw of an exception.
-  std::queue<Node*> queue__;
+  // Make sure the tree can be deleted at all before touching it, so a failure leaves the tree untouched. Hard links
+  // placed inside the subtree go away together with it.
+  if(m_check_on_outer_hlinks(target_dir_ptr__))
+    throw std::runtime_error("ERROR: Can`t delete entity with attached hard link.");
 
-  while(!target_dir_ptr__->m_childs.empty())
-    {
-      queue__.push(target_dir_ptr__);
+  for(Directory* dir__ = m_curr_catalog; dir__; dir__ = dir__->m_parent)
+    if(dir__ == target_dir_ptr__)
+      throw std::runtime_error("ERROR: Can`t delete current directory.");
+
+  // Copies sharing the subtree keep their entities, they get private ones before the subtree is gone.
+  m_unshare(target_dir_ptr__->m_parent);
+  m_unshare_subtree(target_dir_ptr__);
 
-      while(!queue__.empty())
+  // Collect the whole subtree in pre-order.
+  std::vector<Node*> subtree__{ target_dir_ptr__ };
+
+  for(std::size_t i = 0; i < subtree__.size(); ++i)
+    {
+      if(subtree__[i]->m_type == NODE_TYPE::DIRECTORY)
         {
-          Node* node_ptr__ = queue__.front();
-          queue__.pop();
+          for(auto child__ : static_cast<Directory*>(subtree__[i])->m_childs)
+            subtree__.push_back(child__);
+        }
+    }
 
-          if(node_ptr__->m_type != NODE_TYPE::DIRECTORY)
-            m_remove_node(node_ptr__);
-          else
-            {
-              Directory* dir_ptr__ = static_cast<Directory*>(node_ptr__);
+  // Targets left for the sweeper are recorded while the subtree is released, which mustn't fail halfway.
+  if(m_deferred_dlinks)
+    m_removed_targets.reserve(m_removed_targets.size()
+                              + std::count_if(subtree__.begin(), subtree__.end(), [](const Node* node) {
+                                  return is_linkable(node) && !static_cast<const Linked_node*>(node)->dlinks().empty();
+                                }));
 
-              if(dir_ptr__->m_childs.empty())
-                m_remove_node(dir_ptr__);
-              else
-                {
-                  for(auto child__ : dir_ptr__->m_childs)
-                    queue__.push(child__);
-                }
-            }
+  m_write_absolute_path(target_dir_ptr__, m_path_buffer);
+  m_path_cache.invalidate(m_path_buffer);
+
+  // Links of the subtree stop referring to their targets first, so dynamic links left attached to entities of the
+  // subtree are exactly those placed outside of it.
+  for(auto node__ : subtree__)
+    if(!is_linkable(node__))
+      m_detach_link(static_cast<Link*>(node__));
+
+  for(auto node__ : subtree__)
+    {
+      if(!is_linkable(node__) || m_deferred_dlinks)
+        continue;
+
+      Linked_node* linked_node_ptr__ = static_cast<Linked_node*>(node__);
+
+      for(auto dlink__ : m_take_dlinks(linked_node_ptr__))
+        {
+          m_remove_child(dlink__->m_parent, dlink__);
+          m_free_node(dlink__);
         }
     }
 
-  Directory* parent__ = node_ptr__->m_parent;
-  parent__->m_childs.remove(node_ptr__);
+  m_remove_child(target_dir_ptr__->m_parent, target_dir_ptr__);
 
-  delete node_ptr__;
+  // Reversed pre-order releases children before their parents.
+  for(auto it__ = subtree__.rbegin(); it__ != subtree__.rend(); ++it__)
+    m_free_node(*it__);
+
+  m_log(COMMAND_TYPE::DELETE_TREE, path);
 };
 
 void
-File_system_emulator::print() const noexcept
+File_system_emulator::apply_batch(std::span<const Command> commands)
 {
-  std::cout << '\n';
-  m_print(m_root->m_childs.front(), 0);
-  std::cout << '\n' << std::flush;
+  m_batch_parents.clear();
+
+  for(const auto& command__ : commands)
+    {
+      FSE_PROFILE_SCOPE(m_profiler, m_profiler.latencies(command__.m_type));
+
+      switch(command__.m_type)
+        {
+        case COMMAND_TYPE::MAKE_DIR:
+        case COMMAND_TYPE::MAKE_FILE:
+          {
+            std::string_view path__ = command__.m_args[0];
+            std::string_view parent_path__ = get_parent_path(path__);
+            bool is_dir__ = command__.m_type == COMMAND_TYPE::MAKE_DIR;
+
+            // The compact storage resolves every path in full.
+            if(m_table)
+              {
+                is_dir__ ? make_dir(path__) : make_file(path__);
+                break;
+              }
+
+            Node* node_ptr__ = m_make_node(m_find_batch_parent(parent_path__), get_path_basename(path__),
+                                           is_dir__ ? NODE_TYPE::DIRECTORY : NODE_TYPE::FILE);
+            m_log(command__.m_type, path__);
+
+            // A path without a parent, e.g. "C:", may mean something else once it's resolved on its own.
+            if(is_dir__ && node_ptr__ && !parent_path__.empty() && path__.find('[') == std::string_view::npos)
+              m_batch_parents.emplace(path__, static_cast<Directory*>(node_ptr__));
+            break;
+          }
+        case COMMAND_TYPE::MAKE_HLINK: make_hlink(command__.m_args[0], command__.m_args[1]); break;
+        case COMMAND_TYPE::MAKE_DLINK: make_dlink(command__.m_args[0], command__.m_args[1]); break;
+        case COMMAND_TYPE::REMOVE_FILE: remove_file(command__.m_args[0]); break;
+        case COMMAND_TYPE::COPY: copy(command__.m_args[0], command__.m_args[1]); break;
+        case COMMAND_TYPE::CHANGE_DIR:
+          // Relative paths resolved so far start from another directory now.
+          m_batch_parents.clear();
+          change_dir(command__.m_args[0]);
+          break;
+        case COMMAND_TYPE::REMOVE_DIR:
+          m_batch_parents.clear();
+          remove_dir(command__.m_args[0]);
+          break;
+        case COMMAND_TYPE::DELETE_TREE:
+          m_batch_parents.clear();
+          delete_tree(command__.m_args[0]);
+          break;
+        case COMMAND_TYPE::MOVE:
+          m_batch_parents.clear();
+          move(command__.m_args[0], command__.m_args[1]);
+          break;
+        case COMMAND_TYPE::BEGIN: begin(); break;
+        case COMMAND_TYPE::COMMIT: commit(); break;
+        case COMMAND_TYPE::ROLLBACK: rollback(); break;
+        default: break;
+        }
+
+      // Dangling links are reclaimed a slice at a time, so no single command pays for all links of a target.
+      if(!m_removed_targets.empty())
+        m_sweep_dlinks(DLINK_SWEEP_SLICE);
+    }
 }
 
-std::string
-File_system_emulator::m_to_absolute_path(std::string_view path, Directory* dir)
+void
+File_system_emulator::begin()
 {
-  if(is_absolute_path(path))
-    return std::string(path);
+  if(m_in_transaction)
+    throw std::runtime_error("ERROR: Transaction is already open.");
 
-  std::string absolute_path__{ path };
+  if(m_table)
+    throw std::runtime_error("ERROR: Transactions aren`t supported by the compact storage.");
 
-  while(dir)
-    {
-      absolute_path__ = dir->m_name + '\\' + absolute_path__;
-      dir = dir->m_parent;
-    }
+  m_in_transaction = true;
+  m_recording = true;
+  m_log(COMMAND_TYPE::BEGIN, {});
+}
 
-  return absolute_path__;
+void
+File_system_emulator::commit()
+{
+  if(!m_in_transaction)
+    throw std::runtime_error("ERROR: No transaction is open.");
+
+  // Removed targets of dangling links are left to the sweeper.
+  for(const Undo_record& record__ : m_undo_log)
+    if(record__.m_type == UNDO_TYPE::FREE_NODE && !record__.m_node->m_removed)
+      m_destroy_node(record__.m_node);
+
+  m_undo_log.clear();
+  m_retired_nodes = {};
+  m_in_transaction = false;
+  m_recording = false;
+  m_log(COMMAND_TYPE::COMMIT, {});
 }
 
-Node*
-File_system_emulator::m_find_node_by_path(std::string_view path)
+void
+File_system_emulator::rollback()
 {
-  // Can occur if relative path is something like "Dir" so there is no parent path.
-  if(path.empty())
-    return m_curr_catalog;
+  if(!m_in_transaction)
+    throw std::runtime_error("ERROR: No transaction is open.");
 
-  // Choose start point of iteration over fse tree.
-  Directory* curr__ = is_absolute_path(path) ? m_root : m_curr_catalog;
-  // Get all node names from path for further search.
-  std::vector<std::string_view> path_list__ = split_path(path);
+  // Undoing goes through the same helpers as the changes, they mustn't record anything now.
+  m_in_transaction = false;
+  m_recording = false;
 
-  bool is_node_exists = false;
+  // Cached paths may lead to entities the transaction added. A cache larger than the log isn't emptied, that would
+  // cost more than the transaction itself, only paths of the added entities are dropped then.
+  bool clear_cache__ = m_path_cache.stats().m_size <= m_undo_log.size();
 
-  for(auto entity_name__ : path_list__)
+  for(auto it__ = m_undo_log.rbegin(); it__ != m_undo_log.rend(); ++it__)
     {
-      is_node_exists = false;
-
-      for(auto child : curr__->m_childs)
+      if(!clear_cache__ && (it__->m_type == UNDO_TYPE::ADD_CHILD || it__->m_type == UNDO_TYPE::MATERIALIZE))
         {
-          if(child->m_name == entity_name__)
-            {
-              is_node_exists = true;
-
-              if(child->m_type == NODE_TYPE::DIRECTORY)
-                {
-                  curr__ = static_cast<Directory*>(child);
-                  break;
-                }
-              else
-                return child;
-            }
+          m_write_absolute_path(it__->m_node, m_path_buffer);
+          m_path_cache.invalidate(m_path_buffer);
         }
 
-      // If next subdirectory was not found then provided path doesn't exists.
-      if(!is_node_exists)
-        return nullptr;
+      m_undo(*it__);
     }
 
-  return curr__;
+  m_undo_log.clear();
+
+  if(clear_cache__)
+    m_path_cache.clear();
+
+  m_batch_parents.clear();
+  m_write_absolute_path(m_curr_catalog, m_curr_catalog_path);
+  m_log(COMMAND_TYPE::ROLLBACK, {});
 }
 
-Node*
-File_system_emulator::m_make_node(std::string_view path, std::string_view name, NODE_TYPE type)
+std::vector<std::string>
+File_system_emulator::find(std::string_view pattern, std::string_view root)
 {
-  Node* node_ptr__ = m_find_node_by_path(path);
+  if(m_table)
+    return m_table->find(pattern, root);
 
-  if(!node_ptr__ || node_ptr__->m_type != NODE_TYPE::DIRECTORY)
-    throw std::runtime_error("ERROR: Path not found.");
+  Node* root_ptr__ = root.empty() ? m_root->m_childs.front() : m_find_node_by_path(root);
 
-  Directory* parent_dir__ = static_cast<Directory*>(node_ptr__);
+  if(!root_ptr__ || root_ptr__->m_type != NODE_TYPE::DIRECTORY)
+    throw std::runtime_error("ERROR: Path is not found.");
 
-  // Checking if there any entity with same name...
-  for(auto child__ : parent_dir__->m_childs)
-    {
-      if(child__->m_name == name)
-        {
-          // If types and names are equal then this attempt to create the same entity with the same name,
-          // then just create nothing...
-          if(child__->m_type == type)
-            return nullptr;
+  std::string root_path__;
+  m_write_absolute_path(root_ptr__, root_path__);
 
-          if(child__->m_type == NODE_TYPE::FILE)
-            throw std::runtime_error("ERROR: Can`t create a directory - File with the same name exists.");
-          if(child__->m_type == NODE_TYPE::DIRECTORY)
-            throw std::runtime_error("ERROR: Can`t create a file - Directory with the same name exists.");
-        }
-    }
+  std::vector<std::string> paths__;
+  auto append_paths__ = [&](Name_id name) {
+    for(const Node* node__ : m_index.nodes(name))
+      m_append_visible_paths(node__, root_path__, paths__);
+  };
 
-  Node* new_node_ptr__;
+  std::size_t wildcard__ = pattern.find_first_of("*?");
 
-  switch(type)
+  if(wildcard__ == std::string_view::npos)
     {
-    case NODE_TYPE::FILE: new_node_ptr__ = new File(); break;
-    case NODE_TYPE::HLINK: new_node_ptr__ = new Node(type); break;
-    case NODE_TYPE::DLINK: new_node_ptr__ = new Node(type); break;
-    case NODE_TYPE::DIRECTORY: new_node_ptr__ = new Directory(); break;
-    default: break;
-    }
+      Name_id name__ = m_names.find(pattern);
 
-  new_node_ptr__->m_name = name;
-  new_node_ptr__->m_parent = parent_dir__;
-
-  parent_dir__->m_childs.push_front(new_node_ptr__);
+      if(name__ != Name_table::npos)
+        append_paths__(name__);
+    }
+  else if(std::size_t dot__ = pattern.find_last_of('.');
+          dot__ != std::string_view::npos && dot__ > pattern.find_last_of("*?"))
+    {
+      // Every match ends with the extension of the pattern, so only names with that extension are checked.
+      for(Name_id name__ : m_index.with_extension(pattern.substr(dot__ + 1)))
+        if(Name_index::matches(pattern, m_names.name(name__)))
+          append_paths__(name__);
+    }
+  else
+    for(Name_id name__ = 0; name__ < m_index.names(); ++name__)
+      if(Name_index::matches(pattern, m_names.name(name__)))
+        append_paths__(name__);
 
-  return new_node_ptr__;
+  std::sort(paths__.begin(), paths__.end());
+  return paths__;
 }
 
 void
-File_system_emulator::m_make_link(std::string_view source, std::string_view dest, std::string_view name, NODE_TYPE type)
+File_system_emulator::print() const noexcept
 {
-  Node* source_ptr__ = m_find_node_by_path(source);
-
-  if(!source_ptr__)
-    throw std::runtime_error("ERROR: Path is not found.");
+  print(std::cout);
+}
 
-  Node* link__ = m_make_node(dest, name, type);
+void
+File_system_emulator::print(std::ostream& stream) const
+{
+  FSE_PROFILE_SCOPE(m_profiler, m_profiler.print_latencies());
 
-  // If link with the same name no present by this path.
-  if(link__)
+  if(m_table)
     {
-      Linked_node* linked_node__ = static_cast<Linked_node*>(source_ptr__);
-
-      if(link__->m_type == NODE_TYPE::HLINK)
-        linked_node__->m_hlinks.push_front(link__);
-      else
-        linked_node__->m_dlinks.push_front(link__);
+      m_table->print(stream);
+      return;
     }
+
+  Tree_writer writer__{ stream };
+  m_print(m_root->m_childs.front(), writer__);
+  writer__.finish();
 }
 
 void
-File_system_emulator::m_remove_node(Node* node)
+File_system_emulator::publish_view()
 {
-  if(node->m_type == NODE_TYPE::FILE || node->m_type == NODE_TYPE::DIRECTORY)
-    {
-      Linked_node* linked_node_ptr__ = static_cast<Linked_node*>(node);
+  if(m_table)
+    throw std::runtime_error("ERROR: Views aren`t supported by the compact storage.");
 
-      if(!linked_node_ptr__->m_hlinks.empty())
-        throw std::runtime_error("ERROR: Can`t delete entity with attached hard link.");
+  const Directory* drive__ = static_cast<const Directory*>(m_root->m_childs.front());
+  std::uint64_t version__ = m_view_version.load(std::memory_order_relaxed) + 1;
 
-      // Delete all dynamic links that attached to this node.
-      while(!linked_node_ptr__->m_dlinks.empty())
-        {
-          Node* child__ = linked_node_ptr__->m_dlinks.front();
-          Directory* parent__ = child__->m_parent;
+  // View is built without the lock, readers only ever wait for the pointer to be swapped.
+  std::shared_ptr<const Tree_view> view__
+      = Tree_view::build(drive__, m_curr_catalog_path, m_names, version__, m_view_listings);
 
-          parent__->m_childs.remove(child__);
-          linked_node_ptr__->m_dlinks.pop_front();
+  {
+    std::lock_guard<std::mutex> lock__{ m_view_mutex };
+    m_view.swap(view__);
+  }
 
-          delete child__;
-        }
-    }
+  m_view_version.store(version__, std::memory_order_release);
 
-  Directory* parent__ = node->m_parent;
-  parent__->m_childs.remove(node);
+  // Previous view is destroyed here unless readers still hold it, then the last of them destroys it.
+}
 
-  delete node;
-};
+std::shared_ptr<const Tree_view>
+File_system_emulator::view() const
+{
+  std::lock_guard<std::mutex> lock__{ m_view_mutex };
+  return m_view;
+}
 
-void
-File_system_emulator::m_copy(Node* source, Directory* destination)
+bool
+File_system_emulator::refresh_view(std::shared_ptr<const Tree_view>& view) const
 {
-  switch(source->m_type)
-    {
-    case NODE_TYPE::FILE:
-      {
-        File* file_ptr__ = new File();
-        file_ptr__->m_name = source->m_name;
-        file_ptr__->m_parent = destination;
+  if(view && view->version() == m_view_version.load(std::memory_order_acquire))
+    return false;
 
-        destination->m_childs.push_front(file_ptr__);
-        break;
-      }
-    case NODE_TYPE::HLINK:
-      {
-        Node* hlink_ptr__ = new Node(NODE_TYPE::HLINK);
-        hlink_ptr__->m_name = source->m_name;
-        hlink_ptr__->m_parent = destination;
+  std::shared_ptr<const Tree_view> latest__ = this->view();
 
-        std::string_view linked_node_path__ = get_link_basename(hlink_ptr__->m_name);
-        Linked_node* linked_node_ptr__ = static_cast<Linked_node*>(m_find_node_by_path(linked_node_path__));
+  if(latest__ == view)
+    return false;
 
-        linked_node_ptr__->m_hlinks.push_front(hlink_ptr__);
-        destination->m_childs.push_front(hlink_ptr__);
-        break;
-      }
-    case NODE_TYPE::DLINK:
-      {
-        Node* dlink_ptr__ = new Node(NODE_TYPE::DLINK);
-        dlink_ptr__->m_name = source->m_name;
-        dlink_ptr__->m_parent = destination;
+  view = std::move(latest__);
+  return true;
+}
 
-        std::string_view linked_node_path__ = get_link_basename(dlink_ptr__->m_name);
-        Linked_node* linked_node_ptr__ = static_cast<Linked_node*>(m_find_node_by_path(linked_node_path__));
+std::string
+File_system_emulator::m_to_absolute_path(const Node* node) const
+{
+  std::string absolute_path__;
+  m_write_absolute_path(node, absolute_path__);
+  return absolute_path__;
+}
 
-        linked_node_ptr__->m_dlinks.push_front(dlink_ptr__);
-        destination->m_childs.push_front(dlink_ptr__);
-        break;
-      }
-    case NODE_TYPE::DIRECTORY:
-      {
-        Directory* dir_ptr__ = new Directory();
-        dir_ptr__->m_name = source->m_name;
-        dir_ptr__->m_parent = destination;
+void
+File_system_emulator::m_write_absolute_path(const Node* node, std::string& buffer) const
+{
+  // First walk up measures the path, so the second one can fill the buffer from its end without reallocations.
+  std::size_t size__ = m_names.name(node->m_name).size();
 
-        Directory* source_as_dir__ = static_cast<Directory*>(source);
+  for(const Directory* dir__ = node->m_parent; dir__; dir__ = dir__->m_parent)
+    size__ += m_names.name(dir__->m_name).size() + 1;
 
-        for(auto child : source_as_dir__->m_childs)
-          m_copy(child, dir_ptr__);
+  buffer.resize(size__);
 
-        destination->m_childs.push_front(dir_ptr__);
-        break;
-      }
-    default: break;
+  char* end__ = buffer.data() + size__;
+
+  for(const Node* curr__ = node; curr__; curr__ = curr__->m_parent)
+    {
+      std::string_view name__ = m_names.name(curr__->m_name);
+
+      end__ -= name__.size();
+      name__.copy(end__, name__.size());
+
+      if(curr__->m_parent)
+        *--end__ = '\\';
     }
 }
 
-bool
-File_system_emulator::m_check_on_hlinks(Node* node)
+void
+File_system_emulator::m_append_visible_paths(const Node* node, std::string_view root_path,
+                                             std::vector<std::string>& paths) const
 {
-  if(node->m_type == NODE_TYPE::FILE)
+  auto below_root__ = [root_path](std::string_view path) {
+    return path.starts_with(root_path) && (path.size() == root_path.size() || path[root_path.size()] == '\\');
+  };
+
+  if(m_sharing_dirs == 0)
     {
-      Linked_node* linked_node_ptr__ = static_cast<Linked_node*>(node);
+      std::string path__;
+      m_write_absolute_path(node, path__);
 
-      if(!linked_node_ptr__->m_hlinks.empty())
-        return true;
+      if(below_root__(path__))
+        paths.push_back(std::move(path__));
+      return;
     }
-  else if(node->m_type == NODE_TYPE::DIRECTORY)
-    {
-      Directory* dir_ptr__ = static_cast<Directory*>(node);
 
-      if(!dir_ptr__->m_hlinks.empty())
-        return true;
+  // Ancestors are walked up with the part of the path below them, a shared ancestor forks the walk into its copies.
+  std::vector<std::pair<const Directory*, std::string>> stack__;
+
+  if(!node->m_parent)
+    {
+      std::string path__{ m_names.name(node->m_name) };
 
-      for(auto child__ : dir_ptr__->m_childs)
-        if(m_check_on_hlinks(child__))
-          return true;
+      if(below_root__(path__))
+        paths.push_back(std::move(path__));
+      return;
     }
 
-  return false;
-}
+  stack__.emplace_back(node->m_parent, "\\" + std::string{ m_names.name(node->m_name) });
 
-void
-File_system_emulator::m_update_links(Node* node)
-{
-  if(node->m_type == NODE_TYPE::DIRECTORY || node->m_type == NODE_TYPE::FILE)
+  while(!stack__.empty())
     {
-      Linked_node* linked_node__ = static_cast<Linked_node*>(node);
+      auto [dir__, suffix__] = std::move(stack__.back());
+      stack__.pop_back();
+
+      for(const Directory* sharer__ : dir__->m_sharers)
+        stack__.emplace_back(sharer__, suffix__);
 
-      if(!linked_node__->m_dlinks.empty())
+      std::string_view name__ = m_names.name(dir__->m_name);
+
+      if(!dir__->m_parent)
         {
-          std::string updated_path__ = m_to_absolute_path(linked_node__->m_name, linked_node__->m_parent);
+          std::string path__ = std::string{ name__ } + suffix__;
 
-          for(auto dlink__ : linked_node__->m_dlinks)
-            dlink__->m_name = "dlink[" + updated_path__ + "]";
+          if(below_root__(path__))
+            paths.push_back(std::move(path__));
         }
+      else
+        stack__.emplace_back(dir__->m_parent, "\\" + std::string{ name__ } + suffix__);
     }
+}
 
-  if(node->m_type == NODE_TYPE::DIRECTORY)
+std::string
+File_system_emulator::m_display_name(const Node* node) const
+{
+  if(node->m_type == NODE_TYPE::HLINK || node->m_type == NODE_TYPE::DLINK)
     {
-      Directory* dir_ptr__ = static_cast<Directory*>(node);
+      const Link* link__ = static_cast<const Link*>(node);
+      const char* prefix__ = node->m_type == NODE_TYPE::HLINK ? HLINK_PREFIX : DLINK_PREFIX;
 
-      for(auto child__ : dir_ptr__->m_childs)
-        m_update_links(child__);
+      return prefix__ + m_to_absolute_path(link__->m_target) + ']';
     }
+
+  return std::string(m_names.name(node->m_name));
 }
 
-void
-File_system_emulator::m_print(Node* node, std::size_t depth) const noexcept
+Node*
+File_system_emulator::m_find_node_by_path(std::string_view path)
 {
-  struct
-  {
-    bool
-    operator()(Node* lhs, Node* rhs)
+  // Can occur if relative path is something like "Dir" so there is no parent path.
+  if(path.empty())
+    return m_curr_catalog;
+
+  // Paths through links are never cached, names of dynamic links change together with paths of their targets.
+  if(path.find('[') != std::string_view::npos)
+    return m_resolve_path(path);
+
+  std::string_view absolute_path__ = path;
+
+  if(!is_absolute_path(path))
     {
-      return lhs->m_name < rhs->m_name;
+      m_path_buffer.assign(m_curr_catalog_path);
+      m_path_buffer += '\\';
+      m_path_buffer += path;
+
+      absolute_path__ = m_path_buffer;
     }
-  } comp__;
 
-  if(node->m_type == NODE_TYPE::DIRECTORY)
-    {
-      Directory* dir_ptr__ = static_cast<Directory*>(node);
-      dir_ptr__->m_childs.sort(comp__);
+  if(Node* node_ptr__ = m_path_cache.find(absolute_path__))
+    return node_ptr__;
 
-      for(std::size_t i = 0; i < depth; ++i)
-        std::cout << ((i == depth - 1) ? "|_" : "| ");
+  Node* node_ptr__ = m_resolve_path(path);
 
-      std::cout << node->m_name << '\n';
+  if(node_ptr__)
+    m_path_cache.insert(absolute_path__, node_ptr__);
 
-      for(auto child : dir_ptr__->m_childs)
-        m_print(child, depth + 1);
-    }
-  else
+  return node_ptr__;
+}
+
+Node*
+File_system_emulator::m_resolve_path(std::string_view path)
+{
+  // Choose start point of iteration over fse tree.
+  Directory* curr__ = is_absolute_path(path) ? m_root : m_curr_catalog;
+  // Get all node names from path for further search.
+  std::vector<std::string_view> path_list__ = split_path(path);
+
+  for(auto entity_name__ : path_list__)
     {
-      for(std::size_t i = 0; i < depth; ++i)
-        std::cout << ((i == depth - 1) ? "|_" : "| ");
+      FSE_PROFILE_COUNT(m_profiler, PATH_SEGMENTS, 1);
 
-      std::cout << node->m_name << '\n';
-    }
-}
\ No newline at end of file
+      NODE_TYPE link_type__;
+      std::string_view target_path__;
+
+      // Links are found by their targets, so resolve the path enclosed in the link's name first.
+      if(parse_link_name(entity_name__, link_type__, target_path__))
+        {
+          Node* target__ = m_find_node_by_path(target_path__);
+
+          if(!target__ || !is_linkable(target__))
+            return nullptr;
+
+          return curr__->find_child(Child_key::link(link_type__, static_cast<Linked_node*>(target__)));
+        }
+
+      // Name that has never been interned can't belong to any node.
+      Name_id name_id__ = m_names.find(entity_name__);
+
+      if(name_id__ == Name_table::npos)
+        return nullptr;
+
+      // Entities found by path may be changed or linked to, so they're never the shared ones of a copy.
+      if(curr__->m_shared)
+        m_materialize(curr__);
+
+      Node* child__ = curr__->find_child(Child_key::named(name_id__));
+
+      // If next subdirectory was not found then provided path doesn't exists.
+      if(!child__)
+        return nullptr;
+
+      if(child__->m_type != NODE_TYPE::DIRECTORY)
+        return child__;
+
+      curr__ = static_cast<Directory*>(child__);
+    }
+
+  return curr__;
+}
+
+Node*
+File_system_emulator::m_find_batch_parent(std::string_view path)
+{
+  if(path.empty())
+    return m_curr_catalog;
+
+  if(path.find('[') != std::string_view::npos)
+    return m_find_node_by_path(path);
+
+  // Look for the longest prefix of the path that ends on a separator and is already resolved.
+  Directory* curr__ = is_absolute_path(path) ? m_root : m_curr_catalog;
+  std::size_t resolved__ = 0;
+
+  for(std::size_t end__ = path.size(); end__ != std::string_view::npos; end__ = path.find_last_of('\\', end__ - 1))
+    {
+      if(auto it__ = m_batch_parents.find(path.substr(0, end__)); it__ != m_batch_parents.end())
+        {
+          curr__ = it__->second;
+          resolved__ = end__ + 1;
+          break;
+        }
+
+      if(end__ == 0)
+        break;
+    }
+
+  // Walk the rest of the path, remembering every directory on the way.
+  while(resolved__ <= path.size())
+    {
+      FSE_PROFILE_COUNT(m_profiler, PATH_SEGMENTS, 1);
+
+      std::size_t end__ = std::min(path.find('\\', resolved__), path.size());
+      Name_id name_id__ = m_names.find(path.substr(resolved__, end__ - resolved__));
+
+      if(name_id__ == Name_table::npos)
+        return nullptr;
+
+      if(curr__->m_shared)
+        m_materialize(curr__);
+
+      Node* child__ = curr__->find_child(Child_key::named(name_id__));
+
+      if(!child__ || child__->m_type != NODE_TYPE::DIRECTORY)
+        return child__;
+
+      curr__ = static_cast<Directory*>(child__);
+      m_batch_parents.emplace(path.substr(0, end__), curr__);
+      resolved__ = end__ + 1;
+    }
+
+  return curr__;
+}
+
+Node*
+File_system_emulator::m_make_node(Node* parent, std::string_view name, NODE_TYPE type)
+{
+  if(!parent || parent->m_type != NODE_TYPE::DIRECTORY)
+    throw std::runtime_error("ERROR: Path not found.");
+
+  Directory* parent_dir__ = static_cast<Directory*>(parent);
+  m_unshare(parent_dir__);
+
+  Name_id name_id__ = m_names.find(name);
+
+  // Checking if there any entity with same name...
+  if(Node* child__ = name_id__ != Name_table::npos ? parent_dir__->find_child(Child_key::named(name_id__)) : nullptr)
+    {
+      if(child__->m_type == NODE_TYPE::FILE && type != NODE_TYPE::FILE)
+        throw std::runtime_error("ERROR: Can`t create a directory - File with the same name exists.");
+      if(child__->m_type == NODE_TYPE::DIRECTORY && type != NODE_TYPE::DIRECTORY)
+        throw std::runtime_error("ERROR: Can`t create a file - Directory with the same name exists.");
+
+      // If types and names are equal then this attempt to create the same entity with the same name,
+      // then just create nothing...
+      return nullptr;
+    }
+
+  Node* new_node_ptr__ = m_new_node(type);
+  new_node_ptr__->m_name = m_names.intern(name);
+  m_index.insert(new_node_ptr__);
+  m_add_child(parent_dir__, new_node_ptr__);
+
+  return new_node_ptr__;
+}
+
+void
+File_system_emulator::m_make_link(std::string_view source, std::string_view dest, NODE_TYPE type)
+{
+  Node* source_ptr__ = m_find_node_by_path(source);
+
+  if(!source_ptr__)
+    throw std::runtime_error("ERROR: Path is not found.");
+
+  if(!is_linkable(source_ptr__))
+    throw std::runtime_error("ERROR: Can`t create a link to a link.");
+
+  Node* dest_ptr__ = m_find_node_by_path(dest);
+
+  if(!dest_ptr__ || dest_ptr__->m_type != NODE_TYPE::DIRECTORY)
+    throw std::runtime_error("ERROR: Path not found.");
+
+  Directory* dest_dir_ptr__ = static_cast<Directory*>(dest_ptr__);
+  Linked_node* linked_node__ = static_cast<Linked_node*>(source_ptr__);
+
+  // Shared directories never contain links.
+  m_unshare(dest_dir_ptr__);
+
+  // If the same link is already present by this path then just create nothing...
+  if(dest_dir_ptr__->find_child(Child_key::link(type, linked_node__)))
+    return;
+
+  Link* link__ = static_cast<Link*>(m_new_node(type));
+
+  m_attach_link(link__, linked_node__);
+  m_add_child(dest_dir_ptr__, link__);
+}
+
+void
+File_system_emulator::m_log(COMMAND_TYPE type, std::string_view first, std::string_view second)
+{
+  if(!m_journal.is_open())
+    return;
+
+  Command command__;
+  command__.m_type = type;
+  command__.m_args = { first, second };
+  command__.m_argc = COMMANDS[static_cast<std::size_t>(type)].m_arity;
+
+  // A record that failed to commit stays pending, so it counts even if the append throws.
+  ++m_sequence;
+  m_journal.append(command__);
+}
+
+Node*
+File_system_emulator::m_new_node(NODE_TYPE type)
+{
+  Node* node__;
+
+  switch(type)
+    {
+    case NODE_TYPE::FILE: node__ = m_files.create(); break;
+    case NODE_TYPE::HLINK: node__ = m_links.create(type); break;
+    case NODE_TYPE::DLINK: node__ = m_links.create(type); break;
+    case NODE_TYPE::DIRECTORY:
+      node__ = m_directories.create();
+      ++m_fanout[0];
+      break;
+    default: return nullptr;
+    }
+
+  m_record(UNDO_TYPE::NEW_NODE, node__);
+  return node__;
+}
+
+void
+File_system_emulator::m_free_node(Node* node)
+{
+  FSE_PROFILE_COUNT(m_profiler, DELETED_NODES, 1);
+
+  m_record(UNDO_TYPE::FREE_NODE, node);
+
+  if(is_linkable(node))
+    m_index.erase(node);
+
+  if(node->m_type == NODE_TYPE::DIRECTORY)
+    {
+      Directory* dir_ptr__ = static_cast<Directory*>(node);
+
+      if(dir_ptr__->m_shared)
+        {
+          dir_ptr__->m_shared->remove_sharer(dir_ptr__);
+          --m_sharing_dirs;
+        }
+
+      // Children of a released subtree aren't removed one by one, so the directory leaves the bucket it's in.
+      --m_fanout[fanout_bucket(dir_ptr__->m_childs.size())];
+    }
+
+  // Dynamic links still attached to the node are left dangling, so views don't show them anymore.
+  if(is_linkable(node))
+    for(const Link* dlink__ : static_cast<Linked_node*>(node)->dlinks())
+      m_view_listings.touch(dlink__->m_parent);
+
+  if(is_linkable(node) && m_keep_removed(static_cast<Linked_node*>(node)))
+    return;
+
+  // A transaction may put the node back, so it's released by commit().
+  if(m_recording)
+    {
+      ++m_retired_nodes[static_cast<std::size_t>(node->m_type)];
+      return;
+    }
+
+  m_destroy_node(node);
+}
+
+void
+File_system_emulator::m_destroy_node(Node* node) noexcept
+{
+  if(node->m_type == NODE_TYPE::DIRECTORY)
+    m_view_listings.forget(static_cast<Directory*>(node));
+
+  switch(node->m_type)
+    {
+    case NODE_TYPE::FILE: m_files.destroy(static_cast<File*>(node)); break;
+    case NODE_TYPE::HLINK: m_links.destroy(static_cast<Link*>(node)); break;
+    case NODE_TYPE::DLINK: m_links.destroy(static_cast<Link*>(node)); break;
+    case NODE_TYPE::DIRECTORY: m_directories.destroy(static_cast<Directory*>(node)); break;
+    default: break;
+    }
+}
+
+void
+File_system_emulator::m_restore_node(Node* node)
+{
+  if(node->m_removed)
+    {
+      Linked_node* target__ = static_cast<Linked_node*>(node);
+
+      // The sweeper doesn't run inside a transaction, so targets removed by it are the last ones in the list.
+      m_removed_targets.pop_back();
+      target__->m_removed = false;
+      m_removed_dirs -= node->m_type == NODE_TYPE::DIRECTORY;
+      m_dangling_links -= target__->dlinks().size();
+    }
+  else
+    --m_retired_nodes[static_cast<std::size_t>(node->m_type)];
+
+  if(is_linkable(node))
+    m_index.insert(node);
+
+  if(node->m_type == NODE_TYPE::DIRECTORY)
+    {
+      Directory* dir_ptr__ = static_cast<Directory*>(node);
+
+      if(dir_ptr__->m_shared)
+        {
+          dir_ptr__->m_shared->add_sharer(dir_ptr__);
+          ++m_sharing_dirs;
+        }
+
+      ++m_fanout[fanout_bucket(dir_ptr__->m_childs.size())];
+    }
+}
+
+void
+File_system_emulator::m_undo(const Undo_record& record)
+{
+  switch(record.m_type)
+    {
+    case UNDO_TYPE::NEW_NODE: m_free_node(record.m_node); break;
+    case UNDO_TYPE::FREE_NODE: m_restore_node(record.m_node); break;
+    case UNDO_TYPE::ADD_CHILD: m_remove_child(static_cast<Directory*>(record.m_other), record.m_node); break;
+    case UNDO_TYPE::REMOVE_CHILD: m_add_child(static_cast<Directory*>(record.m_other), record.m_node); break;
+    case UNDO_TYPE::ATTACH_LINK: m_detach_link(static_cast<Link*>(record.m_node)); break;
+    case UNDO_TYPE::DETACH_LINK:
+      m_attach_link(static_cast<Link*>(record.m_node), static_cast<Linked_node*>(record.m_other));
+      break;
+    case UNDO_TYPE::SHARE:
+      {
+        Directory* dir__ = static_cast<Directory*>(record.m_node);
+
+        dir__->m_shared->remove_sharer(dir__);
+        dir__->m_shared = nullptr;
+        --m_sharing_dirs;
+        m_view_listings.touch(dir__);
+        break;
+      }
+    case UNDO_TYPE::MATERIALIZE:
+      {
+        Directory* dir__ = static_cast<Directory*>(record.m_node);
+
+        // Later changes are undone, so the children are the copies made by the materialization. Removing them one by
+        // one would lower heights of the ancestors, which still count the shared children.
+        --m_fanout[fanout_bucket(dir__->m_childs.size())];
+        ++m_fanout[0];
+
+        while(!dir__->m_childs.empty())
+          {
+            Node* child__ = dir__->m_childs.back();
+
+            dir__->remove_child(child__, m_names);
+            m_free_node(child__);
+          }
+
+        dir__->m_height = record.m_height;
+        dir__->m_tallest_childs = 0;
+        m_share(dir__, static_cast<Directory*>(record.m_other));
+        break;
+      }
+    case UNDO_TYPE::CHANGE_DIR: m_curr_catalog = static_cast<Directory*>(record.m_node); break;
+    default: break;
+    }
+}
+
+void
+File_system_emulator::m_remove_node(Node* node)
+{
+  if(node->m_type == NODE_TYPE::FILE || node->m_type == NODE_TYPE::DIRECTORY)
+    {
+      Linked_node* linked_node_ptr__ = static_cast<Linked_node*>(node);
+
+      if(!linked_node_ptr__->hlinks().empty())
+        throw std::runtime_error("ERROR: Can`t delete entity with attached hard link.");
+
+      m_write_absolute_path(node, m_path_buffer);
+      m_path_cache.invalidate(m_path_buffer);
+
+      // Delete all dynamic links that attached to this node, or leave them to the sweeper.
+      if(m_deferred_dlinks)
+        m_removed_targets.reserve(m_removed_targets.size() + 1);
+      else
+        for(auto dlink__ : m_take_dlinks(linked_node_ptr__))
+          {
+            m_remove_child(dlink__->m_parent, dlink__);
+            m_free_node(dlink__);
+          }
+    }
+  else
+    m_detach_link(static_cast<Link*>(node));
+
+  m_unshare(node->m_parent);
+  m_remove_child(node->m_parent, node);
+
+  m_free_node(node);
+};
+
+void
+File_system_emulator::m_add_child(Directory* dir, Node* child)
+{
+  // Names of links follow the paths of their targets, the child may bring targets to a new place.
+  m_view_listings.touch(dir);
+
+  if(m_linked_nodes != 0)
+    m_view_listings.touch_links(child);
+
+  m_record(UNDO_TYPE::ADD_CHILD, child, dir);
+
+  std::size_t size__ = dir->m_childs.size();
+  dir->add_child(child, m_names);
+
+  --m_fanout[fanout_bucket(size__)];
+  ++m_fanout[fanout_bucket(size__ + 1)];
+
+  // A directory that grows wasn't among the tallest children of its parent unless the parent grows as well.
+  for(std::uint32_t height__ = Directory::levels_below(child) + 1; dir && dir->m_height <= height__; ++height__)
+    {
+      bool grows__ = dir->m_height < height__;
+
+      dir->fit_height(child);
+
+      if(!grows__)
+        break;
+
+      child = dir;
+      dir = dir->m_parent;
+    }
+}
+
+void
+File_system_emulator::m_remove_child(Directory* dir, Node* child)
+{
+  m_view_listings.touch(dir);
+  m_record(UNDO_TYPE::REMOVE_CHILD, child, dir);
+
+  std::size_t size__ = dir->m_childs.size();
+  dir->remove_child(child, m_names);
+
+  --m_fanout[fanout_bucket(size__)];
+  ++m_fanout[fanout_bucket(size__ - 1)];
+
+  for(std::uint32_t height__ = Directory::levels_below(child) + 1; dir && dir->m_height == height__; ++height__)
+    {
+      // Another child as high as the removed one keeps the directory's height.
+      if(--dir->m_tallest_childs != 0)
+        break;
+
+      dir->m_height = 0;
+
+      for(Node* child__ : dir->m_childs)
+        dir->fit_height(child__);
+
+      dir = dir->m_parent;
+    }
+}
+
+bool
+File_system_emulator::m_keep_removed(Linked_node* node) noexcept
+{
+  if(node->dlinks().empty())
+    return false;
+
+  node->m_removed = true;
+  m_removed_targets.push_back(node);
+  m_removed_dirs += node->m_type == NODE_TYPE::DIRECTORY;
+  m_dangling_links += node->dlinks().size();
+
+  return true;
+}
+
+void
+File_system_emulator::m_release_dlink(Link* dlink)
+{
+  m_detach_link(dlink);
+  m_remove_child(dlink->m_parent, dlink);
+  m_free_node(dlink);
+}
+
+void
+File_system_emulator::m_release_dangling(Directory* dir)
+{
+  std::vector<Directory*> dirs__{ dir };
+  std::vector<Link*> dangling__;
+
+  // Only directories with links below them are visited, copy-on-write copies never have any.
+  while(!dirs__.empty())
+    {
+      Directory* dir__ = dirs__.back();
+      dirs__.pop_back();
+
+      if(dir__->m_subtree_links == 0)
+        continue;
+
+      dangling__.clear();
+
+      for(Node* child__ : dir__->m_childs)
+        {
+          if(is_dangling(child__))
+            dangling__.push_back(static_cast<Link*>(child__));
+          else if(child__->m_type == NODE_TYPE::DIRECTORY)
+            dirs__.push_back(static_cast<Directory*>(child__));
+        }
+
+      for(Link* dlink__ : dangling__)
+        m_release_dlink(dlink__);
+    }
+}
+
+void
+File_system_emulator::m_sweep_dlinks(std::size_t budget)
+{
+  // Rollback may attach reclaimed links again, so their targets have to stay.
+  if(m_in_transaction)
+    return;
+
+  while(!m_removed_targets.empty())
+    {
+      Linked_node* target__ = m_removed_targets.back();
+
+      for(; budget != 0 && !target__->dlinks().empty(); --budget)
+        m_release_dlink(target__->dlinks().back());
+
+      if(!target__->dlinks().empty())
+        return;
+
+      m_removed_targets.pop_back();
+
+      m_removed_dirs -= target__->m_type == NODE_TYPE::DIRECTORY;
+      m_destroy_node(target__);
+    }
+}
+
+std::vector<Link*>
+File_system_emulator::m_take_dlinks(Linked_node* node)
+{
+  // Room for the records is made before the links are taken, so a failed allocation leaves them attached.
+  if(m_recording && node->m_links)
+    {
+      std::size_t size__ = m_undo_log.size() + node->m_links->m_dlinks.size();
+
+      if(size__ > m_undo_log.capacity())
+        m_undo_log.reserve(std::max(size__, 2 * m_undo_log.capacity()));
+    }
+
+  bool is_linked__ = node->m_links != nullptr;
+  std::vector<Link*> dlinks__ = node->take_dlinks();
+
+  if(is_linked__ && !node->m_links)
+    --m_linked_nodes;
+
+  for(Link* dlink__ : dlinks__)
+    m_record(UNDO_TYPE::DETACH_LINK, dlink__, node);
+
+  return dlinks__;
+}
+
+void
+File_system_emulator::m_attach_link(Link* link, Linked_node* target)
+{
+  FSE_PROFILE_COUNT(m_profiler, LINK_UPDATES, 1);
+
+  m_record(UNDO_TYPE::ATTACH_LINK, link, target);
+  link->m_target = target;
+
+  if(!target->m_links)
+    ++m_linked_nodes;
+
+  target->add_link(link);
+
+  // Only rollback attaches links to removed targets, putting back links reclaimed inside the transaction.
+  if(target->m_removed)
+    ++m_dangling_links;
+
+  if(link->m_type == NODE_TYPE::HLINK)
+    {
+      Directory* dir__ = target->m_type == NODE_TYPE::DIRECTORY ? static_cast<Directory*>(target) : target->m_parent;
+
+      for(; dir__; dir__ = dir__->m_parent)
+        ++dir__->m_subtree_hlinks;
+    }
+}
+
+void
+File_system_emulator::m_detach_link(Link* link)
+{
+  FSE_PROFILE_COUNT(m_profiler, LINK_UPDATES, 1);
+
+  Linked_node* target__ = link->m_target;
+  m_record(UNDO_TYPE::DETACH_LINK, link, target__);
+  target__->remove_link(link);
+
+  if(!target__->m_links)
+    --m_linked_nodes;
+
+  if(target__->m_removed)
+    --m_dangling_links;
+
+  if(link->m_type == NODE_TYPE::HLINK)
+    {
+      Directory* dir__ = target__->m_type == NODE_TYPE::DIRECTORY ? static_cast<Directory*>(target__) : target__->m_parent;
+
+      for(; dir__; dir__ = dir__->m_parent)
+        --dir__->m_subtree_hlinks;
+    }
+}
+
+Node*
+File_system_emulator::m_copy(Node* source)
+{
+  Node* copy__ = nullptr;
+
+  m_traversal.clear();
+  m_traversal.push_back({ source, nullptr, 0 });
+
+  while(!m_traversal.empty())
+    {
+      Traversal_entry entry__ = m_traversal.back();
+      m_traversal.pop_back();
+
+      Node* node_copy__ = m_copy_node(entry__.m_node);
+
+      if(entry__.m_parent)
+        m_add_child(entry__.m_parent, node_copy__);
+      else
+        copy__ = node_copy__;
+
+      if(entry__.m_node->m_type != NODE_TYPE::DIRECTORY)
+        continue;
+
+      Directory* source_dir__ = static_cast<Directory*>(entry__.m_node);
+      Directory* owner__ = source_dir__->m_shared ? source_dir__->m_shared : source_dir__;
+      Directory* dir_copy__ = static_cast<Directory*>(node_copy__);
+
+      // Links have to know all places they're in, so subtrees with links are copied level by level. Children are
+      // pushed in reverse, so every copy is appended to the children of its directory.
+      if(m_copy_on_write && owner__->m_subtree_links == 0 && !owner__->m_childs.empty())
+        m_share(dir_copy__, owner__);
+      else
+        for(auto it__ = owner__->m_childs.rbegin(); it__ != owner__->m_childs.rend(); ++it__)
+          if(!is_dangling(*it__))
+            m_traversal.push_back({ *it__, dir_copy__, 0 });
+    }
+
+  return copy__;
+}
+
+Node*
+File_system_emulator::m_copy_node(const Node* source)
+{
+  FSE_PROFILE_COUNT(m_profiler, COPIED_NODES, 1);
+
+  switch(source->m_type)
+    {
+    case NODE_TYPE::FILE:
+      {
+        File* file_ptr__ = static_cast<File*>(m_new_node(NODE_TYPE::FILE));
+        file_ptr__->m_name = source->m_name;
+        m_index.insert(file_ptr__);
+
+        return file_ptr__;
+      }
+    case NODE_TYPE::HLINK:
+    case NODE_TYPE::DLINK:
+      {
+        Link* link_ptr__ = static_cast<Link*>(m_new_node(source->m_type));
+
+        m_attach_link(link_ptr__, static_cast<const Link*>(source)->m_target);
+        return link_ptr__;
+      }
+    default:
+      {
+        Directory* dir_ptr__ = static_cast<Directory*>(m_new_node(NODE_TYPE::DIRECTORY));
+        dir_ptr__->m_name = source->m_name;
+        m_index.insert(dir_ptr__);
+        // Heights of a copy are those of its source, so children added later never raise them.
+        dir_ptr__->m_height = static_cast<const Directory*>(source)->m_height;
+
+        return dir_ptr__;
+      }
+    }
+}
+
+Directory*
+File_system_emulator::m_parallel_copy(const Directory* source)
+{
+  if(!m_copy_pool || m_copy_pool->size() != m_copy_threads)
+    {
+      m_copy_pool.reset();
+      m_copy_pool = std::make_unique<Task_pool<Copy_task>>(m_copy_threads);
+      m_copy_workers.resize(m_copy_threads);
+
+      for(auto& worker__ : m_copy_workers)
+        if(!worker__)
+          worker__ = std::make_unique<Copy_worker>();
+    }
+
+  Directory* copy__ = m_copy_workers.front()->m_directories.create();
+  copy__->m_name = source->m_name;
+  copy__->m_height = source->m_height;
+
+  // Nodes of the copy aren't reachable from the tree until the end, so workers only ever read shared nodes.
+  auto copy_childs__ = [this](Copy_task& task, std::size_t worker) {
+    Copy_worker& storage__ = *m_copy_workers[worker];
+
+    for(Node* child__ : task.m_source->childs())
+      {
+        switch(child__->m_type)
+          {
+          case NODE_TYPE::FILE:
+            {
+              File* file_ptr__ = storage__.m_files.create();
+              file_ptr__->m_name = child__->m_name;
+              storage__.m_named_copies.push_back(file_ptr__);
+
+              task.m_copy->add_child(file_ptr__, m_names);
+              task.m_copy->fit_height(file_ptr__);
+              break;
+            }
+          case NODE_TYPE::HLINK:
+          case NODE_TYPE::DLINK:
+            {
+              if(is_dangling(child__))
+                break;
+
+              Link* link_ptr__ = storage__.m_links.create(child__->m_type);
+
+              // Links update counters of all directories above them, so they're placed once all threads are done.
+              link_ptr__->m_target = static_cast<Link*>(child__)->m_target;
+              link_ptr__->m_parent = task.m_copy;
+              storage__.m_links_to_attach.push_back(link_ptr__);
+              break;
+            }
+          case NODE_TYPE::DIRECTORY:
+            {
+              Directory* dir_ptr__ = storage__.m_directories.create();
+              dir_ptr__->m_name = child__->m_name;
+              dir_ptr__->m_height = static_cast<Directory*>(child__)->m_height;
+              storage__.m_named_copies.push_back(dir_ptr__);
+
+              // The subtree is filled by a task of its own.
+              task.m_copy->add_child(dir_ptr__, m_names);
+              task.m_copy->fit_height(dir_ptr__);
+
+              if(!static_cast<Directory*>(child__)->childs().empty())
+                m_copy_pool->spawn(worker, { static_cast<Directory*>(child__), dir_ptr__ });
+              else
+                ++storage__.m_fanout[0];
+              break;
+            }
+          default: break;
+          }
+      }
+
+    // Links are added to the copy later, they move it to another bucket then.
+    ++storage__.m_fanout[fanout_bucket(task.m_copy->m_childs.size())];
+  };
+
+  try
+    {
+      m_copy_pool->run({ source, copy__ }, copy_childs__);
+    }
+  catch(...)
+    {
+      // Nothing refers to the partial copy yet, so it's released together with the storage of the workers.
+      for(auto& worker__ : m_copy_workers)
+        {
+          worker__->m_directories.clear();
+          worker__->m_files.clear();
+          worker__->m_links.clear();
+          worker__->m_links_to_attach.clear();
+          worker__->m_fanout = {};
+          worker__->m_named_copies.clear();
+        }
+      throw;
+    }
+
+  m_index.insert(copy__);
+  m_record(UNDO_TYPE::NEW_NODE, copy__);
+
+  for(auto& worker__ : m_copy_workers)
+    {
+      FSE_PROFILE_COUNT(m_profiler, COPIED_NODES,
+                        worker__->m_directories.size() + worker__->m_files.size() + worker__->m_links.size());
+
+      for(std::size_t i = 0; i < FANOUT_BUCKETS; ++i)
+        m_fanout[i] += worker__->m_fanout[i];
+
+      // Copies are indexed by the calling thread, the index isn't shared with the workers.
+      for(Node* node__ : worker__->m_named_copies)
+        {
+          m_index.insert(node__);
+          m_record(UNDO_TYPE::NEW_NODE, node__);
+        }
+
+      worker__->m_fanout = {};
+      worker__->m_named_copies.clear();
+    }
+
+  for(auto& worker__ : m_copy_workers)
+    {
+      for(Link* link__ : worker__->m_links_to_attach)
+        {
+          m_record(UNDO_TYPE::NEW_NODE, link__);
+          m_attach_link(link__, link__->m_target);
+          m_add_child(link__->m_parent, link__);
+        }
+
+      worker__->m_links_to_attach.clear();
+
+      m_directories.merge(worker__->m_directories);
+      m_files.merge(worker__->m_files);
+      m_links.merge(worker__->m_links);
+    }
+
+  return copy__;
+}
+
+void
+File_system_emulator::m_share(Directory* dir, Directory* source)
+{
+  m_view_listings.touch(dir);
+  m_record(UNDO_TYPE::SHARE, dir, source);
+  source->add_sharer(dir);
+  dir->m_shared = source;
+  ++m_sharing_dirs;
+}
+
+void
+File_system_emulator::m_materialize(Directory* dir)
+{
+  Directory* source__ = dir->m_shared;
+
+  m_view_listings.touch(dir);
+
+  // Rollback releases all children of the copy at once, so the copies aren't recorded one by one.
+  m_record(UNDO_TYPE::MATERIALIZE, dir, source__, dir->m_height);
+  bool recording__ = std::exchange(m_recording, false);
+
+  source__->remove_sharer(dir);
+  dir->m_shared = nullptr;
+  --m_sharing_dirs;
+
+  try
+    {
+      // Only one level is duplicated, subdirectories go on sharing what they're copied from.
+      for(Node* child__ : source__->m_childs)
+        {
+          if(child__->m_type != NODE_TYPE::DIRECTORY)
+            {
+              m_add_child(dir, m_copy_node(child__));
+              continue;
+            }
+
+          Directory* child_dir__ = static_cast<Directory*>(child__);
+          Directory* owner__ = child_dir__->m_shared ? child_dir__->m_shared : child_dir__;
+          Directory* dir_ptr__ = static_cast<Directory*>(m_copy_node(child__));
+
+          if(!owner__->m_childs.empty())
+            m_share(dir_ptr__, owner__);
+
+          m_add_child(dir, dir_ptr__);
+        }
+    }
+  catch(...)
+    {
+      m_recording = recording__;
+      throw;
+    }
+
+  m_recording = recording__;
+}
+
+void
+File_system_emulator::m_unshare(Directory* dir)
+{
+  if(m_sharing_dirs == 0)
+    return;
+
+  if(dir->m_shared)
+    m_materialize(dir);
+
+  std::vector<Directory*> ancestors__;
+
+  for(Directory* dir__ = dir; dir__; dir__ = dir__->m_parent)
+    ancestors__.push_back(dir__);
+
+  // Going from the drive down, a copy of an upper directory gets private directories down to the changed one, and
+  // those stop sharing the directories below.
+  for(std::size_t i = ancestors__.size(); i-- > 0;)
+    {
+      while(!ancestors__[i]->m_sharers.empty())
+        {
+          Directory* copy__ = ancestors__[i]->m_sharers.back();
+          m_materialize(copy__);
+
+          for(std::size_t j = i; j-- > 0;)
+            {
+              copy__ = static_cast<Directory*>(copy__->find_child(Child_key::named(ancestors__[j]->m_name)));
+
+              if(copy__->m_shared)
+                m_materialize(copy__);
+            }
+        }
+    }
+}
+
+void
+File_system_emulator::m_unshare_subtree(Directory* dir)
+{
+  if(m_sharing_dirs == 0)
+    return;
+
+  std::vector<Directory*> subtree__;
+
+  // A materialized copy shares directories one level below, which may be in the subtree and visited already. A copy
+  // inside the subtree gets new directories that may be shared in turn, so the subtree is collected on every pass.
+  for(bool materialized__ = true; materialized__;)
+    {
+      materialized__ = false;
+      subtree__.assign(1, dir);
+
+      for(std::size_t i = 0; i < subtree__.size(); ++i)
+        for(Node* child__ : subtree__[i]->m_childs)
+          if(child__->m_type == NODE_TYPE::DIRECTORY)
+            subtree__.push_back(static_cast<Directory*>(child__));
+
+      for(Directory* dir__ : subtree__)
+        {
+          while(!dir__->m_sharers.empty())
+            {
+              m_materialize(dir__->m_sharers.back());
+              materialized__ = true;
+            }
+        }
+    }
+}
+
+std::size_t
+File_system_emulator::m_count_nodes(Node* node, std::size_t limit) const
+{
+  std::size_t count__ = 0;
+
+  m_traversal.clear();
+  m_traversal.push_back({ node, nullptr, 0 });
+
+  while(!m_traversal.empty() && count__ < limit)
+    {
+      Node* curr__ = m_traversal.back().m_node;
+      m_traversal.pop_back();
+      ++count__;
+
+      if(curr__->m_type == NODE_TYPE::DIRECTORY)
+        for(Node* child__ : static_cast<Directory*>(curr__)->childs())
+          m_traversal.push_back({ child__, nullptr, 0 });
+    }
+
+  return count__;
+}
+
+void
+File_system_emulator::compact()
+{
+  m_sweep_dlinks(SIZE_MAX);
+}
+
+void
+File_system_emulator::set_compact_storage(bool enabled)
+{
+  if(enabled == is_compact_storage())
+    return;
+
+  // The drive is the only entity of an empty tree, so it's the current directory too.
+  bool is_empty__ = m_table ? m_table->size() == 1 : static_cast<Directory*>(m_root->m_childs.front())->m_childs.empty();
+
+  if(!is_empty__ || m_in_transaction)
+    throw std::runtime_error("ERROR: Storage can`t be changed once the drive isn`t empty.");
+
+  m_table = enabled ? std::make_unique<Node_table>(m_names) : nullptr;
+  m_view_listings.clear();
+}
+
+void
+File_system_emulator::set_parallel_copy(std::size_t threshold, std::size_t threads)
+{
+  m_parallel_copy_threshold = threshold;
+  m_copy_threads = threads ? threads : std::thread::hardware_concurrency();
+}
+
+File_system_emulator::Stats
+File_system_emulator::stats() const noexcept
+{
+  const Directory* drive__ = static_cast<const Directory*>(m_root->m_childs.front());
+  Name_table::Stats names__ = m_names.stats();
+  Stats stats__;
+
+  if(m_table)
+    {
+      for(NODE_TYPE type__ : { NODE_TYPE::DIRECTORY, NODE_TYPE::FILE, NODE_TYPE::HLINK, NODE_TYPE::DLINK })
+        stats__.m_nodes[static_cast<std::size_t>(type__)] = m_table->count(type__);
+
+      // Links are threaded through the arrays of entities, they take no lists of their own.
+      stats__.m_node_bytes = m_table->node_bytes();
+      stats__.m_name_bytes = names__.m_bytes + names__.m_names * sizeof(std::string_view);
+      stats__.m_index_bytes = m_table->index_bytes();
+      stats__.m_link_list_bytes = 0;
+      stats__.m_slack_bytes = m_table->slack_bytes() + names__.m_capacity - names__.m_bytes;
+      stats__.m_max_depth = 0;
+      stats__.m_fanout = {};
+      stats__.m_dangling_links = 0;
+
+      m_table->visit_directories([&stats__](std::size_t depth, std::size_t childs) {
+        ++stats__.m_fanout[fanout_bucket(childs)];
+
+        if(childs != 0)
+          stats__.m_max_depth = std::max(stats__.m_max_depth, depth + 1);
+      });
+
+      return stats__;
+    }
+
+  // Root above the drive isn't a part of the tree. Links are told apart by the counter of hard links of the drive.
+  // Nodes released by an open transaction are still allocated, but they aren't a part of the tree anymore.
+  auto retired__ = [this](NODE_TYPE type) { return m_retired_nodes[static_cast<std::size_t>(type)]; };
+
+  stats__.m_nodes[static_cast<std::size_t>(NODE_TYPE::DIRECTORY)]
+      = m_directories.size() - 1 - m_removed_dirs - retired__(NODE_TYPE::DIRECTORY);
+  stats__.m_nodes[static_cast<std::size_t>(NODE_TYPE::FILE)]
+      = m_files.size() - (m_removed_targets.size() - m_removed_dirs) - retired__(NODE_TYPE::FILE);
+  stats__.m_nodes[static_cast<std::size_t>(NODE_TYPE::HLINK)] = drive__->m_subtree_hlinks;
+  stats__.m_nodes[static_cast<std::size_t>(NODE_TYPE::DLINK)] = m_links.size() - drive__->m_subtree_hlinks - m_dangling_links
+                                                                - retired__(NODE_TYPE::HLINK) - retired__(NODE_TYPE::DLINK);
+
+  // Every node but the root has a place in the list of children of its parent.
+  stats__.m_node_bytes = m_directories.size() * sizeof(Directory) + m_files.size() * sizeof(File)
+                         + m_links.size() * sizeof(Link) + (size() - 1) * sizeof(Node*);
+  stats__.m_name_bytes = names__.m_bytes + names__.m_names * sizeof(std::string_view);
+  stats__.m_index_bytes = m_index.bytes();
+  stats__.m_link_list_bytes = m_linked_nodes * sizeof(Link_lists) + m_links.size() * sizeof(Link*);
+  stats__.m_slack_bytes = (m_directories.capacity() - m_directories.size()) * sizeof(Directory)
+                          + (m_files.capacity() - m_files.size()) * sizeof(File)
+                          + (m_links.capacity() - m_links.size()) * sizeof(Link) + names__.m_capacity - names__.m_bytes;
+  stats__.m_max_depth = drive__->m_height;
+  stats__.m_fanout = m_fanout;
+  stats__.m_dangling_links = m_dangling_links;
+
+  return stats__;
+}
+
+bool
+File_system_emulator::m_check_on_hlinks(const Node* node) const noexcept
+{
+  if(node->m_type == NODE_TYPE::DIRECTORY)
+    return static_cast<const Directory*>(node)->m_subtree_hlinks != 0;
+
+  if(node->m_type == NODE_TYPE::FILE)
+    return !static_cast<const File*>(node)->hlinks().empty();
+
+  return false;
+}
+
+bool
+File_system_emulator::m_check_on_outer_hlinks(const Directory* dir) const
+{
+  if(dir->m_subtree_hlinks == 0)
+    return false;
+
+  std::unordered_map<const Node*, std::size_t> inner_hlinks__;
+  std::vector<const Linked_node*> targets__;
+
+  // Shared children belong to the directory they're shared from, so nothing below a copy-on-write copy is counted.
+  m_traversal.clear();
+  m_traversal.push_back({ const_cast<Directory*>(dir), nullptr, 0 });
+
+  while(!m_traversal.empty())
+    {
+      Node* curr__ = m_traversal.back().m_node;
+      m_traversal.pop_back();
+
+      if(curr__->m_type == NODE_TYPE::HLINK)
+        ++inner_hlinks__[static_cast<Link*>(curr__)->m_target];
+      else if(is_linkable(curr__) && !static_cast<Linked_node*>(curr__)->hlinks().empty())
+        targets__.push_back(static_cast<Linked_node*>(curr__));
+
+      if(curr__->m_type == NODE_TYPE::DIRECTORY)
+        for(Node* child__ : static_cast<Directory*>(curr__)->m_childs)
+          m_traversal.push_back({ child__, nullptr, 0 });
+    }
+
+  // The counter of the directory holds every hard link attached inside the subtree, wherever the link is placed.
+  std::size_t inner__ = 0;
+
+  for(const Linked_node* target__ : targets__)
+    if(auto it__ = inner_hlinks__.find(target__); it__ != inner_hlinks__.end())
+      inner__ += it__->second;
+
+  return inner__ != dir->m_subtree_hlinks;
+}
+
+void
+File_system_emulator::m_print(Node* node, Tree_writer& writer) const
+{
+  std::vector<std::pair<std::string, Node*>> links__;
+  // Names of links on the stack in the same order, so each is built once.
+  std::vector<std::string> link_names__;
+
+  m_traversal.clear();
+  m_traversal.push_back({ node, nullptr, 0 });
+
+  while(!m_traversal.empty())
+    {
+      Traversal_entry entry__ = m_traversal.back();
+      m_traversal.pop_back();
+
+      FSE_PROFILE_COUNT(m_profiler, PRINTED_NODES, 1);
+
+      if(entry__.m_node->m_type == NODE_TYPE::HLINK || entry__.m_node->m_type == NODE_TYPE::DLINK)
+        {
+          writer.line(entry__.m_depth, link_names__.back());
+          link_names__.pop_back();
+        }
+      else
+        writer.line(entry__.m_depth, m_names.name(entry__.m_node->m_name));
+
+      if(entry__.m_node->m_type != NODE_TYPE::DIRECTORY)
+        continue;
+
+      Directory* dir_ptr__ = static_cast<Directory*>(entry__.m_node);
+      Directory* owner__ = dir_ptr__->m_shared ? dir_ptr__->m_shared : dir_ptr__;
+
+      // Files and directories are kept in order of their names, links are named after the current paths of their
+      // targets, so only they are sorted here.
+      links__.clear();
+
+      for(std::size_t i = owner__->m_named; i < owner__->m_childs.size(); ++i)
+        if(!is_dangling(owner__->m_childs[i]))
+          links__.emplace_back(m_display_name(owner__->m_childs[i]), owner__->m_childs[i]);
+
+      std::sort(links__.begin(), links__.end());
+
+      // Children go onto the stack in reverse, so they come out sorted.
+      std::size_t run__ = owner__->sorted_runs();
+      std::span<Node* const> named__ = run__ != 0 ? owner__->sorted_run(--run__) : std::span<Node* const>();
+      std::size_t named_count__ = named__.size();
+      std::size_t link__ = links__.size();
+
+      while(named_count__ != 0 || link__ != 0)
+        {
+          if(link__ != 0
+             && (named_count__ == 0 || m_names.name(named__[named_count__ - 1]->m_name) < links__[link__ - 1].first))
+            {
+              m_traversal.push_back({ links__[--link__].second, nullptr, entry__.m_depth + 1 });
+              link_names__.push_back(std::move(links__[link__].first));
+            }
+          else
+            {
+              m_traversal.push_back({ named__[--named_count__], nullptr, entry__.m_depth + 1 });
+
+              if(named_count__ == 0 && run__ != 0)
+                {
+                  named__ = owner__->sorted_run(--run__);
+                  named_count__ = named__.size();
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,346 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "journal.hpp"
+#include "mapped_file.hpp"
+
+/**
+ * @brief Computes the FNV-1a hash of a record without its checksum.
+ *
+ * @param record The fixed part of the record.
+ * @param args The characters of the parameters of the record.
+ * @param size The number of characters of the parameters.
+ */
+static std::uint32_t
+checksum(const Journal_record& record, const char* args, std::size_t size)
+{
+  std::uint32_t hash__ = 2166136261u;
+
+  auto update__ = [&hash__](const char* data, std::size_t size) {
+    for(std::size_t i = 0; i < size; ++i)
+      hash__ = (hash__ ^ static_cast<std::uint8_t>(data[i])) * 16777619u;
+  };
+
+  update__(reinterpret_cast<const char*>(&record) + sizeof(record.m_checksum),
+           sizeof(record) - sizeof(record.m_checksum));
+  update__(args, size);
+
+  return hash__;
+}
+
+/**
+ * @brief Reads the header of a journal.
+ *
+ * @param data The content of the journal file.
+ * @param size The size of the journal file.
+ * @return The header.
+ * @throws std::runtime_error If the file isn't a journal.
+ */
+static Journal_header
+read_header(const char* data, std::size_t size)
+{
+  Journal_header header__;
+
+  if(size < sizeof(header__))
+    throw std::runtime_error("ERROR: Invalid journal.");
+
+  std::memcpy(&header__, data, sizeof(header__));
+
+  if(std::memcmp(header__.m_magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 || header__.m_version != JOURNAL_VERSION)
+    throw std::runtime_error("ERROR: Invalid journal.");
+
+  return header__;
+}
+
+/**
+ * @brief Reads the next record of a journal.
+ *
+ * @param data The content of the journal file.
+ * @param size The size of the journal file.
+ * @param offset The offset of the record, advanced past it.
+ * @param command Receives the record, its parameters refer to %data.
+ * @return False if there are no more complete records.
+ */
+static bool
+read_record(const char* data, std::size_t size, std::size_t& offset, Command& command)
+{
+  Journal_record record__;
+
+  if(size - offset < sizeof(record__))
+    return false;
+
+  std::memcpy(&record__, data + offset, sizeof(record__));
+
+  std::size_t args_size__ = std::size_t(record__.m_sizes[0]) + record__.m_sizes[1];
+  const char* args__ = data + offset + sizeof(record__);
+
+  if(record__.m_type >= COMMANDS.size() || record__.m_argc > 2 || size - offset - sizeof(record__) < args_size__
+     || record__.m_checksum != checksum(record__, args__, args_size__))
+    return false;
+
+  command.m_type = static_cast<COMMAND_TYPE>(record__.m_type);
+  command.m_argc = record__.m_argc;
+  command.m_args[0] = { args__, record__.m_sizes[0] };
+  command.m_args[1] = { args__ + record__.m_sizes[0], record__.m_sizes[1] };
+
+  offset += sizeof(record__) + args_size__;
+  return true;
+}
+
+Journal::Journal() noexcept
+    : m_fd(-1), m_group_size(DEFAULT_GROUP_SIZE), m_pending(0), m_buffer(), m_end(0), m_is_failed(false)
+{
+}
+
+Journal::~Journal()
+{
+  try
+    {
+      close();
+    }
+  catch(const std::runtime_error&)
+    {
+      // Nothing can be reported from a destructor, pending records are lost as on a crash.
+    }
+}
+
+void
+Journal::open(const std::string& path, std::uint64_t sequence, std::size_t group_size)
+{
+  close();
+
+  // Find the end of the last complete record of an existing journal first.
+  std::size_t end__ = 0;
+
+  {
+    Mapped_file file__{ path.c_str() };
+
+    if(file__.is_open() && file__.size() != 0)
+      {
+        Journal_header header__ = read_header(file__.data(), file__.size());
+        Command command__;
+
+        end__ = sizeof(header__);
+
+        while(read_record(file__.data(), file__.size(), end__, command__))
+          ++header__.m_sequence;
+
+        if(header__.m_sequence != sequence)
+          throw std::runtime_error("ERROR: Journal doesn't match the state of the file system.");
+      }
+  }
+
+  m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+
+  if(m_fd == -1)
+    throw std::runtime_error("ERROR: Can`t open the journal.");
+
+  m_group_size = group_size ? group_size : 1;
+  m_pending = 0;
+  m_buffer.clear();
+  m_is_failed = false;
+
+  if(end__ == 0)
+    m_write_header(sequence);
+  else if(::ftruncate(m_fd, static_cast<off_t>(end__)) != 0 || ::lseek(m_fd, 0, SEEK_END) == -1)
+    throw std::runtime_error("ERROR: Can`t open the journal.");
+  else
+    m_end = static_cast<off_t>(end__);
+}
+
+void
+Journal::close()
+{
+  if(!is_open())
+    return;
+
+  int fd__ = m_fd;
+
+  try
+    {
+      commit();
+    }
+  catch(const std::runtime_error&)
+    {
+      ::close(fd__);
+      m_fd = -1;
+      throw;
+    }
+
+  ::close(fd__);
+  m_fd = -1;
+}
+
+void
+Journal::append(const Command& command)
+{
+  m_check_on_failure();
+
+  std::size_t argc__ = COMMANDS[static_cast<std::size_t>(command.m_type)].m_arity;
+
+  Journal_record record__{};
+  record__.m_type = static_cast<std::uint16_t>(command.m_type);
+  record__.m_argc = static_cast<std::uint16_t>(argc__);
+
+  for(std::size_t i = 0; i < argc__; ++i)
+    record__.m_sizes[i] = static_cast<std::uint32_t>(command.m_args[i].size());
+
+  std::size_t offset__ = m_buffer.size();
+  m_buffer.resize(offset__ + sizeof(record__) + record__.m_sizes[0] + record__.m_sizes[1]);
+
+  char* args__ = m_buffer.data() + offset__ + sizeof(record__);
+
+  for(std::size_t i = 0; i < argc__; ++i)
+    command.m_args[i].copy(args__ + (i ? record__.m_sizes[0] : 0), record__.m_sizes[i]);
+
+  record__.m_checksum = checksum(record__, args__, record__.m_sizes[0] + record__.m_sizes[1]);
+  std::memcpy(m_buffer.data() + offset__, &record__, sizeof(record__));
+
+  if(++m_pending >= m_group_size)
+    commit();
+}
+
+void
+Journal::commit()
+{
+  if(!is_open() || m_buffer.empty())
+    return;
+
+  m_check_on_failure();
+
+  try
+    {
+      m_write(m_buffer.data(), m_buffer.size());
+
+      if(::fdatasync(m_fd) != 0)
+        throw std::runtime_error("ERROR: Can`t write the journal.");
+    }
+  catch(const std::runtime_error&)
+    {
+      // Appending the group again after a part of it would leave a torn record in front of valid ones, or the
+      // same records twice.
+      if(::ftruncate(m_fd, m_end) != 0 || ::lseek(m_fd, m_end, SEEK_SET) == -1)
+        m_is_failed = true;
+
+      throw;
+    }
+
+  m_end += static_cast<off_t>(m_buffer.size());
+  m_buffer.clear();
+  m_pending = 0;
+}
+
+void
+Journal::reset(std::uint64_t sequence)
+{
+  if(!is_open())
+    return;
+
+  m_buffer.clear();
+  m_pending = 0;
+  m_is_failed = false;
+
+  if(::ftruncate(m_fd, 0) != 0 || ::lseek(m_fd, 0, SEEK_SET) == -1)
+    {
+      m_is_failed = true;
+      throw std::runtime_error("ERROR: Can`t write the journal.");
+    }
+
+  m_write_header(sequence);
+}
+
+std::uint64_t
+Journal::replay(const std::string& path, std::uint64_t sequence,
+                const std::function<void(std::span<const Command>)>& apply)
+{
+  Mapped_file file__{ path.c_str() };
+
+  if(!file__.is_open())
+    throw std::runtime_error("ERROR: Can`t read the journal.");
+
+  if(file__.size() == 0)
+    return sequence;
+
+  Journal_header header__ = read_header(file__.data(), file__.size());
+  std::size_t offset__ = sizeof(header__);
+
+  if(header__.m_sequence > sequence)
+    throw std::runtime_error("ERROR: Journal doesn't match the state of the file system.");
+
+  std::vector<Command> batch__;
+  Command command__;
+
+  for(; read_record(file__.data(), file__.size(), offset__, command__); ++header__.m_sequence)
+    {
+      if(header__.m_sequence < sequence)
+        continue;
+
+      batch__.push_back(command__);
+
+      if(batch__.size() == COMMAND_BATCH_SIZE)
+        {
+          apply(batch__);
+          batch__.clear();
+        }
+    }
+
+  apply(batch__);
+
+  return std::max(header__.m_sequence, sequence);
+}
+
+void
+Journal::m_write_header(std::uint64_t sequence)
+{
+  Journal_header header__{};
+  std::memcpy(header__.m_magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+  header__.m_version = JOURNAL_VERSION;
+  header__.m_sequence = sequence;
+
+  // A journal without a complete header can't be appended to.
+  try
+    {
+      m_write(reinterpret_cast<const char*>(&header__), sizeof(header__));
+
+      if(::fdatasync(m_fd) != 0)
+        throw std::runtime_error("ERROR: Can`t write the journal.");
+    }
+  catch(const std::runtime_error&)
+    {
+      m_is_failed = true;
+      throw;
+    }
+
+  m_end = sizeof(header__);
+}
+
+void
+Journal::m_write(const char* data, std::size_t size)
+{
+  while(size != 0)
+    {
+      ssize_t written__ = ::write(m_fd, data, size);
+
+      if(written__ < 0 && errno == EINTR)
+        continue;
+
+      if(written__ < 0)
+        throw std::runtime_error("ERROR: Can`t write the journal.");
+
+      data += written__;
+      size -= static_cast<std::size_t>(written__);
+    }
+}
+
+void
+Journal::m_check_on_failure() const
+{
+  if(m_is_failed)
+    throw std::runtime_error("ERROR: Journal failed, it has to be opened again.");
+}
@@ -1,50 +1,12 @@
-#include <algorithm>
+#include <array>
 #include <fstream>
 #include <iostream>
 #include <string>
 #include <vector>
 
+#include "command.hpp"
 #include "file_system_emulator.hpp"
-
-/**
- * Splits a command line string into its arguments based on spaces.
- *
- * @param line The command line string to be split.
- * @return A vector of string_views, each representing an argument from the command line.
- */
-std::vector<std::string_view>
-split_command_line(std::string_view line)
-{
-  std::vector<std::string_view> splitted__;
-  std::size_t left_pos__ = 0;
-
-  for(std::size_t curr_pos__ = 0, end__ = line.size(); curr_pos__ < end__; ++curr_pos__)
-    {
-      if(line.at(curr_pos__) == ' ')
-        {
-          splitted__.push_back(line.substr(left_pos__, curr_pos__ - left_pos__));
-          left_pos__ = curr_pos__ + 1;
-        }
-    }
-
-  splitted__.push_back(line.substr(left_pos__));
-
-  return splitted__;
-}
-
-/**
- * @brief Converts a command string to lowercase.
- *
- * @param cmd The command string to convert.
- * @return A new string containing the lowercase version of the input command.
- */
-std::string
-get_command(std::string_view cmd)
-{
-  std::string cmd_name__{ cmd };
-  std::transform(cmd_name__.begin(), cmd_name__.end(), cmd_name__.begin(), [](auto c) { return std::tolower(c); });
-  return cmd_name__;
-}
+#include "script_reader.hpp"
 
 /**
  * @brief Validates a file or directory name based on specific rules.
@@ -86,115 +48,226 @@ is_valid_name(std::string_view path)
   return true;
 }
 
+/**
+ * @brief Validates parameters of a command before it's applied to the emulator.
+ *
+ * @param command The command to validate.
+ * @throws std::runtime_error If the command lacks parameters or a created entity has an invalid name.
+ */
+void
+validate(const Command& command)
+{
+  const Command_info& info__ = COMMANDS[static_cast<std::size_t>(command.m_type)];
+
+  if(command.m_argc < info__.m_arity)
+    throw std::runtime_error("ERROR: Not enough parameters for " + std::string(info__.m_name) + " command.");
+
+  if(command.m_type == COMMAND_TYPE::MAKE_DIR && !is_valid_name(command.m_args[0]))
+    throw std::runtime_error("ERROR: Invalid format of a directory name.");
+
+  if(command.m_type == COMMAND_TYPE::MAKE_FILE && !is_valid_name(command.m_args[0]))
+    throw std::runtime_error("ERROR: Invalid format of a file name.");
+}
+
+/**
+ * @brief Prints the counters of the tree for a STATS command.
+ *
+ * @param stats The counters to print.
+ */
+void
+print_stats(const File_system_emulator::Stats& stats)
+{
+  static constexpr std::array<std::string_view, 4> TYPE_NAMES{ "Directories", "Files", "Hard links", "Dynamic links" };
+
+  std::cout << '\n';
+
+  for(std::size_t i = 0; i < TYPE_NAMES.size(); ++i)
+    std::cout << TYPE_NAMES[i] << ": " << stats.m_nodes[i] << '\n';
+
+  std::cout << "Node bytes: " << stats.m_node_bytes << '\n'
+            << "Name bytes: " << stats.m_name_bytes << '\n'
+            << "Index bytes: " << stats.m_index_bytes << '\n'
+            << "Link list bytes: " << stats.m_link_list_bytes << '\n'
+            << "Slack bytes: " << stats.m_slack_bytes << '\n'
+            << "Max depth: " << stats.m_max_depth << '\n';
+
+  // Bucket k holds directories with 2^(k-1) to 2^k - 1 children, empty buckets are skipped.
+  for(std::size_t i = 0; i < stats.m_fanout.size(); ++i)
+    {
+      if(stats.m_fanout[i] == 0)
+        continue;
+
+      std::cout << "Fan-out " << (i == 0 ? 0 : std::size_t{ 1 } << (i - 1));
+
+      if(i > 1)
+        std::cout << '-' << (std::size_t{ 1 } << i) - 1;
+
+      std::cout << ": " << stats.m_fanout[i] << '\n';
+    }
+
+  std::cout << std::flush;
+}
+
+/**
+ * @brief Prints the paths found by a FIND command, one per line.
+ *
+ * @param paths The paths to print.
+ */
+void
+print_paths(const std::vector<std::string>& paths)
+{
+  std::cout << '\n';
+
+  for(const std::string& path__ : paths)
+    std::cout << path__ << '\n';
+
+  std::cout << std::flush;
+}
+
+#ifdef FSE_PROFILE
+/**
+ * @brief Writes the profile of a run for the --profile flag.
+ *
+ * @param profiler The profiler of the emulator.
+ * @param path The path to the JSON file.
+ * @throws std::runtime_error If the file can't be written.
+ */
+void
+write_profile(const Profiler& profiler, const char* path)
+{
+  std::ofstream file__{ path };
+  profiler.write_json(file__);
+
+  if(!file__.flush())
+    throw std::runtime_error("ERROR: Can`t write the profile.");
+}
+#endif
+
 int
 main(int argc, char const* argv[])
 {
-  if(argc == 1)
-    throw std::runtime_error("ERROR: Expected bash file as input parameter but found nothing.");
+  const char* script_path__ = nullptr;
+  const char* profile_path__ = nullptr;
+  bool is_compact__ = false;
 
-  std::ifstream file__{ argv[1] };
+  for(int i = 1; i < argc; ++i)
+    {
+      if(std::string_view{ argv[i] } == "--compact")
+        is_compact__ = true;
+      else if(std::string_view{ argv[i] } != "--profile")
+        script_path__ = argv[i];
+      else if(i + 1 < argc)
+        profile_path__ = argv[++i];
+      else
+        {
+          // The flag must not be taken for the script.
+          std::cerr << "ERROR: Expected a path of the profile after --profile but found nothing." << std::endl;
+          return 1;
+        }
+    }
 
-  if(file__.good())
+  // Usage errors are reported before anything runs, the same way for every argument.
+  if(!script_path__)
+    {
+      std::cerr << "ERROR: Expected bash file as input parameter but found nothing." << std::endl;
+      return 1;
+    }
+
+#ifndef FSE_PROFILE
+  if(profile_path__)
+    {
+      std::cerr << "ERROR: Profiling is off, the emulator has to be built with FSE_PROFILE." << std::endl;
+      return 1;
+    }
+#endif
+
+  Script_reader script__{ script_path__ };
+
+  if(script__.is_open())
     {
       File_system_emulator fse__;
+      fse__.set_compact_storage(is_compact__);
 
-      std::string cmd_line__;
+      std::string_view cmd_line__;
+      std::vector<Command> batch__;
+      batch__.reserve(COMMAND_BATCH_SIZE);
 
       try
         {
-          while(std::getline(file__, cmd_line__))
+          while(script__.next_line(cmd_line__))
             {
               if(cmd_line__.empty())
                 continue;
 
-              std::vector<std::string_view> splitted_line__ = split_command_line(cmd_line__);
-              std::string cmd_name__ = get_command(splitted_line__.at(0));
+              Command command__ = parse_command(cmd_line__);
 
-              if(cmd_name__ == "md")
+              try
                 {
-                  if(splitted_line__.size() < 2)
-                    throw std::runtime_error("ERROR: Not enough parameters for MD command.");
-
-                  if(!is_valid_name(splitted_line__.at(1)))
-                    throw std::runtime_error("ERROR: Invalid format of a directory name.");
-
-                  fse__.make_dir(splitted_line__.at(1));
+                  validate(command__);
                 }
-              else if(cmd_name__ == "cd")
+              catch(const std::runtime_error&)
                 {
-                  if(splitted_line__.size() < 2)
-                    throw std::runtime_error("ERROR: Not enough parameters for CD command.");
-
-                  fse__.change_dir(splitted_line__.at(1));
+                  // Commands before the invalid one still take effect.
+                  fse__.apply_batch(batch__);
+                  throw;
                 }
-              else if(cmd_name__ == "rd")
-                {
-                  if(splitted_line__.size() < 2)
-                    throw std::runtime_error("ERROR: Not enough parameters for RD command.");
 
-                  fse__.remove_dir(splitted_line__.at(1));
-                }
-              else if(cmd_name__ == "deltree")
+              // Counters are printed at the point of the script where they're asked for.
+              if(command__.m_type == COMMAND_TYPE::STATS)
                 {
-                  if(splitted_line__.size() < 2)
-                    throw std::runtime_error("ERROR: Not enough parameters for DELTREE command.");
-
-                  fse__.delete_tree(splitted_line__.at(1));
-                }
-              else if(cmd_name__ == "mf")
-                {
-                  if(splitted_line__.size() < 2)
-                    throw std::runtime_error("ERROR: Not enough parameters for MF command.");
-
-                  if(!is_valid_name(splitted_line__.at(1)))
-                    throw std::runtime_error("ERROR: Invalid format of a file name.");
-
-                  fse__.make_file(splitted_line__.at(1));
+                  fse__.apply_batch(batch__);
+                  batch__.clear();
+                  script__.release();
+                  print_stats(fse__.stats());
+                  continue;
                 }
-              else if(cmd_name__ == "mhl")
-                {
-                  if(splitted_line__.size() < 3)
-                    throw std::runtime_error("ERROR: Not enough parameters for MHL command.");
 
-                  fse__.make_hlink(splitted_line__.at(1), splitted_line__.at(2));
-                }
-              else if(cmd_name__ == "mdl")
+              if(command__.m_type == COMMAND_TYPE::FIND)
                 {
-                  if(splitted_line__.size() < 3)
-                    throw std::runtime_error("ERROR: Not enough parameters for MDL command.");
-
-                  fse__.make_dlink(splitted_line__.at(1), splitted_line__.at(2));
+                  fse__.apply_batch(batch__);
+                  batch__.clear();
+                  script__.release();
+                  print_paths(fse__.find(command__.m_args[0], command__.m_argc > 1 ? command__.m_args[1] : ""));
+                  continue;
                 }
-              else if(cmd_name__ == "del")
-                {
-                  if(splitted_line__.size() < 2)
-                    throw std::runtime_error("ERROR: Not enough parameters for DEL command.");
 
-                  fse__.remove_file(splitted_line__.at(1));
-                }
-              else if(cmd_name__ == "copy")
-                {
-                  if(splitted_line__.size() < 3)
-                    throw std::runtime_error("ERROR: Not enough parameters for COPY command.");
+              batch__.push_back(command__);
 
-                  fse__.copy(splitted_line__.at(1), splitted_line__.at(2));
-                }
-              else if(cmd_name__ == "move")
+              // Commands refer to their lines, which are released once the commands are applied, so a piped
+              // script is buffered a batch at a time.
+              if(batch__.size() == COMMAND_BATCH_SIZE)
                 {
-                  if(splitted_line__.size() < 3)
-                    throw std::runtime_error("ERROR: Not enough parameters for MOVE command.");
-
-                  fse__.move(splitted_line__.at(1), splitted_line__.at(2));
+                  fse__.apply_batch(batch__);
+                  batch__.clear();
+                  script__.release();
                 }
             }
 
+          fse__.apply_batch(batch__);
           fse__.print();
         }
       catch(std::runtime_error exp)
         {
+          // Changes of a transaction the script didn't finish are undone.
+          if(fse__.in_transaction())
+            fse__.rollback();
+
           fse__.print();
           std::cout << '\n' << exp.what() << '\n' << std::flush;
         }
+
+#ifdef FSE_PROFILE
+      if(profile_path__)
+        try
+          {
+            write_profile(fse__.profiler(), profile_path__);
+          }
+        catch(const std::runtime_error& exp)
+          {
+            std::cerr << exp.what() << std::endl;
+            return 1;
+          }
+#endif
     }
 
   return 0;
@@ -0,0 +1,52 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapped_file.hpp"
+
+Mapped_file::Mapped_file(const char* path) noexcept : m_data(nullptr), m_size(0), m_is_open(false)
+{
+  int fd__ = ::open(path, O_RDONLY);
+
+  if(fd__ == -1)
+    return;
+
+  m_map(fd__);
+
+  // The mapping stays valid after the descriptor is closed.
+  ::close(fd__);
+}
+
+Mapped_file::Mapped_file(int fd) noexcept : m_data(nullptr), m_size(0), m_is_open(false)
+{
+  m_map(fd);
+}
+
+void
+Mapped_file::m_map(int fd) noexcept
+{
+  struct stat info__;
+
+  if(fd == -1 || ::fstat(fd, &info__) != 0 || !S_ISREG(info__.st_mode))
+    return;
+
+  m_size = static_cast<std::size_t>(info__.st_size);
+
+  if(m_size == 0)
+    m_is_open = true;
+  else if(void* data__ = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0); data__ != MAP_FAILED)
+    {
+      // Files are read once from the beginning to the end.
+      ::madvise(data__, m_size, MADV_SEQUENTIAL);
+
+      m_data = static_cast<const char*>(data__);
+      m_is_open = true;
+    }
+}
+
+Mapped_file::~Mapped_file()
+{
+  if(m_data)
+    ::munmap(const_cast<char*>(m_data), m_size);
+}
@@ -0,0 +1,194 @@
+#include <bit>
+
+#include "name_index.hpp"
+
+/**
+ * @brief Returns the extension of a name, the part after its last dot, or an empty view if there is no dot.
+ */
+static std::string_view
+get_extension(std::string_view name)
+{
+  std::size_t dot__ = name.find_last_of('.');
+
+  if(dot__ == std::string_view::npos)
+    return {};
+  return name.substr(dot__ + 1);
+}
+
+void
+Name_index::insert(Node* node)
+{
+  // Identifiers are dense, so every name interned since the last insertion is grouped by its extension here.
+  if(node->m_name >= m_entries.size())
+    {
+      for(Name_id name__ = static_cast<Name_id>(m_entries.size()); name__ <= node->m_name; ++name__)
+        m_extensions[get_extension(m_names.name(name__))].push_back(name__);
+
+      m_entries.resize(std::size_t{ node->m_name } + 1);
+    }
+
+  Entry& entry__ = m_entries[node->m_name];
+  entry__.m_nodes.push_back(node);
+  ++m_size;
+
+  if(entry__.m_nodes.size() > LINEAR_SEARCH_LIMIT)
+    {
+      std::size_t slots__ = entry__.m_table ? std::size_t{ entry__.m_table_mask } + 1 : 0;
+
+      m_table_insert(entry__);
+      m_table_slots += std::size_t{ entry__.m_table_mask } + 1 - slots__;
+    }
+}
+
+void
+Name_index::erase(Node* node) noexcept
+{
+  Entry& entry__ = m_entries[node->m_name];
+  std::size_t position__ = 0;
+
+  if(entry__.m_table)
+    {
+      std::size_t slot__ = m_find_slot(entry__, node);
+      position__ = entry__.m_table[slot__] - 1;
+
+      // The table still refers to the list as it was, so the last node is found after the hole is closed.
+      m_table_erase(entry__, slot__);
+
+      if(entry__.m_nodes.back() != node)
+        entry__.m_table[m_find_slot(entry__, entry__.m_nodes.back())] = static_cast<std::uint32_t>(position__ + 1);
+    }
+  else
+    while(entry__.m_nodes[position__] != node)
+      ++position__;
+
+  entry__.m_nodes[position__] = entry__.m_nodes.back();
+  entry__.m_nodes.pop_back();
+  --m_size;
+
+  if(entry__.m_nodes.size() <= LINEAR_SEARCH_LIMIT && entry__.m_table)
+    {
+      m_table_slots -= std::size_t{ entry__.m_table_mask } + 1;
+      entry__.m_table.reset();
+      entry__.m_table_mask = 0;
+    }
+
+  // A name may be gone for good, e.g. a unique name of a deleted subtree, so empty lists don't keep their memory.
+  if(entry__.m_nodes.empty())
+    entry__.m_nodes = {};
+}
+
+void
+Name_index::clear() noexcept
+{
+  m_entries.clear();
+  m_extensions.clear();
+  m_size = 0;
+  m_table_slots = 0;
+}
+
+std::span<const Name_id>
+Name_index::with_extension(std::string_view extension) const noexcept
+{
+  auto it__ = m_extensions.find(extension);
+
+  if(it__ == m_extensions.end())
+    return {};
+  return it__->second;
+}
+
+bool
+Name_index::matches(std::string_view pattern, std::string_view name) noexcept
+{
+  std::size_t p__ = 0, n__ = 0;
+  // Position of the last star and of the name where it started to match, a mismatch makes the star match more.
+  std::size_t star__ = std::string_view::npos, star_name__ = 0;
+
+  while(n__ < name.size())
+    {
+      if(p__ < pattern.size() && (pattern[p__] == '?' || pattern[p__] == name[n__]))
+        {
+          ++p__;
+          ++n__;
+        }
+      else if(p__ < pattern.size() && pattern[p__] == '*')
+        {
+          star__ = p__++;
+          star_name__ = n__;
+        }
+      else if(star__ != std::string_view::npos)
+        {
+          p__ = star__ + 1;
+          n__ = ++star_name__;
+        }
+      else
+        return false;
+    }
+
+  while(p__ < pattern.size() && pattern[p__] == '*')
+    ++p__;
+
+  return p__ == pattern.size();
+}
+
+std::size_t
+Name_index::m_find_slot(const Entry& entry, const Node* node) noexcept
+{
+  std::size_t slot__ = m_home(entry, node);
+
+  while(entry.m_nodes[entry.m_table[slot__] - 1] != node)
+    slot__ = (slot__ + 1) & entry.m_table_mask;
+
+  return slot__;
+}
+
+void
+Name_index::m_table_insert(Entry& entry)
+{
+  std::size_t size__ = entry.m_nodes.size();
+
+  if(entry.m_table && size__ * 4 <= (std::size_t{ entry.m_table_mask } + 1) * 3)
+    {
+      std::size_t slot__ = m_home(entry, entry.m_nodes.back());
+
+      while(entry.m_table[slot__])
+        slot__ = (slot__ + 1) & entry.m_table_mask;
+
+      entry.m_table[slot__] = static_cast<std::uint32_t>(size__);
+      return;
+    }
+
+  std::size_t slots__ = std::bit_ceil(size__ * 2);
+
+  entry.m_table = std::make_unique<std::uint32_t[]>(slots__);
+  entry.m_table_mask = static_cast<std::uint32_t>(slots__ - 1);
+
+  for(std::size_t i = 0; i < size__; ++i)
+    {
+      std::size_t slot__ = m_home(entry, entry.m_nodes[i]);
+
+      while(entry.m_table[slot__])
+        slot__ = (slot__ + 1) & entry.m_table_mask;
+
+      entry.m_table[slot__] = static_cast<std::uint32_t>(i + 1);
+    }
+}
+
+void
+Name_index::m_table_erase(Entry& entry, std::size_t slot) noexcept
+{
+  std::size_t i = slot;
+
+  for(std::size_t j = (i + 1) & entry.m_table_mask; entry.m_table[j]; j = (j + 1) & entry.m_table_mask)
+    {
+      // An entry may fill the hole only if the hole lies between its home slot and its current one.
+      std::size_t home__ = m_home(entry, entry.m_nodes[entry.m_table[j] - 1]);
+
+      if(((j - home__) & entry.m_table_mask) >= ((j - i) & entry.m_table_mask))
+        {
+          entry.m_table[i] = entry.m_table[j];
+          i = j;
+        }
+    }
+
+  entry.m_table[i] = 0;
+}
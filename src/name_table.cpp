@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <cstring>
+
+#include "name_table.hpp"
+
+Name_table::Name_table()
+    : m_chunks(), m_chunk_used(0), m_capacity(0), m_bytes(0), m_interns(0), m_reuses(0), m_views(), m_ids()
+{
+  // Identifier 0 is reserved for the empty name, e.g. the name of the root node.
+  m_views.push_back({});
+  m_ids.emplace(std::string_view{}, 0);
+}
+
+Name_id
+Name_table::intern(std::string_view name)
+{
+  ++m_interns;
+
+  if(auto it__ = m_ids.find(name); it__ != m_ids.end())
+    {
+      ++m_reuses;
+      return it__->second;
+    }
+
+  std::string_view stored__ = m_store(name);
+  Name_id id__ = static_cast<Name_id>(m_views.size());
+
+  m_views.push_back(stored__);
+  m_ids.emplace(stored__, id__);
+
+  return id__;
+}
+
+Name_id
+Name_table::find(std::string_view name) const noexcept
+{
+  auto it__ = m_ids.find(name);
+  return it__ != m_ids.end() ? it__->second : npos;
+}
+
+Name_table::Stats
+Name_table::stats() const noexcept
+{
+  return { m_views.size(), m_bytes, m_capacity, m_interns, m_reuses };
+}
+
+std::string_view
+Name_table::m_store(std::string_view name)
+{
+  // Names that don't fit into the rest of the current chunk start a new one. Names longer than a chunk get
+  // a dedicated chunk of their own size.
+  if(m_chunks.empty() || m_chunk_used + name.size() > CHUNK_SIZE)
+    {
+      std::size_t size__ = std::max(CHUNK_SIZE, name.size());
+
+      m_chunks.emplace_back(new char[size__]);
+      m_chunk_used = 0;
+      m_capacity += size__;
+    }
+
+  char* dest__ = m_chunks.back().get() + m_chunk_used;
+  std::memcpy(dest__, name.data(), name.size());
+
+  m_chunk_used += name.size();
+  m_bytes += name.size();
+
+  return { dest__, name.size() };
+}
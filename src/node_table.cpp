@@ -0,0 +1,835 @@
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <utility>
+
+#include "name_index.hpp"
+#include "node_table.hpp"
+#include "tree_writer.hpp"
+
+static constexpr char DRIVE_NAME[3] = "C:";
+static constexpr char HLINK_PREFIX[7] = "hlink[";
+static constexpr char DLINK_PREFIX[7] = "dlink[";
+
+/**
+ * @brief Splits a path into names of its entities, the part starting at the first '[' is the last name.
+ */
+static std::vector<std::string_view>
+split_path(std::string_view path)
+{
+  std::vector<std::string_view> path_list__;
+  std::size_t left_pos__ = 0;
+
+  for(std::size_t curr_pos__ = 0; curr_pos__ < path.size(); ++curr_pos__)
+    {
+      if(path[curr_pos__] == '\\')
+        {
+          path_list__.push_back(path.substr(left_pos__, curr_pos__ - left_pos__));
+          left_pos__ = curr_pos__ + 1;
+        }
+      else if(path[curr_pos__] == '[')
+        break;
+    }
+
+  path_list__.push_back(path.substr(left_pos__));
+  return path_list__;
+}
+
+/**
+ * @brief Splits the name of a link into the link's type and the path to its target.
+ *
+ * @return True if the name has the format of a link's name, otherwise False.
+ */
+static bool
+parse_link_name(std::string_view name, NODE_TYPE& type, std::string_view& target_path)
+{
+  if(name.starts_with(HLINK_PREFIX))
+    type = NODE_TYPE::HLINK;
+  else if(name.starts_with(DLINK_PREFIX))
+    type = NODE_TYPE::DLINK;
+  else
+    return false;
+
+  std::size_t left__ = name.find_first_of('[');
+  std::size_t right__ = name.find_last_of(']');
+
+  if(right__ == std::string_view::npos || right__ < left__)
+    return false;
+
+  target_path = name.substr(left__ + 1, right__ - left__ - 1);
+  return true;
+}
+
+/**
+ * @brief Returns the path to the parent directory of a path, empty if the path has no separator.
+ */
+static std::string_view
+get_parent_path(std::string_view path)
+{
+  std::size_t idx__ = path.find_last_of('\\');
+  return idx__ != std::string_view::npos ? path.substr(0, idx__) : std::string_view{};
+}
+
+/**
+ * @brief Returns the name of the entity a path leads to.
+ */
+static std::string_view
+get_path_basename(std::string_view path)
+{
+  return path.substr(path.find_last_of('\\') + 1);
+}
+
+Node_table::Node_table(Name_table& names) : m_name_table(names), m_current(DRIVE), m_free(npos), m_free_slots(0)
+{
+  m_counts = {};
+  m_allocate(NODE_TYPE::DIRECTORY, m_name_table.intern(DRIVE_NAME));
+}
+
+void
+Node_table::make_dir(std::string_view path)
+{
+  m_make_node(path, NODE_TYPE::DIRECTORY);
+}
+
+void
+Node_table::make_file(std::string_view path)
+{
+  m_make_node(path, NODE_TYPE::FILE);
+}
+
+void
+Node_table::make_hlink(std::string_view source, std::string_view dest)
+{
+  m_make_link(source, dest, NODE_TYPE::HLINK);
+}
+
+void
+Node_table::make_dlink(std::string_view source, std::string_view dest)
+{
+  m_make_link(source, dest, NODE_TYPE::DLINK);
+}
+
+void
+Node_table::change_dir(std::string_view path)
+{
+  std::uint32_t node__ = m_find(path);
+
+  if(node__ == npos || m_types[node__] != NODE_TYPE::DIRECTORY)
+    throw std::runtime_error("ERROR: Path not found.");
+
+  m_current = node__;
+}
+
+void
+Node_table::remove_dir(std::string_view path)
+{
+  std::uint32_t node__ = m_find(path);
+
+  if(node__ == npos || m_types[node__] != NODE_TYPE::DIRECTORY)
+    throw std::runtime_error("ERROR: Path is not found.");
+
+  if(node__ == DRIVE)
+    throw std::runtime_error("ERROR: Can`t delete root directory.");
+
+  if(node__ == m_current)
+    throw std::runtime_error("ERROR: Can`t delete current directory.");
+
+  if(m_first_childs[node__] != npos)
+    throw std::runtime_error("ERROR: Can`t delete non-empty directory");
+
+  m_remove_node(node__);
+}
+
+void
+Node_table::remove_file(std::string_view path)
+{
+  std::uint32_t node__ = m_find(path);
+
+  if(node__ == npos || m_types[node__] == NODE_TYPE::DIRECTORY)
+    throw std::runtime_error("ERROR: Path is not found.");
+
+  m_remove_node(node__);
+}
+
+void
+Node_table::copy(std::string_view source, std::string_view dest)
+{
+  std::uint32_t source__ = m_find(source);
+
+  if(source__ == npos)
+    throw std::runtime_error("ERROR: Path is not found.");
+
+  std::uint32_t dest__ = m_find(dest);
+
+  if(dest__ == npos || m_types[dest__] != NODE_TYPE::DIRECTORY)
+    throw std::runtime_error("ERROR: Path is not found.");
+
+  if(m_find_same(dest__, source__) != npos)
+    return;
+
+  // The copy is attached only after it's built, so copying a directory into its own subtree terminates.
+  m_add_child(dest__, m_copy(source__));
+}
+
+void
+Node_table::move(std::string_view source, std::string_view dest)
+{
+  std::uint32_t source__ = m_find(source);
+
+  if(source__ == npos)
+    throw std::runtime_error("ERROR: Path is not found.");
+
+  std::uint32_t dest__ = m_find(dest);
+
+  if(dest__ == npos || m_types[dest__] != NODE_TYPE::DIRECTORY)
+    throw std::runtime_error("ERROR: Path is not found.");
+
+  if(dest__ == source__ || source__ == DRIVE || m_parents[source__] == dest__)
+    return;
+
+  for(std::uint32_t dir__ = m_parents[dest__]; dir__ != npos; dir__ = m_parents[dir__])
+    if(dir__ == source__)
+      throw std::runtime_error("ERROR: Can`t move directory into its own subtree.");
+
+  if(m_find_same(dest__, source__) != npos)
+    return;
+
+  if(m_has_hlinks(source__))
+    throw std::runtime_error("ERROR: Can't move source with attached hard link.");
+
+  // Nothing below the source is hard-linked, so no counters of hard links change on the way.
+  m_remove_child(source__);
+  m_add_child(dest__, source__);
+}
+
+void
+Node_table::delete_tree(std::string_view path)
+{
+  std::uint32_t root__ = m_find(path);
+
+  if(root__ == npos || m_types[root__] != NODE_TYPE::DIRECTORY)
+    throw std::runtime_error("ERROR: Path is not found.");
+
+  if(root__ == DRIVE)
+    throw std::runtime_error("ERROR: Can`t delete root directory.");
+
+  if(root__ == m_current)
+    throw std::runtime_error("ERROR: Can`t delete current directory.");
+
+  std::vector<std::uint32_t> subtree__{ root__ };
+
+  for(std::size_t i = 0; i < subtree__.size(); ++i)
+    if(m_types[subtree__[i]] == NODE_TYPE::DIRECTORY)
+      for(std::uint32_t child__ = m_first_childs[subtree__[i]]; child__ != npos; child__ = m_next_siblings[child__])
+        subtree__.push_back(child__);
+
+  // Hard links placed inside the subtree go away together with it.
+  if(m_has_outer_hlinks(subtree__))
+    throw std::runtime_error("ERROR: Can`t delete entity with attached hard link.");
+
+  // Checked after hard links, as the default storage does, so both fail with the same error.
+  for(std::uint32_t dir__ = m_current; dir__ != npos; dir__ = m_parents[dir__])
+    if(dir__ == root__)
+      throw std::runtime_error("ERROR: Can`t delete current directory.");
+
+  // Counters are updated while the subtree is still attached, hard links of the subtree are counted by its
+  // ancestors wherever their targets are.
+  for(std::uint32_t node__ : subtree__)
+    if(m_types[node__] == NODE_TYPE::HLINK)
+      m_count_hlink(m_names[node__], false);
+
+  m_remove_child(root__);
+
+  // Entities of the subtree are told apart by their parent from here on.
+  for(std::uint32_t node__ : subtree__)
+    m_parents[node__] = DELETED;
+
+  // Links of the subtree leave the lists of their targets outside of it.
+  for(std::uint32_t node__ : subtree__)
+    if(m_is_link(node__) && m_parents[m_names[node__]] != DELETED)
+      m_unlink_link(node__);
+
+  // Links left attached to entities of the subtree are dynamic links placed outside of it.
+  for(std::uint32_t node__ : subtree__)
+    if(!m_is_link(node__))
+      for(std::uint32_t link__ = m_links[node__]; link__ != npos; link__ = m_links[link__])
+        if(m_parents[link__] != DELETED)
+          {
+            m_remove_child(link__);
+            m_release(link__);
+          }
+
+  for(std::uint32_t node__ : subtree__)
+    m_release(node__);
+}
+
+std::vector<std::string>
+Node_table::find(std::string_view pattern, std::string_view root) const
+{
+  std::uint32_t root__ = root.empty() ? DRIVE : m_find(root);
+
+  if(root__ == npos || m_types[root__] != NODE_TYPE::DIRECTORY)
+    throw std::runtime_error("ERROR: Path is not found.");
+
+  std::vector<std::string> paths__;
+  std::vector<std::uint32_t> stack__{ root__ };
+
+  while(!stack__.empty())
+    {
+      std::uint32_t node__ = stack__.back();
+      stack__.pop_back();
+
+      if(m_is_link(node__))
+        continue;
+
+      if(Name_index::matches(pattern, m_name_table.name(m_names[node__])))
+        m_write_path(node__, paths__.emplace_back());
+
+      if(m_types[node__] == NODE_TYPE::DIRECTORY)
+        for(std::uint32_t child__ = m_first_childs[node__]; child__ != npos; child__ = m_next_siblings[child__])
+          stack__.push_back(child__);
+    }
+
+  std::sort(paths__.begin(), paths__.end());
+  return paths__;
+}
+
+void
+Node_table::print(std::ostream& stream) const
+{
+  Tree_writer writer__{ stream };
+  std::vector<std::pair<std::uint32_t, std::size_t>> stack__{ { DRIVE, 0 } };
+  std::vector<std::pair<std::string, std::uint32_t>> childs__;
+  std::string name__;
+
+  while(!stack__.empty())
+    {
+      auto [node__, depth__] = stack__.back();
+      stack__.pop_back();
+
+      m_write_display_name(node__, name__);
+      writer__.line(depth__, name__);
+
+      if(m_types[node__] != NODE_TYPE::DIRECTORY)
+        continue;
+
+      childs__.clear();
+
+      for(std::uint32_t child__ = m_first_childs[node__]; child__ != npos; child__ = m_next_siblings[child__])
+        {
+          childs__.emplace_back(std::string{}, child__);
+          m_write_display_name(child__, childs__.back().first);
+        }
+
+      std::sort(childs__.begin(), childs__.end());
+
+      // Children go onto the stack in reverse, so they come out sorted.
+      for(auto it__ = childs__.rbegin(); it__ != childs__.rend(); ++it__)
+        stack__.emplace_back(it__->second, depth__ + 1);
+    }
+
+  writer__.finish();
+}
+
+std::size_t
+Node_table::index_bytes() const noexcept
+{
+  std::size_t bytes__ = m_subtree_hlinks.size() * 2 * sizeof(std::uint32_t);
+
+  for(const auto& [dir__, table__] : m_child_tables)
+    bytes__ += sizeof(Child_table) + table__.m_slots.size() * sizeof(std::uint32_t);
+
+  return bytes__;
+}
+
+std::uint32_t
+Node_table::m_allocate(NODE_TYPE type, std::uint32_t name)
+{
+  std::uint32_t node__ = m_free;
+
+  if(node__ != npos)
+    {
+      m_free = m_next_siblings[node__];
+      --m_free_slots;
+
+      m_types[node__] = type;
+      m_parents[node__] = npos;
+      m_first_childs[node__] = npos;
+      m_prev_siblings[node__] = npos;
+      m_next_siblings[node__] = npos;
+      m_names[node__] = name;
+      m_links[node__] = npos;
+    }
+  else
+    {
+      if(m_types.size() >= ROOT - 1)
+        throw std::runtime_error("ERROR: Too many entities for the compact storage.");
+
+      node__ = static_cast<std::uint32_t>(m_types.size());
+
+      m_types.push_back(type);
+      m_parents.push_back(npos);
+      m_first_childs.push_back(npos);
+      m_prev_siblings.push_back(npos);
+      m_next_siblings.push_back(npos);
+      m_names.push_back(name);
+      m_links.push_back(npos);
+    }
+
+  ++m_counts[static_cast<std::size_t>(type)];
+  return node__;
+}
+
+void
+Node_table::m_release(std::uint32_t node)
+{
+  if(m_types[node] == NODE_TYPE::DIRECTORY)
+    m_child_tables.erase(node);
+
+  --m_counts[static_cast<std::size_t>(m_types[node])];
+
+  m_parents[node] = npos;
+  m_next_siblings[node] = m_free;
+  m_free = node;
+  ++m_free_slots;
+}
+
+std::uint32_t
+Node_table::m_find(std::string_view path) const
+{
+  if(path.empty())
+    return m_current;
+
+  std::uint32_t curr__ = path.starts_with(DRIVE_NAME) ? ROOT : m_current;
+
+  for(std::string_view entity_name__ : split_path(path))
+    {
+      NODE_TYPE link_type__;
+      std::string_view target_path__;
+
+      // Links are found by their targets, so resolve the path enclosed in the link's name first.
+      if(parse_link_name(entity_name__, link_type__, target_path__))
+        {
+          std::uint32_t target__ = m_find(target_path__);
+
+          if(target__ == npos || m_is_link(target__))
+            return npos;
+
+          return m_find_link(curr__, link_type__, target__);
+        }
+
+      Name_id name_id__ = m_name_table.find(entity_name__);
+
+      if(name_id__ == Name_table::npos)
+        return npos;
+
+      std::uint32_t child__ = m_find_named(curr__, name_id__);
+
+      if(child__ == npos || m_types[child__] != NODE_TYPE::DIRECTORY)
+        return child__;
+
+      curr__ = child__;
+    }
+
+  return curr__;
+}
+
+std::uint32_t
+Node_table::m_find_named(std::uint32_t dir, Name_id name) const noexcept
+{
+  if(dir == ROOT)
+    return m_names[DRIVE] == name ? DRIVE : npos;
+
+  if(auto it__ = m_child_tables.find(dir); it__ != m_child_tables.end())
+    {
+      const std::vector<std::uint32_t>& slots__ = it__->second.m_slots;
+
+      for(std::size_t i = m_home(name, slots__.size() - 1);; i = (i + 1) & (slots__.size() - 1))
+        if(slots__[i] == npos || FSE_PROFILE_COMPARE(m_names[slots__[i]] == name))
+          return slots__[i];
+    }
+
+  for(std::uint32_t child__ = m_first_childs[dir]; child__ != npos; child__ = m_next_siblings[child__])
+    if(FSE_PROFILE_COMPARE(m_names[child__] == name) && !m_is_link(child__))
+      return child__;
+
+  return npos;
+}
+
+std::uint32_t
+Node_table::m_find_link(std::uint32_t dir, NODE_TYPE type, std::uint32_t target) const noexcept
+{
+  for(std::uint32_t link__ = m_links[target]; link__ != npos; link__ = m_links[link__])
+    if(FSE_PROFILE_COMPARE(m_parents[link__] == dir) && m_types[link__] == type)
+      return link__;
+
+  return npos;
+}
+
+std::uint32_t
+Node_table::m_find_same(std::uint32_t dir, std::uint32_t node) const noexcept
+{
+  return m_is_link(node) ? m_find_link(dir, m_types[node], m_names[node]) : m_find_named(dir, m_names[node]);
+}
+
+void
+Node_table::m_make_node(std::string_view path, NODE_TYPE type)
+{
+  std::uint32_t parent__ = m_find(get_parent_path(path));
+
+  if(parent__ == npos || m_types[parent__] != NODE_TYPE::DIRECTORY)
+    throw std::runtime_error("ERROR: Path not found.");
+
+  std::string_view name__ = get_path_basename(path);
+  Name_id name_id__ = m_name_table.find(name__);
+
+  if(std::uint32_t child__ = name_id__ != Name_table::npos ? m_find_named(parent__, name_id__) : npos; child__ != npos)
+    {
+      if(m_types[child__] == NODE_TYPE::FILE && type != NODE_TYPE::FILE)
+        throw std::runtime_error("ERROR: Can`t create a directory - File with the same name exists.");
+      if(m_types[child__] == NODE_TYPE::DIRECTORY && type != NODE_TYPE::DIRECTORY)
+        throw std::runtime_error("ERROR: Can`t create a file - Directory with the same name exists.");
+
+      // The same entity exists already, so nothing is created.
+      return;
+    }
+
+  m_add_child(parent__, m_allocate(type, m_name_table.intern(name__)));
+}
+
+void
+Node_table::m_make_link(std::string_view source, std::string_view dest, NODE_TYPE type)
+{
+  std::uint32_t source__ = m_find(source);
+
+  if(source__ == npos)
+    throw std::runtime_error("ERROR: Path is not found.");
+
+  if(m_is_link(source__))
+    throw std::runtime_error("ERROR: Can`t create a link to a link.");
+
+  std::uint32_t dest__ = m_find(dest);
+
+  if(dest__ == npos || m_types[dest__] != NODE_TYPE::DIRECTORY)
+    throw std::runtime_error("ERROR: Path not found.");
+
+  if(m_find_link(dest__, type, source__) != npos)
+    return;
+
+  std::uint32_t link__ = m_allocate(type, source__);
+
+  m_attach_link(link__, source__);
+  m_add_child(dest__, link__);
+}
+
+void
+Node_table::m_remove_node(std::uint32_t node)
+{
+  if(!m_is_link(node))
+    {
+      for(std::uint32_t link__ = m_links[node]; link__ != npos; link__ = m_links[link__])
+        if(m_types[link__] == NODE_TYPE::HLINK)
+          throw std::runtime_error("ERROR: Can`t delete entity with attached hard link.");
+
+      // Only dynamic links are left, they go along with their target.
+      for(std::uint32_t link__ = m_links[node]; link__ != npos; link__ = m_links[link__])
+        {
+          m_remove_child(link__);
+          m_release(link__);
+        }
+
+      m_links[node] = npos;
+    }
+  else
+    m_detach_link(node);
+
+  m_remove_child(node);
+  m_release(node);
+}
+
+void
+Node_table::m_add_child(std::uint32_t dir, std::uint32_t child)
+{
+  m_parents[child] = dir;
+  m_prev_siblings[child] = npos;
+  m_next_siblings[child] = m_first_childs[dir];
+
+  if(m_first_childs[dir] != npos)
+    m_prev_siblings[m_first_childs[dir]] = child;
+
+  m_first_childs[dir] = child;
+
+  if(m_is_link(child))
+    return;
+
+  if(auto it__ = m_child_tables.find(dir); it__ != m_child_tables.end())
+    {
+      ++it__->second.m_named;
+      m_table_insert(it__->second, child);
+      return;
+    }
+
+  std::uint32_t named__ = 0;
+
+  for(std::uint32_t curr__ = m_first_childs[dir]; curr__ != npos && named__ <= LINEAR_SEARCH_LIMIT;
+      curr__ = m_next_siblings[curr__])
+    named__ += !m_is_link(curr__);
+
+  if(named__ <= LINEAR_SEARCH_LIMIT)
+    return;
+
+  // Counting stopped at the limit, the table learns the real number while it's filled.
+  Child_table& table__ = m_child_tables[dir];
+  table__.m_named = 0;
+
+  for(std::uint32_t curr__ = m_first_childs[dir]; curr__ != npos; curr__ = m_next_siblings[curr__])
+    if(!m_is_link(curr__))
+      {
+        ++table__.m_named;
+        m_table_insert(table__, curr__);
+      }
+}
+
+void
+Node_table::m_remove_child(std::uint32_t child)
+{
+  std::uint32_t dir__ = m_parents[child];
+  std::uint32_t prev__ = m_prev_siblings[child];
+  std::uint32_t next__ = m_next_siblings[child];
+
+  (prev__ == npos ? m_first_childs[dir__] : m_next_siblings[prev__]) = next__;
+
+  if(next__ != npos)
+    m_prev_siblings[next__] = prev__;
+
+  m_parents[child] = npos;
+  m_prev_siblings[child] = npos;
+  m_next_siblings[child] = npos;
+
+  if(m_is_link(child))
+    return;
+
+  if(auto it__ = m_child_tables.find(dir__); it__ != m_child_tables.end())
+    {
+      m_table_erase(it__->second, child);
+
+      // The table is dropped well below the limit, so a directory at the limit isn't rebuilt over and over.
+      if(--it__->second.m_named < LINEAR_SEARCH_LIMIT / 2)
+        m_child_tables.erase(it__);
+    }
+}
+
+void
+Node_table::m_attach_link(std::uint32_t link, std::uint32_t target)
+{
+  if(m_types[link] == NODE_TYPE::HLINK)
+    m_count_hlink(target, true);
+
+  // Links have no children, so the first child of a link is the previous link of its target.
+  m_names[link] = target;
+  m_first_childs[link] = npos;
+  m_links[link] = m_links[target];
+
+  if(m_links[target] != npos)
+    m_first_childs[m_links[target]] = link;
+
+  m_links[target] = link;
+}
+
+void
+Node_table::m_detach_link(std::uint32_t link)
+{
+  m_unlink_link(link);
+
+  if(m_types[link] == NODE_TYPE::HLINK)
+    m_count_hlink(m_names[link], false);
+}
+
+void
+Node_table::m_unlink_link(std::uint32_t link) noexcept
+{
+  std::uint32_t prev__ = m_first_childs[link];
+  std::uint32_t next__ = m_links[link];
+
+  (prev__ == npos ? m_links[m_names[link]] : m_links[prev__]) = next__;
+
+  if(next__ != npos)
+    m_first_childs[next__] = prev__;
+
+  m_first_childs[link] = npos;
+  m_links[link] = npos;
+}
+
+void
+Node_table::m_count_hlink(std::uint32_t target, bool is_added)
+{
+  // Files are checked by their own links, only directories keep counters.
+  std::uint32_t dir__ = m_types[target] == NODE_TYPE::DIRECTORY ? target : m_parents[target];
+
+  for(; dir__ != npos; dir__ = m_parents[dir__])
+    if(is_added)
+      ++m_subtree_hlinks[dir__];
+    else if(auto it__ = m_subtree_hlinks.find(dir__); --it__->second == 0)
+      m_subtree_hlinks.erase(it__);
+}
+
+bool
+Node_table::m_has_outer_hlinks(const std::vector<std::uint32_t>& subtree) const
+{
+  auto it__ = m_subtree_hlinks.find(subtree.front());
+
+  if(it__ == m_subtree_hlinks.end())
+    return false;
+
+  // The counter of the root holds every hard link attached inside the subtree, wherever the link is placed.
+  std::unordered_map<std::uint32_t, std::uint32_t> inner_hlinks__;
+
+  for(std::uint32_t node__ : subtree)
+    if(m_types[node__] == NODE_TYPE::HLINK)
+      ++inner_hlinks__[m_names[node__]];
+
+  std::size_t inner__ = 0;
+
+  for(std::uint32_t node__ : subtree)
+    if(!m_is_link(node__))
+      if(auto inner_it__ = inner_hlinks__.find(node__); inner_it__ != inner_hlinks__.end())
+        inner__ += inner_it__->second;
+
+  return inner__ != it__->second;
+}
+
+bool
+Node_table::m_has_hlinks(std::uint32_t node) const noexcept
+{
+  if(m_types[node] == NODE_TYPE::DIRECTORY)
+    return m_subtree_hlinks.contains(node);
+
+  if(m_types[node] == NODE_TYPE::FILE)
+    for(std::uint32_t link__ = m_links[node]; link__ != npos; link__ = m_links[link__])
+      if(m_types[link__] == NODE_TYPE::HLINK)
+        return true;
+
+  return false;
+}
+
+std::uint32_t
+Node_table::m_copy(std::uint32_t source)
+{
+  std::uint32_t copy__ = m_copy_node(source);
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> stack__;
+
+  if(m_types[source] == NODE_TYPE::DIRECTORY)
+    stack__.emplace_back(source, copy__);
+
+  while(!stack__.empty())
+    {
+      auto [dir__, dir_copy__] = stack__.back();
+      stack__.pop_back();
+
+      for(std::uint32_t child__ = m_first_childs[dir__]; child__ != npos; child__ = m_next_siblings[child__])
+        {
+          std::uint32_t child_copy__ = m_copy_node(child__);
+          m_add_child(dir_copy__, child_copy__);
+
+          if(m_types[child__] == NODE_TYPE::DIRECTORY)
+            stack__.emplace_back(child__, child_copy__);
+        }
+    }
+
+  return copy__;
+}
+
+std::uint32_t
+Node_table::m_copy_node(std::uint32_t source)
+{
+  if(!m_is_link(source))
+    return m_allocate(m_types[source], m_names[source]);
+
+  std::uint32_t copy__ = m_allocate(m_types[source], m_names[source]);
+  m_attach_link(copy__, m_names[source]);
+
+  return copy__;
+}
+
+void
+Node_table::m_table_insert(Child_table& table, std::uint32_t child)
+{
+  if(table.m_named * 4 > table.m_slots.size() * 3)
+    {
+      std::vector<std::uint32_t> slots__ = std::move(table.m_slots);
+      table.m_slots.assign(std::bit_ceil(std::size_t{ table.m_named } * 2), npos);
+
+      for(std::uint32_t node__ : slots__)
+        if(node__ != npos)
+          m_table_insert(table, node__);
+    }
+
+  std::size_t mask__ = table.m_slots.size() - 1;
+  std::size_t i = m_home(m_names[child], mask__);
+
+  while(table.m_slots[i] != npos)
+    i = (i + 1) & mask__;
+
+  table.m_slots[i] = child;
+}
+
+void
+Node_table::m_table_erase(Child_table& table, std::uint32_t child) noexcept
+{
+  std::size_t mask__ = table.m_slots.size() - 1;
+  std::size_t i = m_home(m_names[child], mask__);
+
+  while(table.m_slots[i] != child)
+    i = (i + 1) & mask__;
+
+  // An entry moves into the hole unless its home lies between the hole and the entry.
+  for(std::size_t j = (i + 1) & mask__; table.m_slots[j] != npos; j = (j + 1) & mask__)
+    if(((j - m_home(m_names[table.m_slots[j]], mask__)) & mask__) >= ((j - i) & mask__))
+      {
+        table.m_slots[i] = table.m_slots[j];
+        i = j;
+      }
+
+  table.m_slots[i] = npos;
+}
+
+void
+Node_table::m_write_path(std::uint32_t node, std::string& buffer) const
+{
+  // First walk up measures the path, so the second one fills the buffer from its end.
+  std::size_t size__ = m_name_table.name(m_names[node]).size();
+
+  for(std::uint32_t dir__ = m_parents[node]; dir__ != npos; dir__ = m_parents[dir__])
+    size__ += m_name_table.name(m_names[dir__]).size() + 1;
+
+  buffer.resize(size__);
+  char* end__ = buffer.data() + size__;
+
+  for(std::uint32_t curr__ = node; curr__ != npos; curr__ = m_parents[curr__])
+    {
+      std::string_view name__ = m_name_table.name(m_names[curr__]);
+
+      end__ -= name__.size();
+      name__.copy(end__, name__.size());
+
+      if(m_parents[curr__] != npos)
+        *--end__ = '\\';
+    }
+}
+
+void
+Node_table::m_write_display_name(std::uint32_t node, std::string& buffer) const
+{
+  if(!m_is_link(node))
+    {
+      buffer.assign(m_name_table.name(m_names[node]));
+      return;
+    }
+
+  std::string path__;
+  m_write_path(m_names[node], path__);
+
+  buffer.assign(m_types[node] == NODE_TYPE::HLINK ? HLINK_PREFIX : DLINK_PREFIX);
+  buffer += path__;
+  buffer += ']';
+}
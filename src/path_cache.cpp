@@ -0,0 +1,134 @@
+#include "path_cache.hpp"
+
+Path_cache::Path_cache(std::size_t capacity)
+    : m_capacity(capacity), m_hits(0), m_misses(0), m_invalidated(0), m_evicted(0), m_entries(), m_order(), m_clock(),
+      m_hand(0)
+{
+}
+
+Node*
+Path_cache::find(std::string_view path) noexcept
+{
+  if(m_capacity == 0)
+    return nullptr;
+
+  auto it__ = m_entries.find(path);
+
+  if(it__ == m_entries.end())
+    {
+      ++m_misses;
+      return nullptr;
+    }
+
+  ++m_hits;
+  it__->second.m_is_found = true;
+  return it__->second.m_node;
+}
+
+void
+Path_cache::insert(std::string_view path, Node* node)
+{
+  if(m_capacity == 0)
+    return;
+
+  if(auto it__ = m_entries.find(path); it__ != m_entries.end())
+    {
+      it__->second.m_node = node;
+      return;
+    }
+
+  // A new entry takes the place of the evicted one, so the hand reaches it only after a full turn.
+  std::size_t slot__ = m_clock.size();
+
+  if(m_entries.size() >= m_capacity)
+    {
+      slot__ = m_find_victim();
+
+      m_order.erase(m_clock[slot__]->first);
+      m_entries.erase(m_entries.find(m_clock[slot__]->first));
+      ++m_evicted;
+    }
+  else
+    m_clock.push_back(nullptr);
+
+  auto it__ = m_entries.emplace(path, Entry{ node, slot__, false }).first;
+
+  m_order.insert(it__->first);
+  m_clock[slot__] = &*it__;
+}
+
+void
+Path_cache::invalidate(std::string_view path)
+{
+  if(auto it__ = m_entries.find(path); it__ != m_entries.end())
+    {
+      m_erase(it__->second.m_slot);
+      ++m_invalidated;
+    }
+
+  // All paths below %path start with "%path\", hence they form one contiguous range of the ordered keys.
+  std::string prefix__{ path };
+  prefix__ += '\\';
+
+  for(auto it__ = m_order.lower_bound(prefix__); it__ != m_order.end() && it__->starts_with(prefix__);
+      it__ = m_order.lower_bound(prefix__))
+    {
+      m_erase(m_entries.find(*it__)->second.m_slot);
+      ++m_invalidated;
+    }
+}
+
+void
+Path_cache::clear() noexcept
+{
+  m_order.clear();
+  m_clock.clear();
+  m_entries.clear();
+  m_hand = 0;
+}
+
+void
+Path_cache::set_capacity(std::size_t capacity)
+{
+  m_capacity = capacity;
+
+  while(m_entries.size() > m_capacity)
+    {
+      m_erase(m_find_victim());
+      ++m_evicted;
+    }
+}
+
+Path_cache::Stats
+Path_cache::stats() const noexcept
+{
+  return { m_hits, m_misses, m_invalidated, m_evicted, m_entries.size() };
+}
+
+std::size_t
+Path_cache::m_find_victim() noexcept
+{
+  if(m_hand >= m_clock.size())
+    m_hand = 0;
+
+  while(m_clock[m_hand]->second.m_is_found)
+    {
+      m_clock[m_hand]->second.m_is_found = false;
+      m_hand = m_hand + 1 == m_clock.size() ? 0 : m_hand + 1;
+    }
+
+  return m_hand;
+}
+
+void
+Path_cache::m_erase(std::size_t slot) noexcept
+{
+  Entries::value_type* entry__ = m_clock[slot];
+
+  m_clock[slot] = m_clock.back();
+  m_clock[slot]->second.m_slot = slot;
+  m_clock.pop_back();
+
+  m_order.erase(entry__->first);
+  m_entries.erase(m_entries.find(entry__->first));
+}
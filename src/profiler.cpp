@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <utility>
+
+#include "profiler.hpp"
+
+/**
+ * @brief Percentiles reported for every operation in the profile.
+ */
+static constexpr std::array<std::pair<std::string_view, double>, 4> PERCENTILES{
+  { { "p50", 50.0 }, { "p90", 90.0 }, { "p99", 99.0 }, { "p999", 99.9 } }
+};
+
+/**
+ * @brief Writes the summary of a histogram as a JSON object.
+ *
+ * @param histogram The histogram to write.
+ * @param stream The stream to write to.
+ */
+static void
+write_histogram(const Latency_histogram& histogram, std::ostream& stream)
+{
+  stream << "{ \"count\": " << histogram.count() << ", \"total\": " << histogram.total()
+         << ", \"min\": " << histogram.min();
+
+  for(const auto& [name__, percentile__] : PERCENTILES)
+    stream << ", \"" << name__ << "\": " << histogram.percentile(percentile__);
+
+  stream << ", \"max\": " << histogram.max() << " }";
+}
+
+void
+Latency_histogram::record(std::uint64_t value) noexcept
+{
+  ++m_counts[m_bucket(value)];
+  ++m_count;
+  m_total += value;
+  m_min = std::min(m_min, value);
+  m_max = std::max(m_max, value);
+}
+
+std::uint64_t
+Latency_histogram::percentile(double percentile) const noexcept
+{
+  if(m_count == 0)
+    return 0;
+
+  // Rank of the value, the smallest one for 0 and the largest one for 100.
+  double rank__ = std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * static_cast<double>(m_count));
+  std::uint64_t wanted__ = std::max<std::uint64_t>(static_cast<std::uint64_t>(rank__), 1);
+  std::uint64_t seen__ = 0;
+
+  for(std::size_t i = 0; i < BUCKETS; ++i)
+    {
+      seen__ += m_counts[i];
+
+      // The largest value is known exactly, so the last bucket never reports more than that.
+      if(seen__ >= wanted__)
+        return std::min(m_highest(i), m_max);
+    }
+
+  return m_max;
+}
+
+std::size_t
+Latency_histogram::m_bucket(std::uint64_t value) noexcept
+{
+  if(value < SUB_BUCKETS)
+    return value;
+
+  // The top SUB_BUCKET_BITS + 1 bits of the value select the bucket within its power of two.
+  std::size_t shift__ = std::bit_width(value) - SUB_BUCKET_BITS - 1;
+  return (shift__ + 1) * SUB_BUCKETS + (value >> shift__) - SUB_BUCKETS;
+}
+
+std::uint64_t
+Latency_histogram::m_highest(std::size_t bucket) noexcept
+{
+  if(bucket < SUB_BUCKETS)
+    return bucket;
+
+  std::size_t shift__ = bucket / SUB_BUCKETS - 1;
+  std::uint64_t lowest__ = static_cast<std::uint64_t>(bucket % SUB_BUCKETS + SUB_BUCKETS) << shift__;
+
+  return lowest__ + ((std::uint64_t{ 1 } << shift__) - 1);
+}
+
+void
+Profiler::write_json(std::ostream& stream) const
+{
+  stream << "{\n  \"counters\": {";
+
+  for(std::size_t i = 0; i < m_counters.size(); ++i)
+    stream << (i ? ",\n" : "\n") << "    \"" << PROFILE_COUNTER_NAMES[i] << "\": " << m_counters[i];
+
+  stream << "\n  },\n  \"latencies_ns\": {";
+
+  const char* separator__ = "\n";
+
+  for(const auto& info__ : COMMANDS)
+    {
+      const Latency_histogram& histogram__ = m_latencies[static_cast<std::size_t>(info__.m_type)];
+
+      if(histogram__.count() == 0 || info__.m_type == COMMAND_TYPE::UNKNOWN)
+        continue;
+
+      stream << separator__ << "    \"" << info__.m_name << "\": ";
+      write_histogram(histogram__, stream);
+      separator__ = ",\n";
+    }
+
+  if(m_print_latencies.count() != 0)
+    {
+      stream << separator__ << "    \"print\": ";
+      write_histogram(m_print_latencies, stream);
+    }
+
+  stream << "\n  }\n}\n";
+}
@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "script_reader.hpp"
+
+Script_reader::Script_reader(const char* path) noexcept
+    : m_fd(::open(path, O_RDONLY)), m_file(m_fd), m_blocks(), m_spare(), m_data(m_file.data()), m_size(m_file.size()), m_capacity(m_size),
+      m_pos(0), m_scanned(0), m_is_open(m_fd != -1)
+{
+  // Scripts that are mapped need no descriptor, the others are read from it.
+  if(m_file.is_open())
+    {
+      ::close(m_fd);
+      m_fd = -1;
+    }
+  else
+    m_size = m_capacity = 0;
+}
+
+Script_reader::~Script_reader()
+{
+  if(m_fd != -1)
+    ::close(m_fd);
+}
+
+bool
+Script_reader::next_line(std::string_view& line)
+{
+  for(;;)
+    {
+      if(m_scanned < m_size)
+        if(const void* end__ = std::memchr(m_data + m_scanned, '\n', m_size - m_scanned))
+          {
+            std::size_t end_pos__ = static_cast<const char*>(end__) - m_data;
+
+            line = std::string_view(m_data + m_pos, end_pos__ - m_pos);
+            m_pos = m_scanned = end_pos__ + 1;
+
+            return true;
+          }
+
+      m_scanned = m_size;
+
+      if(!m_fill())
+        break;
+    }
+
+  // The last line may have no line break.
+  if(m_pos >= m_size)
+    return false;
+
+  line = std::string_view(m_data + m_pos, m_size - m_pos);
+  m_pos = m_scanned = m_size;
+
+  return true;
+}
+
+void
+Script_reader::release() noexcept
+{
+  if(m_blocks.size() < 2)
+    return;
+
+  // The largest block is kept, so a long line doesn't make the reader allocate over and over.
+  for(std::size_t i = 0; i + 1 < m_blocks.size(); ++i)
+    if(m_blocks[i].m_capacity > m_spare.m_capacity)
+      m_spare = std::move(m_blocks[i]);
+
+  m_blocks.erase(m_blocks.begin(), m_blocks.end() - 1);
+}
+
+std::size_t
+Script_reader::buffered_bytes() const noexcept
+{
+  std::size_t bytes__ = m_spare.m_capacity;
+
+  for(const Block& block__ : m_blocks)
+    bytes__ += block__.m_capacity;
+
+  return bytes__;
+}
+
+bool
+Script_reader::m_fill()
+{
+  if(m_fd == -1)
+    return false;
+
+  if(m_size == m_capacity)
+    {
+      std::size_t tail__ = m_size - m_pos;
+      std::size_t capacity__ = std::max(BLOCK_SIZE, 2 * tail__);
+
+      if(m_spare.m_capacity >= capacity__)
+        m_blocks.push_back(std::move(m_spare));
+      else
+        {
+          m_blocks.push_back({ std::unique_ptr<char[]>(new(std::nothrow) char[capacity__]), capacity__ });
+
+          if(!m_blocks.back().m_bytes)
+            {
+              m_blocks.pop_back();
+              throw std::runtime_error("ERROR: Not enough memory to read the script.");
+            }
+        }
+
+      m_spare = Block();
+
+      char* block__ = m_blocks.back().m_bytes.get();
+
+      if(tail__ != 0)
+        std::memcpy(block__, m_data + m_pos, tail__);
+
+      m_data = block__;
+      m_size = m_scanned = tail__;
+      m_capacity = m_blocks.back().m_capacity;
+      m_pos = 0;
+    }
+
+  ssize_t read__;
+
+  do
+    read__ = ::read(m_fd, m_blocks.back().m_bytes.get() + m_size, m_capacity - m_size);
+  while(read__ == -1 && errno == EINTR);
+
+  if(read__ == -1)
+    throw std::runtime_error("ERROR: Can`t read the script.");
+
+  if(read__ == 0)
+    {
+      ::close(m_fd);
+      m_fd = -1;
+
+      return false;
+    }
+
+  m_size += static_cast<std::size_t>(read__);
+
+  return true;
+}
@@ -0,0 +1,399 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "file_system_emulator.hpp"
+#include "mapped_file.hpp"
+#include "snapshot.hpp"
+
+/**
+ * @brief Rounds a size up to a multiple of 4 bytes, so the records that follow the names stay aligned.
+ */
+static std::size_t
+align_size(std::size_t size)
+{
+  return (size + 3) & ~static_cast<std::size_t>(3);
+}
+
+/**
+ * @brief Waits until a file or a directory is on the disk.
+ *
+ * @param path The path to the file or the directory.
+ * @param flags Flags to open it with besides O_RDONLY, e.g. O_DIRECTORY.
+ * @return False if it can't be opened or synced.
+ */
+static bool
+sync_path(const char* path, int flags)
+{
+  int fd__ = ::open(path, O_RDONLY | flags);
+  bool is_synced__ = fd__ != -1 && ::fsync(fd__) == 0;
+
+  if(fd__ != -1)
+    ::close(fd__);
+
+  return is_synced__;
+}
+
+/**
+ * @brief Checks that records of a snapshot describe a well-formed tree.
+ *
+ * @param header The header of the snapshot.
+ * @param records The records of the snapshot.
+ * @return True if every node comes after its parent directory, links point to files or directories, names are
+ * known and only the drive has the empty one, and no two children of a directory have the same key, otherwise
+ * False.
+ */
+static bool
+is_valid_tree(const Snapshot_header& header, const Snapshot_record* records)
+{
+  auto is_type__ = [](const Snapshot_record& record, NODE_TYPE type) {
+    return record.m_type == static_cast<std::uint32_t>(type);
+  };
+
+  if(header.m_nodes == 0 || header.m_curr_catalog >= header.m_nodes)
+    return false;
+
+  if(records[0].m_parent != SNAPSHOT_NONE || !is_type__(records[0], NODE_TYPE::DIRECTORY)
+     || !is_type__(records[header.m_curr_catalog], NODE_TYPE::DIRECTORY))
+    return false;
+
+  // Keys of children by their parents, links are keyed by indices of their targets instead of the nodes.
+  std::vector<std::pair<std::uint32_t, Child_key>> keys__;
+  keys__.reserve(header.m_nodes - 1);
+
+  for(std::size_t i = 0; i < header.m_nodes; ++i)
+    {
+      const Snapshot_record& record__ = records[i];
+
+      if(i != 0 && (record__.m_parent >= i || !is_type__(records[record__.m_parent], NODE_TYPE::DIRECTORY)))
+        return false;
+
+      if(is_type__(record__, NODE_TYPE::FILE) || is_type__(record__, NODE_TYPE::DIRECTORY))
+        {
+          if(record__.m_value > header.m_names || (i != 0 && record__.m_value == 0))
+            return false;
+
+          if(i != 0)
+            keys__.emplace_back(record__.m_parent, Child_key::named(record__.m_value));
+        }
+      else if(is_type__(record__, NODE_TYPE::HLINK) || is_type__(record__, NODE_TYPE::DLINK))
+        {
+          if(record__.m_value >= header.m_nodes
+             || !(is_type__(records[record__.m_value], NODE_TYPE::FILE)
+                  || is_type__(records[record__.m_value], NODE_TYPE::DIRECTORY)))
+            return false;
+
+          keys__.emplace_back(record__.m_parent, Child_key{ static_cast<NODE_TYPE>(record__.m_type), record__.m_value });
+        }
+      else
+        return false;
+    }
+
+  // Names and links are unique within a directory, lookups of children rely on it.
+  auto less__ = [](const std::pair<std::uint32_t, Child_key>& lhs, const std::pair<std::uint32_t, Child_key>& rhs) {
+    return std::tie(lhs.first, lhs.second.m_type, lhs.second.m_value)
+           < std::tie(rhs.first, rhs.second.m_type, rhs.second.m_value);
+  };
+
+  std::sort(keys__.begin(), keys__.end(), less__);
+  return std::adjacent_find(keys__.begin(), keys__.end()) == keys__.end();
+}
+
+void
+File_system_emulator::save_snapshot(const std::string& path) const
+{
+  if(m_table)
+    throw std::runtime_error("ERROR: Snapshots aren`t supported by the compact storage.");
+
+  std::vector<const Node*> nodes__;
+  std::vector<Snapshot_record> records__;
+  std::vector<std::uint32_t> name_lengths__;
+  std::string name_bytes__;
+
+  // Names are renumbered densely, so names of entities removed long ago don't end up in the snapshot.
+  std::vector<Name_id> name_ids__(m_names.stats().m_names, 0);
+  std::unordered_map<const Node*, std::uint32_t> targets__;
+  // Entities reached through a copy-on-write copy belong to its source, they're stored once per place they're seen
+  // in but only their own place may be referred to by links or be the current directory.
+  std::vector<std::tuple<const Node*, std::uint32_t, bool>> stack__{ { m_root->m_childs.front(), SNAPSHOT_NONE, false } };
+
+  while(!stack__.empty())
+    {
+      auto [node__, parent__, is_shared__] = stack__.back();
+      stack__.pop_back();
+
+      std::uint32_t index__ = static_cast<std::uint32_t>(records__.size());
+      Snapshot_record record__{ parent__, static_cast<std::uint32_t>(node__->m_type), 0 };
+
+      if(node__->m_type == NODE_TYPE::FILE || node__->m_type == NODE_TYPE::DIRECTORY)
+        {
+          const Linked_node* linked_node__ = static_cast<const Linked_node*>(node__);
+
+          if(node__->m_name != 0 && name_ids__[node__->m_name] == 0)
+            {
+              std::string_view name__ = m_names.name(node__->m_name);
+
+              name_lengths__.push_back(static_cast<std::uint32_t>(name__.size()));
+              name_bytes__ += name__;
+              name_ids__[node__->m_name] = static_cast<Name_id>(name_lengths__.size());
+            }
+
+          record__.m_value = name_ids__[node__->m_name];
+
+          if(!is_shared__ && linked_node__->m_links)
+            targets__.emplace(node__, index__);
+        }
+
+      nodes__.push_back(is_shared__ ? nullptr : node__);
+      records__.push_back(record__);
+
+      if(node__->m_type == NODE_TYPE::DIRECTORY)
+        {
+          const Directory* dir__ = static_cast<const Directory*>(node__);
+          const auto& childs__ = dir__->childs();
+
+          for(auto it__ = childs__.rbegin(); it__ != childs__.rend(); ++it__)
+            if(!is_dangling(*it__))
+              stack__.emplace_back(*it__, index__, is_shared__ || dir__->m_shared);
+        }
+    }
+
+  Snapshot_header header__{};
+  std::memcpy(header__.m_magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+
+  // Targets may follow their links in pre-order, so links are resolved once all indices are known.
+  for(std::size_t i = 0; i < nodes__.size(); ++i)
+    {
+      if(!nodes__[i])
+        continue;
+
+      if(nodes__[i]->m_type == NODE_TYPE::HLINK || nodes__[i]->m_type == NODE_TYPE::DLINK)
+        records__[i].m_value = targets__.at(static_cast<const Link*>(nodes__[i])->m_target);
+      else if(nodes__[i] == m_curr_catalog)
+        header__.m_curr_catalog = i;
+    }
+
+  header__.m_version = SNAPSHOT_VERSION;
+  header__.m_byte_order = SNAPSHOT_BYTE_ORDER;
+  header__.m_names = name_lengths__.size();
+  header__.m_name_bytes = name_bytes__.size();
+  header__.m_nodes = records__.size();
+  header__.m_sequence = m_sequence;
+
+  name_bytes__.resize(align_size(name_bytes__.size()), '\0');
+
+  std::ofstream file__{ path, std::ios::binary | std::ios::trunc };
+
+  file__.write(reinterpret_cast<const char*>(&header__), sizeof(header__));
+  file__.write(reinterpret_cast<const char*>(name_lengths__.data()), name_lengths__.size() * sizeof(std::uint32_t));
+  file__.write(name_bytes__.data(), name_bytes__.size());
+  file__.write(reinterpret_cast<const char*>(records__.data()), records__.size() * sizeof(Snapshot_record));
+  file__.flush();
+
+  if(!file__.good())
+    throw std::runtime_error("ERROR: Can`t write the snapshot.");
+}
+
+void
+File_system_emulator::load_snapshot(const std::string& path)
+{
+  // Undo log refers to nodes of the current tree.
+  if(m_in_transaction)
+    throw std::runtime_error("ERROR: Can`t load a snapshot inside a transaction.");
+
+  if(m_table)
+    throw std::runtime_error("ERROR: Snapshots aren`t supported by the compact storage.");
+
+  Mapped_file file__{ path.c_str() };
+
+  if(!file__.is_open())
+    throw std::runtime_error("ERROR: Can`t read the snapshot.");
+
+  // Validate everything before the tree is touched, so a broken snapshot leaves the tree as it was.
+  Snapshot_header header__;
+
+  if(file__.size() < sizeof(header__))
+    throw std::runtime_error("ERROR: Invalid snapshot.");
+
+  std::memcpy(&header__, file__.data(), sizeof(header__));
+
+  if(std::memcmp(header__.m_magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0
+     || header__.m_version != SNAPSHOT_VERSION || header__.m_byte_order != SNAPSHOT_BYTE_ORDER)
+    throw std::runtime_error("ERROR: Invalid snapshot.");
+
+  std::size_t size__ = file__.size();
+
+  if(header__.m_names > size__ || header__.m_name_bytes > size__ || header__.m_nodes > size__
+     || sizeof(header__) + header__.m_names * sizeof(std::uint32_t) + align_size(header__.m_name_bytes)
+                + header__.m_nodes * sizeof(Snapshot_record)
+            != size__)
+    throw std::runtime_error("ERROR: Invalid snapshot.");
+
+  // Mappings are page-aligned and every section is a multiple of 4 bytes long, so sections can be used in place.
+  const std::uint32_t* name_lengths__ = reinterpret_cast<const std::uint32_t*>(file__.data() + sizeof(header__));
+  const char* name_bytes__ = reinterpret_cast<const char*>(name_lengths__ + header__.m_names);
+  const Snapshot_record* records__
+      = reinterpret_cast<const Snapshot_record*>(name_bytes__ + align_size(header__.m_name_bytes));
+
+  std::size_t total_length__ = 0;
+
+  for(std::size_t i = 0; i < header__.m_names; ++i)
+    total_length__ += name_lengths__[i];
+
+  if(total_length__ != header__.m_name_bytes || !is_valid_tree(header__, records__))
+    throw std::runtime_error("ERROR: Invalid snapshot.");
+
+  std::vector<Name_id> name_ids__(header__.m_names + 1, 0);
+
+  for(std::size_t i = 0, offset__ = 0; i < header__.m_names; offset__ += name_lengths__[i++])
+    name_ids__[i + 1] = m_names.intern({ name_bytes__ + offset__, name_lengths__[i] });
+
+  // Drop the current tree, the pools release all of its nodes at once.
+  m_path_cache.clear();
+  m_view_listings.clear();
+  m_batch_parents.clear();
+  m_links.clear();
+  m_files.clear();
+  m_directories.clear();
+  m_sharing_dirs = 0;
+  m_linked_nodes = 0;
+  m_removed_targets.clear();
+  m_removed_dirs = 0;
+  m_dangling_links = 0;
+  m_index.clear();
+
+  m_root = m_directories.create();
+
+  std::vector<Node*> nodes__(header__.m_nodes, nullptr);
+
+  for(std::size_t i = 0; i < header__.m_nodes; ++i)
+    {
+      NODE_TYPE type__ = static_cast<NODE_TYPE>(records__[i].m_type);
+
+      if(type__ != NODE_TYPE::FILE && type__ != NODE_TYPE::DIRECTORY)
+        continue;
+
+      nodes__[i] = m_new_node(type__);
+      nodes__[i]->m_name = name_ids__[records__[i].m_value];
+      m_index.insert(nodes__[i]);
+
+      if(i == 0)
+        {
+          m_root->add_child(nodes__[i], m_names);
+
+          // Drive has no parent, absolute paths end on it.
+          nodes__[i]->m_parent = nullptr;
+        }
+      else
+        static_cast<Directory*>(nodes__[records__[i].m_parent])->add_child(nodes__[i], m_names);
+    }
+
+  // Links are keyed by their targets in the index of their parent, so they're added once all targets exist.
+  for(std::size_t i = 0; i < header__.m_nodes; ++i)
+    {
+      NODE_TYPE type__ = static_cast<NODE_TYPE>(records__[i].m_type);
+
+      if(type__ != NODE_TYPE::HLINK && type__ != NODE_TYPE::DLINK)
+        continue;
+
+      Link* link__ = static_cast<Link*>(m_new_node(type__));
+      nodes__[i] = link__;
+
+      m_attach_link(link__, static_cast<Linked_node*>(nodes__[records__[i].m_value]));
+      static_cast<Directory*>(nodes__[records__[i].m_parent])->add_child(link__, m_names);
+    }
+
+  // Adding children one by one would raise heights along the whole chain of ancestors every time, so fan-outs and
+  // heights are counted once the tree is built. Children come after their parents, so heights are final bottom-up.
+  m_fanout = {};
+
+  for(std::size_t i = header__.m_nodes; i-- > 0;)
+    {
+      if(nodes__[i]->m_type == NODE_TYPE::DIRECTORY)
+        ++m_fanout[fanout_bucket(static_cast<Directory*>(nodes__[i])->m_childs.size())];
+
+      if(i != 0)
+        {
+          static_cast<Directory*>(nodes__[records__[i].m_parent])->fit_height(nodes__[i]);
+        }
+    }
+
+  m_curr_catalog = static_cast<Directory*>(nodes__[header__.m_curr_catalog]);
+  m_write_absolute_path(m_curr_catalog, m_curr_catalog_path);
+  m_sequence = header__.m_sequence;
+}
+
+void
+File_system_emulator::open_journal(const std::string& path, std::size_t group_size)
+{
+  // The journal would get the end of a transaction without its beginning.
+  if(m_in_transaction)
+    throw std::runtime_error("ERROR: Can`t open the journal inside a transaction.");
+
+  m_journal.open(path, m_sequence, group_size);
+}
+
+void
+File_system_emulator::close_journal()
+{
+  m_journal.close();
+}
+
+void
+File_system_emulator::commit_journal()
+{
+  m_journal.commit();
+}
+
+void
+File_system_emulator::checkpoint(const std::string& snapshot_path)
+{
+  // The snapshot would keep changes the journal may still roll back.
+  if(m_in_transaction)
+    throw std::runtime_error("ERROR: Can`t make a checkpoint inside a transaction.");
+
+  m_journal.commit();
+
+  // The new snapshot has to be on the disk before it replaces the old one, and before the journal is emptied.
+  std::string temp_path__ = snapshot_path + ".tmp";
+  save_snapshot(temp_path__);
+
+  if(!sync_path(temp_path__.c_str(), 0) || std::rename(temp_path__.c_str(), snapshot_path.c_str()) != 0)
+    throw std::runtime_error("ERROR: Can`t write the snapshot.");
+
+  // Until its directory is on the disk, a crash may lose the rename but keep the emptied journal.
+  std::filesystem::path dir_path__ = std::filesystem::path(snapshot_path).parent_path();
+
+  if(!sync_path(dir_path__.empty() ? "." : dir_path__.c_str(), O_DIRECTORY))
+    throw std::runtime_error("ERROR: Can`t write the snapshot.");
+
+  m_journal.reset(m_sequence);
+}
+
+void
+File_system_emulator::recover(const std::string& snapshot_path, const std::string& journal_path)
+{
+  if(m_journal.is_open())
+    throw std::runtime_error("ERROR: Can`t recover while the journal is open.");
+
+  if(m_in_transaction)
+    throw std::runtime_error("ERROR: Can`t recover inside a transaction.");
+
+  if(!snapshot_path.empty())
+    load_snapshot(snapshot_path);
+
+  // Records up to the sequence number of the snapshot are already a part of it.
+  m_sequence = Journal::replay(journal_path, m_sequence, [this](std::span<const Command> commands) {
+    apply_batch(commands);
+  });
+}
@@ -0,0 +1,399 @@
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "tree_view.hpp"
+#include "tree_writer.hpp"
+
+static constexpr char HLINK_PREFIX[7] = "hlink[";
+static constexpr char DLINK_PREFIX[7] = "dlink[";
+
+/**
+ * @brief Appends the absolute path of a node of a tree to a buffer.
+ *
+ * @param node The file or directory whose path to append.
+ * @param names The table of names of the tree.
+ * @param buffer The buffer that receives the path.
+ */
+static void
+append_absolute_path(const Node* node, const Name_table& names, std::string& buffer)
+{
+  std::size_t size__ = names.name(node->m_name).size();
+
+  for(const Directory* dir__ = node->m_parent; dir__; dir__ = dir__->m_parent)
+    size__ += names.name(dir__->m_name).size() + 1;
+
+  std::size_t offset__ = buffer.size();
+  buffer.resize(offset__ + size__);
+
+  char* end__ = buffer.data() + offset__ + size__;
+
+  for(const Node* curr__ = node; curr__; curr__ = curr__->m_parent)
+    {
+      std::string_view name__ = names.name(curr__->m_name);
+
+      end__ -= name__.size();
+      name__.copy(end__, name__.size());
+
+      if(curr__->m_parent)
+        *--end__ = '\\';
+    }
+}
+
+/**
+ * @brief Position of a name in the buffer of names of a view.
+ */
+struct Name_span
+{
+  std::uint32_t m_offset;
+  std::uint32_t m_size;
+};
+
+/**
+ * @brief A child of a directory waiting to be merged into its place in a listing.
+ */
+struct Pending_child
+{
+  Name_span m_name;
+  const Node* m_node;
+};
+
+Tree_view::Listing::~Listing()
+{
+  // Listings no other view refers to are taken out of their parents before they're released, so releasing a deep
+  // tree never nests destructors.
+  std::vector<std::shared_ptr<const Listing>> released__;
+
+  auto take__ = [&released__](std::vector<Entry>& entries) {
+    for(Entry& entry__ : entries)
+      if(entry__.m_listing && entry__.m_listing.use_count() == 1)
+        released__.push_back(std::move(entry__.m_listing));
+  };
+
+  take__(m_entries);
+
+  while(!released__.empty())
+    {
+      std::shared_ptr<const Listing> listing__ = std::move(released__.back());
+      released__.pop_back();
+
+      // The listing is owned by this destructor alone, nothing else reads it anymore.
+      take__(const_cast<Listing&>(*listing__).m_entries);
+    }
+}
+
+std::shared_ptr<const Tree_view>
+Tree_view::build(const Directory* drive, std::string_view current_path, const Name_table& names, std::uint64_t version,
+                 Listing_cache& cache)
+{
+  std::shared_ptr<Tree_view> view__{ new Tree_view() };
+  view__->m_version = version;
+  view__->m_root_name = names.name(drive->m_name);
+  view__->m_current_path = current_path;
+
+  auto is_listed__ = [&cache](const Directory* dir) {
+    return !cache.m_changed.contains(dir) && cache.m_listings.contains(dir);
+  };
+
+  // Directories are listed in post-order, a listing refers to listings of child directories. A copy-on-write copy
+  // shares the listing of the directory it shares children of. Only directories without an up-to-date listing are
+  // visited, so an unchanged subtree costs a single lookup.
+  std::vector<std::pair<const Directory*, bool>> stack__{ { drive, false } };
+
+  while(!stack__.empty())
+    {
+      auto [dir__, is_expanded__] = stack__.back();
+
+      if(is_listed__(dir__))
+        {
+          stack__.pop_back();
+          continue;
+        }
+
+      if(!is_expanded__)
+        {
+          stack__.back().second = true;
+
+          if(dir__->m_shared)
+            stack__.emplace_back(dir__->m_shared, false);
+          else
+            for(const Node* child__ : dir__->m_childs)
+              if(child__->m_type == NODE_TYPE::DIRECTORY && !is_listed__(static_cast<const Directory*>(child__)))
+                stack__.emplace_back(static_cast<const Directory*>(child__), false);
+
+          continue;
+        }
+
+      stack__.pop_back();
+
+      std::shared_ptr<const Listing> listing__
+          = dir__->m_shared ? cache.m_listings.at(dir__->m_shared) : m_list(dir__, names, cache);
+
+      cache.m_listings.insert_or_assign(dir__, std::move(listing__));
+      cache.m_changed.erase(dir__);
+    }
+
+  // Directories left marked aren't in the tree, e.g. removed ones kept for a rollback, they're listed again if they
+  // come back.
+  for(const Directory* dir__ : cache.m_changed)
+    cache.m_listings.erase(dir__);
+
+  cache.m_changed.clear();
+
+  view__->m_root = { NODE_TYPE::DIRECTORY, view__->m_root_name, cache.m_listings.at(drive) };
+  view__->m_current = view__->find(view__->m_current_path);
+
+  if(!view__->m_current)
+    view__->m_current = &view__->m_root;
+
+  return view__;
+}
+
+std::shared_ptr<const Tree_view::Listing>
+Tree_view::m_list(const Directory* dir, const Name_table& names, const Listing_cache& cache)
+{
+  std::shared_ptr<Listing> listing__ = std::make_shared<Listing>();
+  listing__->m_size = 0;
+
+  // Names are collected into one buffer first, entries refer to them once the buffer stops growing.
+  std::vector<Pending_child> named__;
+  std::vector<Pending_child> links__;
+  named__.reserve(dir->m_named);
+
+  auto append__ = [&listing__](std::vector<Pending_child>& childs, const Node* child, std::size_t offset) {
+    childs.push_back({ { static_cast<std::uint32_t>(offset),
+                         static_cast<std::uint32_t>(listing__->m_names.size() - offset) },
+                       child });
+  };
+
+  // Files and directories are kept in order by the directory, only links are sorted here.
+  for(std::size_t run__ = 0; run__ < dir->sorted_runs(); ++run__)
+    for(const Node* child__ : dir->sorted_run(run__))
+      {
+        std::size_t offset__ = listing__->m_names.size();
+        listing__->m_names += names.name(child__->m_name);
+        append__(named__, child__, offset__);
+      }
+
+  for(const Node* child__ : dir->m_childs)
+    {
+      if((child__->m_type != NODE_TYPE::HLINK && child__->m_type != NODE_TYPE::DLINK) || is_dangling(child__))
+        continue;
+
+      std::size_t offset__ = listing__->m_names.size();
+      listing__->m_names += child__->m_type == NODE_TYPE::HLINK ? HLINK_PREFIX : DLINK_PREFIX;
+      append_absolute_path(static_cast<const Link*>(child__)->m_target, names, listing__->m_names);
+      listing__->m_names += ']';
+      append__(links__, child__, offset__);
+    }
+
+  std::string_view buffer__ = listing__->m_names;
+
+  auto less__ = [buffer__](const Pending_child& lhs, const Pending_child& rhs) {
+    return buffer__.substr(lhs.m_name.m_offset, lhs.m_name.m_size)
+           < buffer__.substr(rhs.m_name.m_offset, rhs.m_name.m_size);
+  };
+
+  std::sort(links__.begin(), links__.end(), less__);
+
+  std::vector<Pending_child> childs__;
+  childs__.reserve(named__.size() + links__.size());
+  std::merge(named__.begin(), named__.end(), links__.begin(), links__.end(), std::back_inserter(childs__), less__);
+
+  listing__->m_entries.reserve(childs__.size());
+
+  for(const Pending_child& child__ : childs__)
+    {
+      std::shared_ptr<const Listing> childs_listing__;
+
+      if(child__.m_node->m_type == NODE_TYPE::DIRECTORY)
+        {
+          childs_listing__ = cache.m_listings.at(static_cast<const Directory*>(child__.m_node));
+          listing__->m_size += childs_listing__->m_size;
+        }
+
+      listing__->m_entries.push_back({ child__.m_node->m_type,
+                                       buffer__.substr(child__.m_name.m_offset, child__.m_name.m_size),
+                                       std::move(childs_listing__) });
+      ++listing__->m_size;
+    }
+
+  return listing__;
+}
+
+const Tree_view::Entry*
+Tree_view::find(std::string_view path) const
+{
+  const Entry* curr__ = m_current;
+  std::size_t pos__ = 0;
+
+  if(path.empty())
+    return curr__;
+
+  // Absolute paths start with the name of the drive.
+  if(path.starts_with(m_root.m_name))
+    {
+      std::size_t end__ = path.find('\\');
+
+      if(path.substr(0, end__) != m_root.m_name)
+        return nullptr;
+
+      if(end__ == std::string_view::npos)
+        return &m_root;
+
+      curr__ = &m_root;
+      pos__ = end__ + 1;
+    }
+
+  while(true)
+    {
+      std::size_t end__ = path.find_first_of("\\[", pos__);
+
+      // Name of a link contains a path of its own, so it's always the last segment.
+      if(end__ != std::string_view::npos && path[end__] == '[')
+        {
+          std::string_view name__ = path.substr(pos__);
+          std::string_view prefix__ = name__.starts_with(HLINK_PREFIX) ? HLINK_PREFIX
+                                      : name__.starts_with(DLINK_PREFIX) ? DLINK_PREFIX
+                                                                          : std::string_view{};
+          std::size_t right__ = name__.find_last_of(']');
+
+          if(prefix__.empty() || right__ == std::string_view::npos || right__ < prefix__.size())
+            return nullptr;
+
+          // Target may be given by a relative path, links are named by absolute paths of their targets.
+          std::string_view target_path__ = name__.substr(prefix__.size(), right__ - prefix__.size());
+          const Entry* target__ = find(target_path__);
+
+          if(!target__ || target__->m_type == NODE_TYPE::HLINK || target__->m_type == NODE_TYPE::DLINK)
+            return nullptr;
+
+          std::string link_name__{ prefix__ };
+
+          // A path that was found is canonical, a relative one only lacks the path of the current directory.
+          if(target_path__.substr(0, target_path__.find('\\')) != m_root.m_name)
+            {
+              link_name__ += m_current_path;
+
+              if(!target_path__.empty())
+                link_name__ += '\\';
+            }
+
+          link_name__ += target_path__;
+          link_name__ += ']';
+
+          return m_find_child(*curr__, link_name__);
+        }
+
+      const Entry* child__ = m_find_child(*curr__, path.substr(pos__, end__ - pos__));
+
+      if(!child__ || child__->m_type != NODE_TYPE::DIRECTORY || end__ == std::string_view::npos)
+        return child__;
+
+      curr__ = child__;
+      pos__ = end__ + 1;
+    }
+}
+
+void
+Tree_view::print(std::ostream& stream) const
+{
+  Tree_writer writer__{ stream };
+  // Entities are printed in pre-order, so the stack holds children of every directory in reverse order.
+  std::vector<std::pair<const Entry*, std::size_t>> stack__{ { &m_root, 0 } };
+
+  while(!stack__.empty())
+    {
+      auto [entry__, depth__] = stack__.back();
+      stack__.pop_back();
+
+      writer__.line(depth__, entry__->m_name);
+
+      std::span<const Entry> childs__ = childs(*entry__);
+
+      for(std::size_t i = childs__.size(); i != 0; --i)
+        stack__.emplace_back(&childs__[i - 1], depth__ + 1);
+    }
+
+  writer__.finish();
+}
+
+const Tree_view::Entry*
+Tree_view::m_find_child(const Entry& dir, std::string_view name) noexcept
+{
+  std::span<const Entry> childs__ = childs(dir);
+
+  auto it__ = std::lower_bound(childs__.begin(), childs__.end(), name,
+                               [](const Entry& entry, std::string_view name) { return entry.m_name < name; });
+
+  if(it__ == childs__.end() || it__->m_name != name)
+    return nullptr;
+
+  return &*it__;
+}
+
+void
+Listing_cache::touch(const Directory* dir)
+{
+  if(m_listings.empty())
+    return;
+
+  m_pending.assign(1, dir);
+
+  while(!m_pending.empty())
+    {
+      const Directory* curr__ = m_pending.back();
+      m_pending.pop_back();
+
+      // Ancestors of a marked directory are marked already, so the walk stops at the first one. A removed directory
+      // may outlive its parent, so the walk stops there too.
+      for(; curr__ && m_changed.insert(curr__).second; curr__ = curr__->m_removed ? nullptr : curr__->m_parent)
+        for(const Directory* sharer__ : curr__->m_sharers)
+          m_pending.push_back(sharer__);
+    }
+}
+
+void
+Listing_cache::touch_links(const Node* node)
+{
+  if(m_listings.empty())
+    return;
+
+  m_stack.assign(1, node);
+
+  while(!m_stack.empty())
+    {
+      const Node* curr__ = m_stack.back();
+      m_stack.pop_back();
+
+      if(curr__->m_type != NODE_TYPE::FILE && curr__->m_type != NODE_TYPE::DIRECTORY)
+        continue;
+
+      const Linked_node* linked__ = static_cast<const Linked_node*>(curr__);
+
+      for(const Link* link__ : linked__->hlinks())
+        touch(link__->m_parent);
+
+      for(const Link* link__ : linked__->dlinks())
+        touch(link__->m_parent);
+
+      // Children of a copy-on-write copy belong to another directory, their paths don't change.
+      if(curr__->m_type == NODE_TYPE::DIRECTORY)
+        for(const Node* child__ : static_cast<const Directory*>(curr__)->m_childs)
+          m_stack.push_back(child__);
+    }
+}
+
+void
+Listing_cache::forget(const Directory* dir) noexcept
+{
+  m_listings.erase(dir);
+  m_changed.erase(dir);
+}
+
+void
+Listing_cache::clear() noexcept
+{
+  m_listings.clear();
+  m_changed.clear();
+}
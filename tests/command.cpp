@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include "command.hpp"
+#include "script_reader.hpp"
+
+TEST(Command, Finds_commands_ignoring_case)
+{
+  for(const auto& info__ : COMMANDS)
+    if(info__.m_type != COMMAND_TYPE::UNKNOWN)
+      {
+        std::string lower__{ info__.m_name };
+
+        for(auto& c__ : lower__)
+          c__ = c__ - 'A' + 'a';
+
+        EXPECT_EQ(find_command(info__.m_name), info__.m_type);
+        EXPECT_EQ(find_command(lower__), info__.m_type);
+      }
+
+  EXPECT_EQ(find_command("Md"), COMMAND_TYPE::MAKE_DIR);
+  EXPECT_EQ(find_command(""), COMMAND_TYPE::UNKNOWN);
+  EXPECT_EQ(find_command("M"), COMMAND_TYPE::UNKNOWN);
+  EXPECT_EQ(find_command("MDX"), COMMAND_TYPE::UNKNOWN);
+  EXPECT_EQ(find_command("DELTREES"), COMMAND_TYPE::UNKNOWN);
+  EXPECT_EQ(find_command("DELTREE123"), COMMAND_TYPE::UNKNOWN);
+}
+
+TEST(Command, Parses_parameters_in_place)
+{
+  std::string_view line__ = "mhl C:\\Dir1\\file1.txt C:\\Dir2 extra";
+  Command command__ = parse_command(line__);
+
+  EXPECT_EQ(command__.m_type, COMMAND_TYPE::MAKE_HLINK);
+  EXPECT_EQ(command__.m_argc, 3);
+  EXPECT_EQ(command__.m_args[0], "C:\\Dir1\\file1.txt");
+  EXPECT_EQ(command__.m_args[1], "C:\\Dir2");
+  EXPECT_EQ(command__.m_args[0].data(), line__.data() + 4);
+
+  command__ = parse_command("MD");
+  EXPECT_EQ(command__.m_type, COMMAND_TYPE::MAKE_DIR);
+  EXPECT_EQ(command__.m_argc, 0);
+
+  // Every space separates parameters, so doubled spaces produce empty ones.
+  command__ = parse_command("CD  Dir1");
+  EXPECT_EQ(command__.m_type, COMMAND_TYPE::CHANGE_DIR);
+  EXPECT_EQ(command__.m_argc, 2);
+  EXPECT_EQ(command__.m_args[0], "");
+  EXPECT_EQ(command__.m_args[1], "Dir1");
+}
+
+TEST(Script_reader, Reads_lines_of_a_script)
+{
+  std::string path__ = testing::TempDir() + "script_reader_test.sh";
+
+  {
+    std::ofstream script__{ path__ };
+    script__ << "MD Dir1\n\nMF Dir1\\file1.txt\nCD Dir1";
+  }
+
+  Script_reader reader__{ path__.c_str() };
+  ASSERT_TRUE(reader__.is_open());
+
+  std::vector<std::string_view> lines__;
+  std::string_view line__;
+
+  while(reader__.next_line(line__))
+    lines__.push_back(line__);
+
+  EXPECT_EQ(lines__, (std::vector<std::string_view>{ "MD Dir1", "", "MF Dir1\\file1.txt", "CD Dir1" }));
+  EXPECT_FALSE(reader__.next_line(line__));
+
+  std::remove(path__.c_str());
+}
+
+TEST(Script_reader, Handles_empty_and_missing_scripts)
+{
+  std::string path__ = testing::TempDir() + "script_reader_empty.sh";
+  std::ofstream{ path__ };
+
+  {
+    Script_reader reader__{ path__.c_str() };
+    std::string_view line__;
+
+    EXPECT_TRUE(reader__.is_open());
+    EXPECT_FALSE(reader__.next_line(line__));
+  }
+
+  std::remove(path__.c_str());
+
+  Script_reader missing__{ path__.c_str() };
+  EXPECT_FALSE(missing__.is_open());
+}
+
+TEST(Script_reader, Recycles_blocks_of_a_piped_script)
+{
+  int pipe__[2];
+  ASSERT_EQ(::pipe(pipe__), 0);
+
+  // A script many blocks long is written to the pipe while it's read.
+  std::thread writer__{ [fd = pipe__[1]] {
+    std::string line__ = "MD C:\\Dir" + std::string(100, 'x') + "\n";
+
+    for(std::size_t i = 0; i < 100'000; ++i)
+      if(::write(fd, line__.data(), line__.size()) != static_cast<ssize_t>(line__.size()))
+        break;
+
+    ::close(fd);
+  } };
+
+  std::string path__ = "/dev/fd/" + std::to_string(pipe__[0]);
+  std::size_t lines__ = 0;
+  std::size_t max_bytes__ = 0;
+
+  {
+    Script_reader reader__{ path__.c_str() };
+    std::string_view line__;
+
+    while(reader__.next_line(line__))
+      {
+        EXPECT_EQ(line__.size(), 109u);
+        ++lines__;
+        reader__.release();
+        max_bytes__ = std::max(max_bytes__, reader__.buffered_bytes());
+      }
+  }
+
+  writer__.join();
+  ::close(pipe__[0]);
+
+  EXPECT_EQ(lines__, 100'000u);
+  EXPECT_LE(max_bytes__, 256u * 1024);
+}
+
+TEST(Script_reader, Read_errors_throw)
+{
+  // A directory is opened but can be neither mapped nor read.
+  Script_reader reader__{ testing::TempDir().c_str() };
+  std::string_view line__;
+
+  ASSERT_TRUE(reader__.is_open());
+  EXPECT_THROW(reader__.next_line(line__), std::runtime_error);
+}
+
+int
+main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
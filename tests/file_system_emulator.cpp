@@ -1,6 +1,24 @@
+#include <set>
+#include <string>
+
 #include <gtest/gtest.h>
 
 #include "file_system_emulator.hpp"
+#include "test_utils.hpp"
+
+/**
+ * @brief Checks that counters of two trees that should be the same are equal.
+ */
+static void
+expect_same_stats(const File_system_emulator::Stats& stats, const File_system_emulator::Stats& expected)
+{
+  EXPECT_EQ(stats.m_nodes, expected.m_nodes);
+  EXPECT_EQ(stats.m_node_bytes, expected.m_node_bytes);
+  EXPECT_EQ(stats.m_link_list_bytes, expected.m_link_list_bytes);
+  EXPECT_EQ(stats.m_max_depth, expected.m_max_depth);
+  EXPECT_EQ(stats.m_fanout, expected.m_fanout);
+  EXPECT_EQ(stats.m_dangling_links, expected.m_dangling_links);
+}
 
 TEST(File_system_emulator, Make_dir_no_throw_absolute_path)
 {
@@ -285,6 +303,99 @@ TEST(File_system_emulator, Remove_file_no_throw_relative_path)
   fse__.print();
 };
 
+TEST(File_system_emulator, Remove_link_detaches_it_from_target)
+{
+  File_system_emulator fse__;
+
+  fse__.make_dir("C:\\Dir1");
+  fse__.make_file("C:\\Dir1\\file1.txt");
+  fse__.make_hlink("C:\\Dir1\\file1.txt", "C:");
+  fse__.make_dlink("C:\\Dir1\\file1.txt", "C:");
+
+  EXPECT_THROW(fse__.make_dlink("C:\\hlink[C:\\Dir1\\file1.txt]", "C:\\Dir1"), std::runtime_error);
+  EXPECT_THROW(fse__.remove_file("C:\\Dir1\\file1.txt"), std::runtime_error);
+  EXPECT_NO_THROW(fse__.remove_file("C:\\hlink[C:\\Dir1\\file1.txt]"));
+  EXPECT_NO_THROW(fse__.remove_file("C:\\Dir1\\file1.txt"));
+
+  fse__.print();
+};
+
+TEST(File_system_emulator, Remove_file_removes_all_dynamic_links)
+{
+  File_system_emulator fse__;
+
+  fse__.make_file("C:\\file1.txt");
+
+  for(int i = 0; i < 100; ++i)
+    {
+      std::string dir__ = "C:\\Dir" + std::to_string(i);
+
+      fse__.make_dir(dir__);
+      fse__.make_file(dir__ + "\\file2.txt");
+      fse__.make_dlink("C:\\file1.txt", dir__);
+    }
+
+  EXPECT_NO_THROW(fse__.remove_file("C:\\file1.txt"));
+
+  for(int i = 0; i < 100; ++i)
+    {
+      std::string dir__ = "C:\\Dir" + std::to_string(i);
+
+      EXPECT_THROW(fse__.remove_file(dir__ + "\\dlink[C:\\file1.txt]"), std::runtime_error);
+      EXPECT_NO_THROW(fse__.remove_file(dir__ + "\\file2.txt"));
+      EXPECT_NO_THROW(fse__.remove_dir(dir__));
+    }
+
+  fse__.print();
+};
+
+TEST(File_system_emulator, Deferred_dlink_removal)
+{
+  File_system_emulator fse__;
+  fse__.set_deferred_dlink_removal(true);
+
+  fse__.make_dir("C:\\Dir1");
+  fse__.make_dir("C:\\Dir2");
+  fse__.make_file("C:\\Dir1\\file1.txt");
+  fse__.make_dlink("C:\\Dir1\\file1.txt", "C:\\Dir2");
+  fse__.make_dlink("C:\\Dir1\\file1.txt", "C:");
+  fse__.make_dlink("C:\\Dir1", "C:\\Dir2");
+
+  // Links of removed targets stay allocated, but they're no longer a part of the tree.
+  fse__.remove_file("C:\\Dir1\\file1.txt");
+
+  File_system_emulator::Stats stats__ = fse__.stats();
+
+  EXPECT_EQ(stats__.m_dangling_links, 2u);
+  EXPECT_EQ(stats__.m_nodes[static_cast<std::size_t>(NODE_TYPE::FILE)], 0u);
+  EXPECT_EQ(stats__.m_nodes[static_cast<std::size_t>(NODE_TYPE::DLINK)], 1u);
+
+  EXPECT_EQ(print_to_string(fse__), "\nC:\n"
+                                    "|_Dir1\n"
+                                    "|_Dir2\n"
+                                    "| |_dlink[C:\\Dir1]\n\n");
+
+  // A new target may take the place of the removed one, its links have nothing to do with the dangling ones.
+  fse__.make_file("C:\\Dir1\\file1.txt");
+  EXPECT_THROW(fse__.remove_file("C:\\dlink[C:\\Dir1\\file1.txt]"), std::runtime_error);
+  fse__.make_dlink("C:\\Dir1\\file1.txt", "C:");
+  fse__.remove_file("C:\\dlink[C:\\Dir1\\file1.txt]");
+
+  // Copies leave dangling links out, a directory with nothing but dangling links counts as empty.
+  fse__.copy("C:\\Dir2", "C:\\Dir1");
+  fse__.remove_file("C:\\Dir2\\dlink[C:\\Dir1]");
+  fse__.remove_dir("C:\\Dir2");
+
+  EXPECT_EQ(fse__.stats().m_dangling_links, 1u);
+
+  fse__.compact();
+  stats__ = fse__.stats();
+
+  EXPECT_EQ(stats__.m_dangling_links, 0u);
+  EXPECT_EQ(stats__.m_nodes[static_cast<std::size_t>(NODE_TYPE::DLINK)], 1u);
+  EXPECT_EQ(fse__.size(), 6u);
+};
+
 TEST(File_system_emulator, Copy_no_throw_absolute_path)
 {
   File_system_emulator fse__;
@@ -322,6 +433,44 @@ TEST(File_system_emulator, Copy_no_throw_relative_path)
   fse__.print();
 };
 
+TEST(File_system_emulator, Copy_throw_absolute_path)
+{
+  File_system_emulator fse__;
+
+  fse__.make_dir("C:\\Dir1");
+  fse__.make_dir("C:\\Dir1\\Dir2");
+  fse__.make_dir("C:\\BDir1");
+  fse__.make_file("C:\\BDir1\\Dir2");
+
+  EXPECT_THROW(fse__.copy("C:\\Dir3", "C:\\BDir1"), std::runtime_error);
+
+  fse__.print();
+};
+
+TEST(File_system_emulator, Copy_and_move_skip_existing_names)
+{
+  File_system_emulator fse__;
+  std::vector<Command> batch__;
+
+  for(std::string_view line__ : { "MD A", "MD A\\Dir1", "MD B", "MF B\\Dir1", "COPY A B", "COPY A B", "MD C" })
+    batch__.push_back(parse_command(line__));
+
+  EXPECT_NO_THROW(fse__.apply_batch(batch__));
+  EXPECT_NO_THROW(fse__.copy("C:\\A\\Dir1", "C:\\A"));
+  EXPECT_NO_THROW(fse__.copy("C:\\A\\Dir1", "C:\\B"));
+  EXPECT_NO_THROW(fse__.move("C:\\A\\Dir1", "C:\\B"));
+  EXPECT_NO_THROW(fse__.move("C:\\A", "C:\\B"));
+
+  EXPECT_EQ(print_to_string(fse__), "\nC:\n"
+                                    "|_A\n"
+                                    "| |_Dir1\n"
+                                    "|_B\n"
+                                    "| |_A\n"
+                                    "| | |_Dir1\n"
+                                    "| |_Dir1\n"
+                                    "|_C\n\n");
+};
+
 TEST(File_system_emulator, Move_no_throw_absolute_path)
 {
   File_system_emulator fse__;
@@ -340,6 +489,26 @@ TEST(File_system_emulator, Move_no_throw_absolute_path)
   fse__.print();
 };
 
+TEST(File_system_emulator, Move_renames_dynamic_links)
+{
+  File_system_emulator fse__;
+
+  fse__.make_dir("C:\\Dir1");
+  fse__.make_dir("C:\\Dir1\\Dir2");
+  fse__.make_file("C:\\Dir1\\Dir2\\file1.txt");
+  fse__.make_dir("C:\\BDir1");
+  fse__.make_dlink("C:\\Dir1\\Dir2\\file1.txt", "C:\\BDir1");
+
+  EXPECT_NO_THROW(fse__.move("C:\\Dir1\\Dir2", "C:\\BDir1"));
+  EXPECT_THROW(fse__.remove_file("C:\\BDir1\\dlink[C:\\Dir1\\Dir2\\file1.txt]"), std::runtime_error);
+
+  fse__.print();
+
+  EXPECT_NO_THROW(fse__.remove_file("C:\\BDir1\\dlink[C:\\BDir1\\Dir2\\file1.txt]"));
+
+  fse__.print();
+};
+
 TEST(File_system_emulator, Move_throw_absolute_path)
 {
   File_system_emulator fse__;
@@ -356,6 +525,47 @@ TEST(File_system_emulator, Move_throw_absolute_path)
   fse__.print();
 };
 
+TEST(File_system_emulator, Move_into_own_subtree_throws)
+{
+  File_system_emulator fse__;
+
+  fse__.make_dir("C:\\a");
+  fse__.make_dir("C:\\a\\b");
+  fse__.make_file("C:\\a\\b\\f.txt");
+
+  EXPECT_THROW(fse__.move("C:\\a", "C:\\a\\b"), std::runtime_error);
+  EXPECT_EQ(print_to_string(fse__), "\nC:\n|_a\n| |_b\n| | |_f.txt\n\n");
+
+  // Copies share the subtree they're made of until it's changed.
+  fse__.set_copy_on_write(true);
+  fse__.copy("C:\\a", "C:\\a\\b");
+  EXPECT_THROW(fse__.move("C:\\a", "C:\\a\\b\\a\\b"), std::runtime_error);
+  EXPECT_THROW(fse__.move("C:\\a\\b", "C:\\a\\b\\a\\b"), std::runtime_error);
+  EXPECT_NO_THROW(fse__.move("C:\\a\\b\\a\\b", "C:"));
+  EXPECT_EQ(print_to_string(fse__), "\nC:\n|_a\n| |_b\n| | |_a\n| | |_f.txt\n|_b\n| |_f.txt\n\n");
+};
+
+TEST(File_system_emulator, Move_follows_hard_link_counters)
+{
+  File_system_emulator fse__;
+
+  fse__.make_dir("C:\\Dir1");
+  fse__.make_dir("C:\\Dir1\\Dir2");
+  fse__.make_file("C:\\Dir1\\Dir2\\file1.txt");
+  fse__.make_dir("C:\\BDir1");
+  fse__.make_dir("C:\\BDir1\\CDir1");
+  fse__.make_hlink("C:\\Dir1\\Dir2\\file1.txt", "C:\\BDir1\\CDir1");
+  fse__.copy("C:\\BDir1\\CDir1", "C:");
+
+  EXPECT_THROW(fse__.move("C:\\Dir1", "C:\\BDir1"), std::runtime_error);
+  EXPECT_NO_THROW(fse__.remove_file("C:\\BDir1\\CDir1\\hlink[C:\\Dir1\\Dir2\\file1.txt]"));
+  EXPECT_THROW(fse__.move("C:\\Dir1", "C:\\BDir1"), std::runtime_error);
+  EXPECT_NO_THROW(fse__.remove_file("C:\\CDir1\\hlink[C:\\Dir1\\Dir2\\file1.txt]"));
+  EXPECT_NO_THROW(fse__.move("C:\\Dir1", "C:\\BDir1"));
+
+  fse__.print();
+};
+
 TEST(File_system_emulator, Delete_tree_no_throw_absolute_path)
 {
   File_system_emulator fse__;
@@ -389,6 +599,730 @@ TEST(File_system_emulator, Delete_tree_no_throw_relative_path)
   fse__.print();
 };
 
+TEST(File_system_emulator, Names_are_interned)
+{
+  File_system_emulator fse__;
+
+  fse__.make_dir("C:\\Dir1");
+  fse__.make_dir("C:\\Dir2");
+  fse__.make_file("C:\\Dir1\\readme.txt");
+  fse__.make_file("C:\\Dir2\\readme.txt");
+  fse__.copy("C:\\Dir1", "C:\\Dir2");
+
+  Name_table::Stats stats__ = fse__.names().stats();
+
+  // "", "C:", "Dir1", "Dir2" and "readme.txt".
+  EXPECT_EQ(stats__.m_names, 5);
+  EXPECT_EQ(stats__.m_bytes, 2 + 4 + 4 + 10);
+  EXPECT_EQ(stats__.m_reuses, 1);
+
+  fse__.print();
+};
+
+TEST(File_system_emulator, Find_by_pattern)
+{
+  File_system_emulator fse__;
+
+  fse__.make_dir("C:\\Dir1");
+  fse__.make_dir("C:\\Dir1\\Dir2");
+  fse__.make_file("C:\\Dir1\\file1.txt");
+  fse__.make_file("C:\\Dir1\\Dir2\\file2.txt");
+  fse__.make_file("C:\\Dir1\\Dir2\\file3.tmp");
+  fse__.make_dlink("C:\\Dir1\\file1.txt", "C:");
+
+  EXPECT_EQ(fse__.find("file1.txt"), (std::vector<std::string>{ "C:\\Dir1\\file1.txt" }));
+  EXPECT_EQ(fse__.find("*.txt"), (std::vector<std::string>{ "C:\\Dir1\\Dir2\\file2.txt", "C:\\Dir1\\file1.txt" }));
+  EXPECT_EQ(fse__.find("Dir*"), (std::vector<std::string>{ "C:\\Dir1", "C:\\Dir1\\Dir2" }));
+  EXPECT_EQ(fse__.find("*.tmp", "C:\\Dir1\\Dir2"), (std::vector<std::string>{ "C:\\Dir1\\Dir2\\file3.tmp" }));
+  EXPECT_TRUE(fse__.find("file1.txt", "C:\\Dir1\\Dir2").empty());
+  EXPECT_TRUE(fse__.find("dlink*").empty());
+  EXPECT_THROW(fse__.find("*", "C:\\Dir1\\file1.txt"), std::runtime_error);
+
+  // Entities of a copy-on-write copy are found through the copy as well, removed ones are gone from the index.
+  fse__.set_copy_on_write(true);
+  fse__.copy("C:\\Dir1\\Dir2", "C:");
+  fse__.remove_file("C:\\Dir1\\file1.txt");
+  fse__.move("C:\\Dir1\\Dir2\\file3.tmp", "C:");
+
+  EXPECT_EQ(fse__.find("*.txt"), (std::vector<std::string>{ "C:\\Dir1\\Dir2\\file2.txt", "C:\\Dir2\\file2.txt" }));
+  EXPECT_EQ(fse__.find("*.tmp"), (std::vector<std::string>{ "C:\\Dir2\\file3.tmp", "C:\\file3.tmp" }));
+  EXPECT_EQ(fse__.find("file2.txt", "C:\\Dir2"), (std::vector<std::string>{ "C:\\Dir2\\file2.txt" }));
+};
+
+TEST(File_system_emulator, Delete_tree_throw_absolute_path)
+{
+  File_system_emulator fse__;
+
+  fse__.make_dir("C:\\Dir1");
+  fse__.make_dir("C:\\Dir1\\Dir2");
+  fse__.make_dir("C:\\Dir1\\Dir3");
+  fse__.make_file("C:\\Dir1\\Dir2\\file1.txt");
+  fse__.make_file("C:\\Dir1\\Dir3\\file2.txt");
+  fse__.make_dir("C:\\BDir1");
+  fse__.make_hlink("C:\\Dir1\\Dir3\\file2.txt", "C:\\BDir1");
+  fse__.make_dlink("C:\\Dir1\\Dir2\\file1.txt", "C:\\BDir1");
+
+  // Nothing is deleted if any entity of the tree has an attached hard link.
+  EXPECT_THROW(fse__.delete_tree("C:\\Dir1"), std::runtime_error);
+  EXPECT_NO_THROW(fse__.remove_file("C:\\Dir1\\Dir2\\file1.txt"));
+  EXPECT_THROW(fse__.remove_file("C:\\Dir1\\Dir3\\file2.txt"), std::runtime_error);
+  EXPECT_NO_THROW(fse__.remove_file("C:\\BDir1\\hlink[C:\\Dir1\\Dir3\\file2.txt]"));
+
+  fse__.change_dir("C:\\Dir1\\Dir2");
+  EXPECT_THROW(fse__.delete_tree("C:\\Dir1"), std::runtime_error);
+
+  fse__.print();
+};
+
+TEST(File_system_emulator, Delete_tree_with_inner_hard_links)
+{
+  File_system_emulator fse__;
+
+  // Hard links placed inside the tree go away together with it.
+  fse__.make_dir("C:\\a");
+  fse__.make_hlink("C:\\a", "C:\\a");
+  EXPECT_NO_THROW(fse__.delete_tree("C:\\a"));
+
+  fse__.make_dir("C:\\a");
+  fse__.make_dir("C:\\a\\b");
+  fse__.make_hlink("C:\\a", "C:\\a\\b");
+
+  std::string output__ = print_to_string(fse__);
+  fse__.begin();
+  EXPECT_NO_THROW(fse__.delete_tree("C:\\a"));
+  fse__.rollback();
+  EXPECT_EQ(print_to_string(fse__), output__);
+
+  EXPECT_NO_THROW(fse__.delete_tree("C:\\a"));
+  EXPECT_EQ(print_to_string(fse__), "\nC:\n\n");
+  EXPECT_EQ(fse__.stats().m_nodes[static_cast<std::size_t>(NODE_TYPE::HLINK)], 0u);
+
+  // One hard link from outside is enough to keep the tree.
+  fse__.make_dir("C:\\a");
+  fse__.make_dir("C:\\a\\b");
+  fse__.make_file("C:\\a\\b\\file1.txt");
+  fse__.make_hlink("C:\\a\\b\\file1.txt", "C:\\a");
+  fse__.make_hlink("C:\\a\\b\\file1.txt", "C:");
+  EXPECT_THROW(fse__.delete_tree("C:\\a"), std::runtime_error);
+
+  fse__.remove_file("C:\\hlink[C:\\a\\b\\file1.txt]");
+  EXPECT_NO_THROW(fse__.delete_tree("C:\\a"));
+  EXPECT_EQ(print_to_string(fse__), "\nC:\n\n");
+};
+
+TEST(File_system_emulator, Path_cache_follows_moves_and_removals)
+{
+  File_system_emulator fse__;
+
+  fse__.make_dir("C:\\Dir1");
+  fse__.make_dir("C:\\Dir1\\Dir2");
+  fse__.make_dir("C:\\BDir1");
+
+  fse__.change_dir("C:\\Dir1\\Dir2");
+  fse__.change_dir("C:\\Dir1\\Dir2");
+  EXPECT_GE(fse__.path_cache().stats().m_hits, 1);
+
+  fse__.change_dir("C:");
+  fse__.move("C:\\Dir1\\Dir2", "C:\\BDir1");
+
+  EXPECT_THROW(fse__.change_dir("C:\\Dir1\\Dir2"), std::runtime_error);
+  EXPECT_NO_THROW(fse__.change_dir("C:\\BDir1\\Dir2"));
+
+  fse__.change_dir("C:\\BDir1");
+  EXPECT_NO_THROW(fse__.remove_dir("Dir2"));
+  EXPECT_THROW(fse__.change_dir("Dir2"), std::runtime_error);
+  EXPECT_THROW(fse__.change_dir("C:\\BDir1\\Dir2"), std::runtime_error);
+
+  fse__.print();
+};
+
+TEST(File_system_emulator, Apply_batch_matches_individual_calls)
+{
+  std::vector<Command> batch__;
+
+  for(std::string_view line__ : { "MD Dir1", "MD Dir1\\Dir2", "MD Dir1\\Dir2\\Dir3", "MF Dir1\\Dir2\\file1.txt",
+                                  "MF Dir1\\Dir2\\Dir3\\file2.txt", "CD Dir1", "MD Dir2\\Dir4", "MD Dir1",
+                                  "MHL Dir2\\file1.txt C:", "MOVE C:\\Dir1\\Dir2\\Dir3 C:", "MD Dir2\\Dir3",
+                                  "MF C:\\Dir3\\file3.txt", "UNKNOWN Dir5" })
+    batch__.push_back(parse_command(line__));
+
+  File_system_emulator batched__;
+  File_system_emulator individual__;
+
+  EXPECT_NO_THROW(batched__.apply_batch(batch__));
+
+  for(const auto& command__ : batch__)
+    individual__.apply_batch(std::span(&command__, 1));
+
+  EXPECT_EQ(print_to_string(batched__), print_to_string(individual__));
+
+  EXPECT_NO_THROW(batched__.change_dir("C:\\Dir1\\Dir2\\Dir4"));
+  EXPECT_NO_THROW(batched__.change_dir("C:\\Dir1\\Dir2\\Dir3"));
+  EXPECT_NO_THROW(batched__.change_dir("C:\\Dir3"));
+};
+
+TEST(File_system_emulator, Apply_batch_stops_on_error)
+{
+  File_system_emulator fse__;
+  std::vector<Command> batch__;
+
+  for(std::string_view line__ : { "MD C:\\Dir1", "MD C:\\Dir1\\Dir2", "RD C:\\Dir1\\Dir2", "MD C:\\Dir1\\Dir2\\Dir3",
+                                  "MD C:\\Dir1\\Dir4" })
+    batch__.push_back(parse_command(line__));
+
+  EXPECT_THROW(fse__.apply_batch(batch__), std::runtime_error);
+  EXPECT_NO_THROW(fse__.change_dir("C:\\Dir1"));
+  EXPECT_THROW(fse__.change_dir("C:\\Dir1\\Dir2"), std::runtime_error);
+  EXPECT_THROW(fse__.change_dir("C:\\Dir1\\Dir4"), std::runtime_error);
+
+  fse__.print();
+};
+
+TEST(File_system_emulator, Batches_reclaim_dangling_links_in_slices)
+{
+  File_system_emulator fse__;
+  fse__.set_deferred_dlink_removal(true);
+
+  std::vector<std::string> lines__{ "MD C:\\Dir1", "MF C:\\Dir1\\file1.txt" };
+
+  for(std::size_t i = 0; i < File_system_emulator::DLINK_SWEEP_SLICE * 2; ++i)
+    {
+      lines__.push_back("MD C:\\" + std::to_string(i));
+      lines__.push_back("MDL C:\\Dir1\\file1.txt C:\\" + std::to_string(i));
+    }
+
+  std::vector<Command> commands__;
+
+  for(const std::string& line__ : lines__)
+    commands__.push_back(parse_command(line__));
+
+  fse__.apply_batch(commands__);
+
+  // The removal itself doesn't touch the links, every command after it reclaims a slice of them.
+  fse__.remove_file("C:\\Dir1\\file1.txt");
+  EXPECT_EQ(fse__.stats().m_dangling_links, File_system_emulator::DLINK_SWEEP_SLICE * 2);
+
+  Command command__ = parse_command("MD C:\\Dir2");
+  fse__.apply_batch({ &command__, 1 });
+  EXPECT_EQ(fse__.stats().m_dangling_links, File_system_emulator::DLINK_SWEEP_SLICE);
+
+  command__ = parse_command("MD C:\\Dir3");
+  fse__.apply_batch({ &command__, 1 });
+  EXPECT_EQ(fse__.stats().m_dangling_links, 0u);
+  EXPECT_EQ(fse__.stats().m_nodes[static_cast<std::size_t>(NODE_TYPE::FILE)], 0u);
+  EXPECT_EQ(fse__.size(), File_system_emulator::DLINK_SWEEP_SLICE * 2 + 5);
+};
+
+TEST(File_system_emulator, Rollback_restores_the_tree)
+{
+  File_system_emulator fse__;
+
+  fse__.make_dir("C:\\Dir1");
+  fse__.make_dir("C:\\Dir1\\Dir2");
+  fse__.make_file("C:\\Dir1\\Dir2\\file1.txt");
+  fse__.make_file("C:\\file2.txt");
+  fse__.make_dlink("C:\\Dir1\\Dir2\\file1.txt", "C:");
+  fse__.make_dlink("C:\\Dir1", "C:");
+  fse__.make_hlink("C:\\file2.txt", "C:\\Dir1");
+  fse__.change_dir("C:\\Dir1");
+
+  std::string printed__ = print_to_string(fse__);
+  File_system_emulator::Stats stats__ = fse__.stats();
+
+  EXPECT_THROW(fse__.commit(), std::runtime_error);
+  EXPECT_THROW(fse__.rollback(), std::runtime_error);
+
+  fse__.begin();
+  EXPECT_TRUE(fse__.in_transaction());
+  EXPECT_THROW(fse__.begin(), std::runtime_error);
+
+  fse__.copy("C:\\Dir1", "C:\\Dir1\\Dir2");
+  fse__.remove_file("C:\\dlink[C:\\Dir1]");
+  fse__.remove_file("C:\\Dir1\\hlink[C:\\file2.txt]");
+  fse__.remove_file("C:\\Dir1\\Dir2\\Dir1\\hlink[C:\\file2.txt]");
+  fse__.move("C:\\file2.txt", "C:\\Dir1\\Dir2");
+  fse__.change_dir("C:");
+  fse__.delete_tree("C:\\Dir1");
+  fse__.make_dir("Dir1");
+  fse__.make_file("Dir1\\file3.txt");
+
+  // Entities removed by the transaction aren't counted, though they're still allocated.
+  EXPECT_EQ(fse__.stats().m_nodes[static_cast<std::size_t>(NODE_TYPE::FILE)], 1u);
+  EXPECT_EQ(fse__.stats().m_nodes[static_cast<std::size_t>(NODE_TYPE::DLINK)], 0u);
+
+  fse__.rollback();
+
+  EXPECT_FALSE(fse__.in_transaction());
+  EXPECT_EQ(print_to_string(fse__), printed__);
+  expect_same_stats(fse__.stats(), stats__);
+  EXPECT_EQ(fse__.find("*.txt"), (std::vector<std::string>{ "C:\\Dir1\\Dir2\\file1.txt", "C:\\file2.txt" }));
+
+  // Current directory is restored as well, and restored entities can be changed again.
+  fse__.make_file("file4.txt");
+  EXPECT_THROW(fse__.delete_tree("C:\\Dir1"), std::runtime_error);
+  fse__.remove_file("C:\\Dir1\\hlink[C:\\file2.txt]");
+  fse__.remove_file("C:\\file2.txt");
+
+  // Committed changes stay, and the entities they removed are released.
+  std::size_t size__ = fse__.size();
+
+  fse__.begin();
+  fse__.change_dir("C:");
+  fse__.delete_tree("C:\\Dir1");
+  EXPECT_EQ(fse__.size(), size__);
+  fse__.commit();
+
+  EXPECT_EQ(print_to_string(fse__), "\nC:\n\n");
+  EXPECT_EQ(fse__.size(), 2u);
+  EXPECT_THROW(fse__.rollback(), std::runtime_error);
+};
+
+TEST(File_system_emulator, Rollback_restores_shared_copies_and_dangling_links)
+{
+  File_system_emulator fse__;
+  fse__.set_copy_on_write(true);
+  fse__.set_deferred_dlink_removal(true);
+
+  fse__.make_dir("C:\\Dir1");
+  fse__.make_dir("C:\\Dir1\\Dir2");
+  fse__.make_dir("C:\\Dir1\\Dir2\\Dir3");
+  fse__.make_file("C:\\Dir1\\Dir2\\file1.txt");
+  fse__.make_dir("C:\\Dir4");
+  fse__.make_file("C:\\Dir4\\file2.txt");
+  fse__.copy("C:\\Dir1", "C:\\Dir4");
+  fse__.make_dlink("C:\\Dir4\\file2.txt", "C:");
+  fse__.remove_file("C:\\Dir4\\file2.txt");
+
+  std::string printed__ = print_to_string(fse__);
+  File_system_emulator::Stats stats__ = fse__.stats();
+
+  ASSERT_EQ(stats__.m_dangling_links, 1u);
+
+  // Changes of the copy give it private entities, the transaction takes them back along with the changes.
+  fse__.begin();
+  fse__.make_file("C:\\Dir4\\Dir1\\Dir2\\Dir3\\file3.txt");
+  fse__.delete_tree("C:\\Dir1\\Dir2");
+  fse__.copy("C:\\Dir4", "C:\\Dir1");
+  fse__.make_file("C:\\Dir4\\file2.txt");
+  fse__.make_dlink("C:\\Dir4\\file2.txt", "C:\\Dir1\\Dir4");
+  fse__.remove_file("C:\\Dir4\\file2.txt");
+  fse__.compact();
+
+  EXPECT_EQ(fse__.stats().m_dangling_links, 2u);
+
+  fse__.rollback();
+
+  EXPECT_EQ(print_to_string(fse__), printed__);
+  expect_same_stats(fse__.stats(), stats__);
+  EXPECT_EQ(fse__.find("file1.txt"),
+            (std::vector<std::string>{ "C:\\Dir1\\Dir2\\file1.txt", "C:\\Dir4\\Dir1\\Dir2\\file1.txt" }));
+
+  // Links left dangling before the transaction are reclaimed as usual.
+  fse__.compact();
+  EXPECT_EQ(fse__.stats().m_dangling_links, 0u);
+};
+
+TEST(File_system_emulator, Batches_open_and_close_transactions)
+{
+  File_system_emulator fse__;
+
+  std::vector<std::string> lines__{ "MD C:\\Dir1", "BEGIN",  "MD C:\\Dir1\\Dir2", "ROLLBACK", "BEGIN", "MF C:\\Dir1\\file1.txt",
+                                    "COMMIT",     "BEGIN", "DELTREE C:\\Dir1" };
+  std::vector<Command> commands__;
+
+  for(const std::string& line__ : lines__)
+    commands__.push_back(parse_command(line__));
+
+  fse__.apply_batch(commands__);
+
+  EXPECT_TRUE(fse__.in_transaction());
+
+  // A failed command leaves the transaction open, the caller decides what to do with it.
+  Command command__ = parse_command("CD C:\\Dir1");
+  EXPECT_THROW(fse__.apply_batch({ &command__, 1 }), std::runtime_error);
+
+  command__ = parse_command("ROLLBACK");
+  fse__.apply_batch({ &command__, 1 });
+
+  EXPECT_EQ(print_to_string(fse__), "\nC:\n"
+                                    "|_Dir1\n"
+                                    "| |_file1.txt\n\n");
+};
+
+TEST(File_system_emulator, Parallel_copy_matches_sequential_copy)
+{
+  auto copy_template__ = [](std::size_t threshold) {
+    File_system_emulator fse__;
+    fse__.set_parallel_copy(threshold, 4);
+
+    fse__.make_dir("C:\\Files");
+    fse__.make_file("C:\\Files\\shared.txt");
+    fse__.make_dir("C:\\Template");
+
+    for(std::size_t i = 0; i < 8; ++i)
+      {
+        std::string dir__ = "C:\\Template\\Dir" + std::to_string(i);
+        fse__.make_dir(dir__);
+
+        for(std::size_t j = 0; j < 8; ++j)
+          {
+            fse__.make_dir(dir__ + "\\Sub" + std::to_string(j));
+            fse__.make_file(dir__ + "\\Sub" + std::to_string(j) + "\\file.txt");
+          }
+
+        fse__.make_dlink(dir__ + "\\Sub0\\file.txt", dir__);
+      }
+
+    fse__.make_hlink("C:\\Files\\shared.txt", "C:\\Template\\Dir3\\Sub3");
+    fse__.make_dlink("C:\\Template\\Dir1", "C:\\Template\\Dir2");
+
+    fse__.make_dir("C:\\Copy");
+    fse__.copy("C:\\Template", "C:\\Copy");
+    fse__.copy("C:\\Template", "C:\\Template\\Dir5");
+
+    std::string output__ = print_to_string(fse__);
+
+    // Links of the copies are attached to their targets like the original ones.
+    fse__.remove_file("C:\\Template\\Dir3\\Sub3\\hlink[C:\\Files\\shared.txt]");
+    EXPECT_THROW(fse__.delete_tree("C:\\Files"), std::runtime_error);
+    fse__.delete_tree("C:\\Copy");
+    EXPECT_THROW(fse__.delete_tree("C:\\Files"), std::runtime_error);
+    fse__.delete_tree("C:\\Template\\Dir5\\Template");
+    EXPECT_NO_THROW(fse__.delete_tree("C:\\Files"));
+
+    return output__ + print_to_string(fse__);
+  };
+
+  EXPECT_EQ(copy_template__(1), copy_template__(0));
+};
+
+TEST(File_system_emulator, Copy_on_write_matches_plain_copy)
+{
+  auto edit_copies__ = [](bool copy_on_write, std::size_t& size) {
+    File_system_emulator fse__;
+    fse__.set_copy_on_write(copy_on_write);
+    std::string output__;
+
+    auto print__ = [&fse__, &output__]() { output__ += print_to_string(fse__); };
+
+    fse__.make_dir("C:\\Template");
+
+    for(std::size_t i = 0; i < 4; ++i)
+      {
+        std::string dir__ = "C:\\Template\\Dir" + std::to_string(i);
+        fse__.make_dir(dir__);
+        fse__.make_dir(dir__ + "\\Sub");
+        fse__.make_file(dir__ + "\\Sub\\file.txt");
+      }
+
+    fse__.make_dir("C:\\Linked");
+    fse__.make_file("C:\\Linked\\file.txt");
+    fse__.make_dlink("C:\\Template\\Dir0\\Sub\\file.txt", "C:\\Linked");
+
+    for(std::size_t i = 0; i < 3; ++i)
+      fse__.copy("C:\\Template", "C:\\Template\\Dir" + std::to_string(i));
+
+    fse__.copy("C:\\Linked", "C:\\Template\\Dir3");
+    print__();
+
+    // Changes on either side stay on that side.
+    fse__.make_file("C:\\Template\\Dir0\\Template\\Dir1\\Sub\\new.txt");
+    fse__.remove_file("C:\\Template\\Dir1\\Sub\\file.txt");
+    fse__.move("C:\\Template\\Dir2\\Template\\Dir3", "C:\\Template\\Dir2");
+    fse__.change_dir("C:\\Template\\Dir1\\Template\\Dir2");
+    fse__.make_dir("Own");
+    print__();
+
+    // Links can't be shared, the copy that gets one has private directories down to it.
+    fse__.make_hlink("C:\\Template\\Dir0\\Template\\Dir0\\Sub\\file.txt", "C:\\Template\\Dir1\\Template\\Dir0");
+    EXPECT_THROW(fse__.delete_tree("C:\\Template\\Dir0\\Template"), std::runtime_error);
+    fse__.copy("C:\\Template\\Dir0", "C:\\Linked");
+    print__();
+
+    fse__.change_dir("C:");
+    fse__.delete_tree("C:\\Template\\Dir1\\Template");
+    EXPECT_NO_THROW(fse__.delete_tree("C:\\Template\\Dir0\\Template"));
+    fse__.delete_tree("C:\\Template\\Dir2");
+    print__();
+
+    size = fse__.size();
+    return output__;
+  };
+
+  std::size_t shared_size__ = 0;
+  std::size_t plain_size__ = 0;
+
+  EXPECT_EQ(edit_copies__(true, shared_size__), edit_copies__(false, plain_size__));
+  EXPECT_LT(shared_size__, plain_size__);
+};
+
+TEST(File_system_emulator, Delete_tree_unshares_nested_copies)
+{
+  auto delete_copies__ = [](bool copy_on_write) {
+    File_system_emulator fse__;
+    fse__.set_copy_on_write(copy_on_write);
+
+    // Copies of the drive end up inside the deleted subtree and share directories that get private copies only
+    // while the subtree is being unshared.
+    fse__.make_dir("C:\\B");
+    fse__.make_dir("C:\\B\\B");
+    fse__.copy("C:", "C:\\B\\B");
+    fse__.make_dir("C:\\B\\A");
+    fse__.make_dir("C:\\A");
+    fse__.copy("C:\\B", "C:\\B\\A");
+    fse__.copy("C:", "C:\\A");
+    fse__.delete_tree("C:\\B");
+
+    return print_to_string(fse__);
+  };
+
+  EXPECT_EQ(delete_copies__(true), delete_copies__(false));
+};
+
+TEST(File_system_emulator, Deep_trees_dont_overflow_the_stack)
+{
+  File_system_emulator fse__;
+  fse__.make_dir("C:\\d");
+
+  // Copying the chain into its deepest directory doubles the depth.
+  std::string deepest__ = "C:\\d";
+  std::size_t depth__ = 1;
+
+  for(; depth__ < 1'000'000; depth__ *= 2)
+    {
+      fse__.copy("C:\\d", deepest__);
+      deepest__ += deepest__.substr(2);
+    }
+
+  fse__.make_file(deepest__ + "\\file.txt");
+  fse__.make_hlink(deepest__ + "\\file.txt", "C:");
+  EXPECT_THROW(fse__.delete_tree("C:\\d"), std::runtime_error);
+  fse__.remove_file("C:\\hlink[" + deepest__ + "\\file.txt]");
+
+  fse__.make_dir("C:\\Copy");
+  fse__.copy("C:\\d", "C:\\Copy");
+  EXPECT_NO_THROW(fse__.remove_file("C:\\Copy" + deepest__.substr(2) + "\\file.txt"));
+
+  // The root, the drive and C:\Copy are there besides the chains.
+  EXPECT_EQ(fse__.size(), 2 * depth__ + 4);
+
+  fse__.publish_view();
+  EXPECT_EQ(fse__.view()->size(), 2 * depth__ + 3);
+  EXPECT_NE(fse__.view()->find(deepest__ + "\\file.txt"), nullptr);
+
+  fse__.delete_tree("C:\\Copy\\d");
+  fse__.delete_tree("C:\\d");
+  EXPECT_EQ(fse__.size(), 3);
+};
+
+TEST(File_system_emulator, Print_keeps_children_in_order)
+{
+  File_system_emulator fse__;
+
+  fse__.make_dir("C:\\b");
+  fse__.make_file("C:\\c.txt");
+  fse__.make_dir("C:\\a");
+  fse__.make_file("C:\\a\\z.txt");
+  fse__.make_dir("C:\\a\\hlinks");
+  fse__.make_dir("C:\\x");
+  fse__.make_file("C:\\x\\t.txt");
+  fse__.make_dlink("C:\\x\\t.txt", "C:\\a");
+  fse__.make_dlink("C:\\c.txt", "C:\\a");
+  fse__.make_hlink("C:\\c.txt", "C:\\a");
+
+  // Names of links follow their targets, so the order of links changes with moves of the targets.
+  fse__.move("C:\\x", "C:\\b");
+
+  EXPECT_EQ(print_to_string(fse__), "\nC:\n"
+                                    "|_a\n"
+                                    "| |_dlink[C:\\b\\x\\t.txt]\n"
+                                    "| |_dlink[C:\\c.txt]\n"
+                                    "| |_hlink[C:\\c.txt]\n"
+                                    "| |_hlinks\n"
+                                    "| |_z.txt\n"
+                                    "|_b\n"
+                                    "| |_x\n"
+                                    "| | |_t.txt\n"
+                                    "|_c.txt\n\n");
+
+  fse__.remove_file("C:\\a\\dlink[C:\\b\\x\\t.txt]");
+  fse__.remove_dir("C:\\a\\hlinks");
+  fse__.make_file("C:\\a\\e.txt");
+
+  EXPECT_EQ(print_to_string(fse__), "\nC:\n"
+                                    "|_a\n"
+                                    "| |_dlink[C:\\c.txt]\n"
+                                    "| |_e.txt\n"
+                                    "| |_hlink[C:\\c.txt]\n"
+                                    "| |_z.txt\n"
+                                    "|_b\n"
+                                    "| |_x\n"
+                                    "| | |_t.txt\n"
+                                    "|_c.txt\n\n");
+};
+
+TEST(File_system_emulator, Print_keeps_large_directories_in_order)
+{
+  File_system_emulator fse__;
+  std::set<std::string> names__{ "dlink[C:\\t.txt]" };
+
+  fse__.make_file("C:\\t.txt");
+  fse__.make_dir("C:\\W");
+  fse__.make_dlink("C:\\t.txt", "C:\\W");
+
+  auto expect_order__ = [&fse__, &names__] {
+    std::string expected__ = "\nC:\n|_W\n";
+
+    for(const std::string& name__ : names__)
+      expected__ += "| |_" + name__ + "\n";
+
+    EXPECT_EQ(print_to_string(fse__), expected__ + "|_t.txt\n\n");
+  };
+
+  // Names come in scattered order, so chunks of the order are split, merged and dropped.
+  for(std::size_t i = 0; i < 3000; ++i)
+    {
+      std::string name__ = "f" + std::to_string(i * 7919 % 3000);
+
+      fse__.make_file("C:\\W\\" + name__);
+      names__.insert(name__);
+    }
+
+  expect_order__();
+
+  for(std::size_t i = 0; i < 2990; ++i)
+    {
+      std::string name__ = "f" + std::to_string(i * 4001 % 3000);
+
+      fse__.remove_file("C:\\W\\" + name__);
+      names__.erase(name__);
+
+      if(i == 1500)
+        expect_order__();
+    }
+
+  expect_order__();
+
+  fse__.make_file("C:\\W\\a");
+  names__.insert("a");
+  expect_order__();
+};
+
+TEST(File_system_emulator, Large_directories_find_children)
+{
+  File_system_emulator fse__;
+  fse__.set_path_cache_capacity(0);
+
+  // Enough children to get a directory past the linear scan and its hash table through a few rebuilds.
+  for(std::size_t i = 0; i < 200; ++i)
+    {
+      if(i % 2)
+        fse__.make_file("C:\\f" + std::to_string(i));
+      else
+        fse__.make_dir("C:\\d" + std::to_string(i));
+    }
+
+  EXPECT_NO_THROW(fse__.change_dir("C:\\d100"));
+  EXPECT_THROW(fse__.make_file("C:\\d0"), std::runtime_error);
+  EXPECT_THROW(fse__.make_dir("C:\\f1"), std::runtime_error);
+
+  // Removals shift entries of the table back, the directory goes back to the linear scan in the end.
+  for(std::size_t i = 0; i < 190; ++i)
+    {
+      if(i % 2)
+        fse__.remove_file("C:\\f" + std::to_string(i));
+      else if(i != 100)
+        fse__.remove_dir("C:\\d" + std::to_string(i));
+    }
+
+  EXPECT_THROW(fse__.remove_file("C:\\f101"), std::runtime_error);
+  EXPECT_NO_THROW(fse__.remove_file("C:\\f199"));
+  EXPECT_NO_THROW(fse__.change_dir("C:\\d190"));
+  EXPECT_THROW(fse__.change_dir("C:\\d188"), std::runtime_error);
+  EXPECT_NO_THROW(fse__.change_dir("C:\\d100"));
+  EXPECT_EQ(fse__.size(), 12u);
+};
+
+TEST(File_system_emulator, Stats_follow_changes)
+{
+  File_system_emulator fse__;
+  File_system_emulator::Stats stats__ = fse__.stats();
+
+  EXPECT_EQ(stats__.m_nodes[static_cast<std::size_t>(NODE_TYPE::DIRECTORY)], 1u);
+  EXPECT_EQ(stats__.m_max_depth, 0u);
+  EXPECT_EQ(stats__.m_fanout[0], 1u);
+
+  fse__.make_dir("C:\\Dir1");
+  fse__.make_dir("C:\\Dir1\\Dir2");
+  fse__.make_dir("C:\\Dir1\\Dir2\\Dir3");
+  fse__.make_file("C:\\Dir1\\Dir2\\Dir3\\file1.txt");
+  fse__.make_file("C:\\file2.txt");
+  fse__.make_hlink("C:\\file2.txt", "C:\\Dir1");
+  fse__.make_dlink("C:\\Dir1\\Dir2", "C:");
+
+  stats__ = fse__.stats();
+
+  EXPECT_EQ(stats__.m_nodes[static_cast<std::size_t>(NODE_TYPE::DIRECTORY)], 4u);
+  EXPECT_EQ(stats__.m_nodes[static_cast<std::size_t>(NODE_TYPE::FILE)], 2u);
+  EXPECT_EQ(stats__.m_nodes[static_cast<std::size_t>(NODE_TYPE::HLINK)], 1u);
+  EXPECT_EQ(stats__.m_nodes[static_cast<std::size_t>(NODE_TYPE::DLINK)], 1u);
+  EXPECT_EQ(stats__.m_max_depth, 4u);
+  // C: and Dir1 have 3 and 2 children, Dir2 and Dir3 have 1.
+  EXPECT_EQ(stats__.m_fanout[1], 2u);
+  EXPECT_EQ(stats__.m_fanout[2], 2u);
+  EXPECT_EQ(stats__.m_link_list_bytes, 2 * sizeof(Link_lists) + 2 * sizeof(Link*));
+  EXPECT_GT(stats__.m_node_bytes, 0u);
+  EXPECT_GT(stats__.m_name_bytes, 0u);
+
+  // A rejected move leaves every entity reachable and counted as before.
+  EXPECT_THROW(fse__.move("C:\\Dir1", "C:\\Dir1\\Dir2\\Dir3"), std::runtime_error);
+  expect_same_stats(fse__.stats(), stats__);
+
+  // A copy-on-write copy shares the subtree, but it's as deep as its source. The copy goes into the directory it
+  // shares, so it gets a private Dir3 to keep seeing the subtree as it was.
+  fse__.set_copy_on_write(true);
+  fse__.copy("C:\\Dir1\\Dir2", "C:\\Dir1\\Dir2\\Dir3");
+
+  stats__ = fse__.stats();
+
+  EXPECT_EQ(stats__.m_nodes[static_cast<std::size_t>(NODE_TYPE::DIRECTORY)], 6u);
+  EXPECT_EQ(stats__.m_max_depth, 6u);
+
+  // Removing the deepest entities lowers the tree, the links go away with their targets.
+  fse__.delete_tree("C:\\Dir1\\Dir2\\Dir3\\Dir2");
+  fse__.remove_file("C:\\Dir1\\Dir2\\Dir3\\file1.txt");
+  fse__.delete_tree("C:\\Dir1\\Dir2");
+
+  stats__ = fse__.stats();
+
+  EXPECT_EQ(stats__.m_nodes[static_cast<std::size_t>(NODE_TYPE::DIRECTORY)], 2u);
+  EXPECT_EQ(stats__.m_nodes[static_cast<std::size_t>(NODE_TYPE::FILE)], 1u);
+  EXPECT_EQ(stats__.m_nodes[static_cast<std::size_t>(NODE_TYPE::DLINK)], 0u);
+  EXPECT_EQ(stats__.m_max_depth, 2u);
+  EXPECT_EQ(stats__.m_fanout[1], 1u);
+  EXPECT_EQ(stats__.m_fanout[2], 1u);
+  EXPECT_EQ(stats__.m_link_list_bytes, sizeof(Link_lists) + sizeof(Link*));
+};
+
+TEST(File_system_emulator, Stats_count_shared_entities_once)
+{
+  File_system_emulator fse__;
+
+  fse__.make_dir("C:\\Dir1");
+  fse__.make_dir("C:\\Dir2");
+  fse__.make_file("C:\\Dir1\\file1.txt");
+  fse__.set_copy_on_write(true);
+  fse__.copy("C:\\Dir1", "C:\\Dir2");
+
+  // The copy of Dir1 has a directory of its own, but its file1.txt is the one of Dir1 until the copy is changed.
+  File_system_emulator::Stats stats__ = fse__.stats();
+  EXPECT_EQ(stats__.m_nodes[static_cast<std::size_t>(NODE_TYPE::DIRECTORY)], 4u);
+  EXPECT_EQ(stats__.m_nodes[static_cast<std::size_t>(NODE_TYPE::FILE)], 1u);
+
+  fse__.make_file("C:\\Dir2\\Dir1\\file2.txt");
+  EXPECT_EQ(fse__.stats().m_nodes[static_cast<std::size_t>(NODE_TYPE::FILE)], 3u);
+};
+
 int
 main(int argc, char** argv)
 {
@@ -0,0 +1,212 @@
+#include <csignal>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+#include <sys/resource.h>
+
+#include <gtest/gtest.h>
+
+#include "file_system_emulator.hpp"
+#include "test_utils.hpp"
+
+/**
+ * @brief Applies a few operations of every kind, some of them relative to the current directory.
+ */
+static void
+mutate(File_system_emulator& fse)
+{
+  fse.make_dir("C:\\Dir1");
+  fse.make_dir("C:\\Dir1\\Dir2");
+  fse.make_file("C:\\Dir1\\Dir2\\file1.txt");
+  fse.change_dir("C:\\Dir1");
+  fse.make_dir("Dir3");
+  fse.make_file("Dir3\\file2.txt");
+  fse.make_dlink("Dir3\\file2.txt", "C:");
+  fse.make_hlink("Dir2\\file1.txt", "Dir3");
+  fse.copy("C:\\Dir1\\Dir2", "C:");
+  fse.move("C:\\Dir2", "C:\\Dir1\\Dir3");
+  fse.make_dir("C:\\Dir4");
+  fse.make_file("C:\\Dir4\\file3.txt");
+  fse.delete_tree("C:\\Dir4");
+  fse.remove_file("C:\\dlink[C:\\Dir1\\Dir3\\file2.txt]");
+}
+
+TEST(Journal, Recover_replays_all_operations)
+{
+  std::string path__ = testing::TempDir() + "journal_replay.log";
+  std::remove(path__.c_str());
+
+  File_system_emulator fse__;
+  fse__.open_journal(path__, 4);
+  mutate(fse__);
+
+  // A failed operation isn't journaled.
+  EXPECT_THROW(fse__.remove_dir("C:\\Dir5"), std::runtime_error);
+  fse__.close_journal();
+
+  File_system_emulator recovered__;
+  ASSERT_NO_THROW(recovered__.recover("", path__));
+
+  EXPECT_EQ(print_to_string(recovered__), print_to_string(fse__));
+  EXPECT_NO_THROW(recovered__.make_file("file4.txt"));
+  EXPECT_NO_THROW(recovered__.remove_file("C:\\Dir1\\file4.txt"));
+
+  std::remove(path__.c_str());
+}
+
+TEST(Journal, Recover_replays_transactions)
+{
+  std::string path__ = testing::TempDir() + "journal_transactions.log";
+  std::remove(path__.c_str());
+
+  File_system_emulator fse__;
+  fse__.open_journal(path__, 4);
+  fse__.begin();
+  mutate(fse__);
+  fse__.rollback();
+  fse__.begin();
+  fse__.make_dir("C:\\Dir1");
+  fse__.commit();
+  fse__.begin();
+  fse__.make_dir("C:\\Dir2");
+  fse__.close_journal();
+
+  // A transaction the journal ends in stays open after the recovery.
+  File_system_emulator recovered__;
+  ASSERT_NO_THROW(recovered__.recover("", path__));
+
+  EXPECT_EQ(print_to_string(recovered__), print_to_string(fse__));
+  EXPECT_TRUE(recovered__.in_transaction());
+
+  recovered__.rollback();
+  fse__.rollback();
+
+  EXPECT_EQ(print_to_string(recovered__), print_to_string(fse__));
+
+  recovered__.begin();
+  EXPECT_THROW(recovered__.recover("", path__), std::runtime_error);
+
+  // The journal would get a COMMIT without its BEGIN.
+  EXPECT_THROW(recovered__.open_journal(path__), std::runtime_error);
+  recovered__.commit();
+  EXPECT_NO_THROW(recovered__.open_journal(path__));
+  recovered__.close_journal();
+
+  std::remove(path__.c_str());
+}
+
+TEST(Journal, Recover_skips_records_of_the_checkpoint)
+{
+  std::string path__ = testing::TempDir() + "journal_checkpoint.log";
+  std::string snapshot_path__ = testing::TempDir() + "journal_checkpoint.fse";
+  std::string stale_path__ = testing::TempDir() + "journal_checkpoint_stale.log";
+  std::remove(path__.c_str());
+
+  File_system_emulator fse__;
+  fse__.open_journal(path__);
+  mutate(fse__);
+  fse__.commit_journal();
+
+  std::filesystem::copy_file(path__, stale_path__, std::filesystem::copy_options::overwrite_existing);
+  fse__.checkpoint(snapshot_path__);
+  std::string checkpoint_output__ = print_to_string(fse__);
+
+  fse__.make_dir("C:\\Dir5");
+  fse__.change_dir("C:\\Dir5");
+  fse__.close_journal();
+
+  File_system_emulator recovered__;
+  ASSERT_NO_THROW(recovered__.recover(snapshot_path__, path__));
+  EXPECT_EQ(print_to_string(recovered__), print_to_string(fse__));
+  EXPECT_NO_THROW(recovered__.make_dir("Dir6"));
+  EXPECT_NO_THROW(recovered__.change_dir("C:\\Dir5\\Dir6"));
+
+  // Crash after the snapshot is saved but before the journal is emptied, its records are in the snapshot already.
+  File_system_emulator crashed__;
+  ASSERT_NO_THROW(crashed__.recover(snapshot_path__, stale_path__));
+  EXPECT_EQ(print_to_string(crashed__), checkpoint_output__);
+
+  // Journaling goes on where the recovered journal ends.
+  EXPECT_THROW(crashed__.open_journal(path__), std::runtime_error);
+  EXPECT_NO_THROW(recovered__.open_journal(path__));
+
+  std::remove(path__.c_str());
+  std::remove(snapshot_path__.c_str());
+  std::remove(stale_path__.c_str());
+}
+
+TEST(Journal, Torn_record_ends_the_journal)
+{
+  std::string path__ = testing::TempDir() + "journal_torn.log";
+  std::remove(path__.c_str());
+
+  File_system_emulator fse__;
+  fse__.open_journal(path__, 1);
+  fse__.make_dir("C:\\Dir1");
+  fse__.make_dir("C:\\Dir1\\Dir2");
+  fse__.close_journal();
+
+  std::filesystem::resize_file(path__, std::filesystem::file_size(path__) - 1);
+
+  File_system_emulator recovered__;
+  ASSERT_NO_THROW(recovered__.recover("", path__));
+  EXPECT_NO_THROW(recovered__.change_dir("C:\\Dir1"));
+  EXPECT_THROW(recovered__.change_dir("C:\\Dir1\\Dir2"), std::runtime_error);
+
+  // The torn record is cut off once the journal is opened again.
+  recovered__.open_journal(path__);
+  recovered__.make_dir("C:\\Dir3");
+  recovered__.close_journal();
+
+  File_system_emulator reopened__;
+  ASSERT_NO_THROW(reopened__.recover("", path__));
+  EXPECT_EQ(print_to_string(reopened__), print_to_string(recovered__));
+
+  std::remove(path__.c_str());
+}
+
+TEST(Journal, Failed_commit_is_written_once_on_retry)
+{
+  std::string path__ = testing::TempDir() + "journal_retry.log";
+  std::remove(path__.c_str());
+
+  File_system_emulator fse__;
+  fse__.open_journal(path__, 1024);
+  fse__.make_dir("C:\\Dir1");
+  fse__.commit_journal();
+  fse__.make_dir("C:\\Dir1\\Dir2");
+  fse__.copy("C:\\Dir1", "C:");
+
+  // The file size limit lets the next commit write a part of its group only.
+  rlimit limit__;
+  ASSERT_EQ(::getrlimit(RLIMIT_FSIZE, &limit__), 0);
+
+  rlimit small_limit__ = limit__;
+  small_limit__.rlim_cur = std::filesystem::file_size(path__) + sizeof(Journal_record) + 4;
+
+  auto handler__ = std::signal(SIGXFSZ, SIG_IGN);
+  ASSERT_EQ(::setrlimit(RLIMIT_FSIZE, &small_limit__), 0);
+  EXPECT_THROW(fse__.commit_journal(), std::runtime_error);
+  ASSERT_EQ(::setrlimit(RLIMIT_FSIZE, &limit__), 0);
+  std::signal(SIGXFSZ, handler__);
+
+  EXPECT_NO_THROW(fse__.commit_journal());
+  fse__.close_journal();
+
+  // The torn group is gone and the retried one is replayed once, a second COPY would change the tree.
+  File_system_emulator recovered__;
+  ASSERT_NO_THROW(recovered__.recover("", path__));
+  EXPECT_EQ(print_to_string(recovered__), print_to_string(fse__));
+
+  EXPECT_NO_THROW(recovered__.open_journal(path__));
+
+  std::remove(path__.c_str());
+}
+
+int
+main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "name_index.hpp"
+
+TEST(Name_index, Removes_nodes_beyond_the_linear_limit)
+{
+  Name_table names__;
+  Name_index index__{ names__ };
+  std::vector<File> files__(Name_index::LINEAR_SEARCH_LIMIT * 4);
+
+  for(File& file__ : files__)
+    {
+      file__.m_name = names__.intern("file1.txt");
+      index__.insert(&file__);
+    }
+
+  Name_id name__ = names__.find("file1.txt");
+  EXPECT_EQ(index__.nodes(name__).size(), files__.size());
+  EXPECT_GT(index__.bytes(), files__.size() * sizeof(Node*));
+
+  // Every other node goes away, the rest is still found once each.
+  for(std::size_t i = 0; i < files__.size(); i += 2)
+    index__.erase(&files__[i]);
+
+  std::vector<Node*> left__(index__.nodes(name__).begin(), index__.nodes(name__).end());
+  std::sort(left__.begin(), left__.end());
+
+  ASSERT_EQ(left__.size(), files__.size() / 2);
+
+  for(std::size_t i = 1; i < files__.size(); i += 2)
+    EXPECT_TRUE(std::binary_search(left__.begin(), left__.end(), &files__[i]));
+
+  for(std::size_t i = 1; i < files__.size(); i += 2)
+    index__.erase(&files__[i]);
+
+  EXPECT_TRUE(index__.nodes(name__).empty());
+  EXPECT_EQ(index__.size(), 0);
+};
+
+TEST(Name_index, Groups_names_by_extension)
+{
+  Name_table names__;
+  Name_index index__{ names__ };
+  File first__, second__, third__;
+
+  first__.m_name = names__.intern("file1.txt");
+  second__.m_name = names__.intern("file2.tmp");
+  third__.m_name = names__.intern("Dir1");
+  index__.insert(&first__);
+  index__.insert(&second__);
+  index__.insert(&third__);
+
+  ASSERT_EQ(index__.with_extension("txt").size(), 1);
+  EXPECT_EQ(index__.with_extension("txt")[0], first__.m_name);
+  // The empty name of the root is known to the index as well, it has no extension either.
+  std::span<const Name_id> plain__ = index__.with_extension("");
+  EXPECT_NE(std::find(plain__.begin(), plain__.end(), third__.m_name), plain__.end());
+  EXPECT_EQ(std::find(plain__.begin(), plain__.end(), second__.m_name), plain__.end());
+  EXPECT_TRUE(index__.with_extension("doc").empty());
+  EXPECT_TRUE(index__.nodes(Name_table::npos).empty());
+};
+
+TEST(Name_index, Matches_wildcards)
+{
+  EXPECT_TRUE(Name_index::matches("*", ""));
+  EXPECT_TRUE(Name_index::matches("*.txt", "file1.txt"));
+  EXPECT_TRUE(Name_index::matches("file?.*", "file1.txt"));
+  EXPECT_TRUE(Name_index::matches("*i*e*", "file1.txt"));
+  EXPECT_TRUE(Name_index::matches("Dir1", "Dir1"));
+  EXPECT_FALSE(Name_index::matches("*.txt", "file1.tmp"));
+  EXPECT_FALSE(Name_index::matches("file?", "file12"));
+  EXPECT_FALSE(Name_index::matches("Dir1", "Dir"));
+  EXPECT_FALSE(Name_index::matches("?", ""));
+};
+
+int
+main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
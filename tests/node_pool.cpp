@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "node_pool.hpp"
+
+TEST(Node_pool, Reuses_released_slots)
+{
+  Node_pool<std::string> pool__;
+
+  std::string* first__ = pool__.create("first");
+  std::string* second__ = pool__.create("second");
+
+  EXPECT_EQ(pool__.size(), 2);
+
+  pool__.destroy(first__);
+  EXPECT_EQ(pool__.size(), 1);
+
+  std::string* third__ = pool__.create("third");
+  EXPECT_EQ(third__, first__);
+  EXPECT_EQ(*second__, "second");
+  EXPECT_EQ(*third__, "third");
+};
+
+TEST(Node_pool, Clear_destroys_live_objects)
+{
+  Node_pool<std::vector<int>> pool__;
+  std::vector<std::vector<int>*> objects__;
+
+  for(int i = 0; i < 1000; ++i)
+    objects__.push_back(pool__.create(100, i));
+
+  for(std::size_t i = 0; i < objects__.size(); i += 3)
+    pool__.destroy(objects__[i]);
+
+  EXPECT_GE(pool__.capacity(), 1000);
+
+  pool__.clear();
+
+  EXPECT_EQ(pool__.size(), 0);
+  EXPECT_EQ(pool__.capacity(), 0);
+};
+
+TEST(Node_pool, Merge_takes_over_objects)
+{
+  Node_pool<std::vector<int>> pool__;
+  Node_pool<std::vector<int>> other__;
+
+  std::vector<int>* own__ = pool__.create(10, 1);
+  std::vector<std::vector<int>*> objects__;
+
+  for(int i = 0; i < 100; ++i)
+    objects__.push_back(other__.create(10, i));
+
+  other__.destroy(objects__[50]);
+  std::size_t capacity__ = pool__.capacity() + other__.capacity();
+
+  pool__.merge(other__);
+
+  EXPECT_EQ(pool__.size(), 100);
+  EXPECT_EQ(pool__.capacity(), capacity__);
+  EXPECT_EQ(other__.size(), 0);
+  EXPECT_EQ(other__.capacity(), 0);
+  EXPECT_EQ((*own__)[0], 1);
+  EXPECT_EQ((*objects__[99])[0], 99);
+
+  // Merged objects are destroyed through the pool, unused slots of the other pool are reused.
+  pool__.destroy(objects__[0]);
+
+  for(std::size_t i = 0; i < capacity__ - 99; ++i)
+    pool__.create(1, 0);
+
+  EXPECT_EQ(pool__.capacity(), capacity__);
+
+  pool__.clear();
+  EXPECT_EQ(pool__.size(), 0);
+};
+
+int
+main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,278 @@
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "file_system_emulator.hpp"
+#include "test_utils.hpp"
+
+/**
+ * @brief Applies the same operations to an emulator with the default storage and to one with the compact storage,
+ * checking after every operation that both fail the same way and print the same tree.
+ */
+static void
+expect_same_trees(const std::vector<std::function<void(File_system_emulator&)>>& operations)
+{
+  File_system_emulator default__;
+  File_system_emulator compact__;
+  compact__.set_compact_storage(true);
+
+  for(std::size_t i = 0; i < operations.size(); ++i)
+    {
+      std::string default_error__;
+      std::string compact_error__;
+
+      try
+        {
+          operations[i](default__);
+        }
+      catch(const std::runtime_error& error__)
+        {
+          default_error__ = error__.what();
+        }
+
+      try
+        {
+          operations[i](compact__);
+        }
+      catch(const std::runtime_error& error__)
+        {
+          compact_error__ = error__.what();
+        }
+
+      EXPECT_EQ(compact_error__, default_error__) << "operation " << i;
+      EXPECT_EQ(print_to_string(compact__), print_to_string(default__)) << "operation " << i;
+    }
+
+  EXPECT_EQ(compact__.find("f1*"), default__.find("f1*"));
+  EXPECT_EQ(compact__.find("*.txt"), default__.find("*.txt"));
+  EXPECT_EQ(compact__.find("Dir?", "C:"), default__.find("Dir?", "C:"));
+  EXPECT_EQ(compact__.stats().m_nodes, default__.stats().m_nodes);
+  EXPECT_EQ(compact__.stats().m_max_depth, default__.stats().m_max_depth);
+  EXPECT_EQ(compact__.stats().m_fanout, default__.stats().m_fanout);
+}
+
+TEST(Node_table, Matches_the_default_storage)
+{
+  expect_same_trees({
+      [](File_system_emulator& fse) { fse.make_dir("C:\\Dir1"); },
+      [](File_system_emulator& fse) { fse.make_dir("C:\\Dir1\\Dir2"); },
+      [](File_system_emulator& fse) { fse.make_dir("C:\\Dir1\\Dir2\\Dir3"); },
+      [](File_system_emulator& fse) { fse.make_file("C:\\Dir1\\Dir2\\Dir3\\file1.txt"); },
+      [](File_system_emulator& fse) { fse.make_file("C:\\Dir1\\Dir2\\Dir3"); },
+      [](File_system_emulator& fse) { fse.make_dir("C:\\Dir1\\Dir2\\Dir3\\file1.txt"); },
+      [](File_system_emulator& fse) { fse.make_dir("C:\\Dir4\\Dir5"); },
+      [](File_system_emulator& fse) { fse.make_hlink("C:\\Dir1\\Dir2\\Dir3\\file1.txt", "C:\\Dir1"); },
+      [](File_system_emulator& fse) { fse.make_dlink("C:\\Dir1\\Dir2", "C:"); },
+      [](File_system_emulator& fse) { fse.make_dlink("C:\\dlink[C:\\Dir1\\Dir2]", "C:\\Dir1"); },
+      [](File_system_emulator& fse) { fse.change_dir("C:\\Dir1\\Dir2"); },
+      [](File_system_emulator& fse) { fse.make_file("Dir3\\file2.txt"); },
+      [](File_system_emulator& fse) { fse.copy("Dir3", "C:"); },
+      [](File_system_emulator& fse) { fse.copy("Dir3", "C:"); },
+      [](File_system_emulator& fse) { fse.move("C:\\Dir3", "Dir3"); },
+      [](File_system_emulator& fse) { fse.move("Dir3", "C:"); },
+      [](File_system_emulator& fse) { fse.remove_dir("C:\\Dir1\\Dir2"); },
+      [](File_system_emulator& fse) { fse.delete_tree("C:\\Dir1"); },
+      [](File_system_emulator& fse) { fse.change_dir("C:"); },
+      [](File_system_emulator& fse) { fse.delete_tree("C:\\Dir1"); },
+      [](File_system_emulator& fse) { fse.remove_file("C:\\Dir1\\hlink[C:\\Dir1\\Dir2\\Dir3\\file1.txt]"); },
+      [](File_system_emulator& fse) { fse.delete_tree("C:\\Dir1"); },
+      [](File_system_emulator& fse) { fse.remove_dir("C:\\Dir3\\Dir3"); },
+      [](File_system_emulator& fse) { fse.remove_file("C:\\Dir3\\file1.txt"); },
+      [](File_system_emulator& fse) { fse.remove_dir("C:"); },
+  });
+}
+
+TEST(Node_table, Large_directories_find_their_children)
+{
+  std::vector<std::function<void(File_system_emulator&)>> operations__{
+    [](File_system_emulator& fse) { fse.make_dir("C:\\Dir1"); },
+  };
+
+  // Directories outgrow the linear search, shrink back below it and grow again.
+  for(std::size_t i = 0; i < 40; ++i)
+    operations__.push_back([i](File_system_emulator& fse) { fse.make_file("C:\\Dir1\\f" + std::to_string(i) + ".txt"); });
+
+  operations__.push_back([](File_system_emulator& fse) { fse.make_dlink("C:\\Dir1\\f7.txt", "C:\\Dir1"); });
+  operations__.push_back([](File_system_emulator& fse) { fse.copy("C:\\Dir1", "C:\\Dir1"); });
+
+  for(std::size_t i = 0; i < 40; i += 2)
+    operations__.push_back([i](File_system_emulator& fse) { fse.remove_file("C:\\Dir1\\f" + std::to_string(i) + ".txt"); });
+
+  for(std::size_t i = 0; i < 40; ++i)
+    operations__.push_back([i](File_system_emulator& fse) { fse.make_dir("C:\\Dir1\\f" + std::to_string(i) + ".txt"); });
+
+  operations__.push_back([](File_system_emulator& fse) { fse.delete_tree("C:\\Dir1\\Dir1"); });
+
+  expect_same_trees(operations__);
+}
+
+TEST(Node_table, Move_into_own_subtree_throws)
+{
+  expect_same_trees({
+      [](File_system_emulator& fse) { fse.make_dir("C:\\a"); },
+      [](File_system_emulator& fse) { fse.make_dir("C:\\a\\b"); },
+      [](File_system_emulator& fse) { fse.make_file("C:\\a\\b\\f.txt"); },
+      [](File_system_emulator& fse) { fse.move("C:\\a", "C:\\a\\b"); },
+      [](File_system_emulator& fse) { fse.move("C:\\a", "C:\\a"); },
+      [](File_system_emulator& fse) { fse.move("C:\\a\\b", "C:\\a"); },
+      [](File_system_emulator& fse) { fse.move("C:", "C:\\a\\b"); },
+      [](File_system_emulator& fse) { fse.move("C:\\a\\b", "C:"); },
+  });
+}
+
+TEST(Node_table, Delete_tree_detaches_links_across_its_border)
+{
+  File_system_emulator fse__;
+  fse__.set_compact_storage(true);
+
+  fse__.make_dir("C:\\Dir1");
+  fse__.make_dir("C:\\Dir2");
+  fse__.make_file("C:\\Dir1\\file1.txt");
+  fse__.make_file("C:\\Dir2\\file2.txt");
+  fse__.make_dlink("C:\\Dir1\\file1.txt", "C:\\Dir2");
+  fse__.make_dlink("C:\\Dir1", "C:\\Dir2");
+  fse__.make_dlink("C:\\Dir1\\file1.txt", "C:\\Dir1");
+  fse__.make_hlink("C:\\Dir2\\file2.txt", "C:\\Dir1");
+  fse__.make_dlink("C:\\Dir2\\file2.txt", "C:\\Dir1");
+
+  // Hard links placed in the subtree don't hold it, those attached to it do.
+  EXPECT_THROW(fse__.remove_file("C:\\Dir2\\file2.txt"), std::runtime_error);
+  ASSERT_NO_THROW(fse__.delete_tree("C:\\Dir1"));
+  EXPECT_EQ(print_to_string(fse__), "\nC:\n|_Dir2\n| |_file2.txt\n\n");
+
+  // The file lost its links to the subtree, so nothing holds it anymore.
+  EXPECT_NO_THROW(fse__.remove_file("C:\\Dir2\\file2.txt"));
+  EXPECT_EQ(fse__.size(), 2u);
+
+  fse__.make_dir("C:\\Dir2\\Dir3");
+  fse__.make_hlink("C:\\Dir2\\Dir3", "C:");
+  EXPECT_THROW(fse__.delete_tree("C:\\Dir2"), std::runtime_error);
+  EXPECT_THROW(fse__.move("C:\\Dir2", "C:\\Dir2\\Dir3"), std::runtime_error);
+}
+
+TEST(Node_table, Delete_tree_with_inner_hard_links)
+{
+  expect_same_trees({
+      [](File_system_emulator& fse) { fse.make_dir("C:\\a"); },
+      [](File_system_emulator& fse) { fse.make_hlink("C:\\a", "C:\\a"); },
+      [](File_system_emulator& fse) { fse.delete_tree("C:\\a"); },
+      [](File_system_emulator& fse) { fse.make_dir("C:\\a"); },
+      [](File_system_emulator& fse) { fse.make_dir("C:\\a\\b"); },
+      [](File_system_emulator& fse) { fse.make_hlink("C:\\a", "C:\\a\\b"); },
+      [](File_system_emulator& fse) { fse.make_file("C:\\a\\b\\f1.txt"); },
+      [](File_system_emulator& fse) { fse.make_hlink("C:\\a\\b\\f1.txt", "C:"); },
+      [](File_system_emulator& fse) { fse.delete_tree("C:\\a"); },
+      [](File_system_emulator& fse) { fse.remove_file("C:\\hlink[C:\\a\\b\\f1.txt]"); },
+      [](File_system_emulator& fse) { fse.delete_tree("C:\\a"); },
+      [](File_system_emulator& fse) { fse.make_dir("C:\\a"); },
+      [](File_system_emulator& fse) { fse.make_hlink("C:\\a", "C:"); },
+      [](File_system_emulator& fse) { fse.delete_tree("C:\\a"); },
+  });
+}
+
+TEST(Node_table, Delete_tree_checks_in_the_order_of_the_default_storage)
+{
+  expect_same_trees({
+      [](File_system_emulator& fse) { fse.make_dir("C:\\a\\b"); },
+      [](File_system_emulator& fse) { fse.make_dir("C:\\a"); },
+      [](File_system_emulator& fse) { fse.make_dir("C:\\a\\b"); },
+      [](File_system_emulator& fse) { fse.make_file("C:\\a\\f1.txt"); },
+      [](File_system_emulator& fse) { fse.make_hlink("C:\\a\\f1.txt", "C:"); },
+      [](File_system_emulator& fse) { fse.change_dir("C:\\a\\b"); },
+      [](File_system_emulator& fse) { fse.delete_tree("C:\\a"); },
+      [](File_system_emulator& fse) { fse.remove_file("C:\\hlink[C:\\a\\f1.txt]"); },
+      [](File_system_emulator& fse) { fse.delete_tree("C:\\a"); },
+      [](File_system_emulator& fse) { fse.change_dir("C:"); },
+      [](File_system_emulator& fse) { fse.delete_tree("C:\\a"); },
+  });
+}
+
+TEST(Node_table, Recover_replays_the_journal)
+{
+  std::string path__ = testing::TempDir() + "node_table_journal.log";
+  std::remove(path__.c_str());
+
+  File_system_emulator fse__;
+  fse__.set_compact_storage(true);
+  fse__.open_journal(path__, 4);
+  fse__.make_dir("C:\\Dir1");
+  fse__.make_file("C:\\Dir1\\file1.txt");
+  fse__.change_dir("C:\\Dir1");
+  fse__.make_dlink("file1.txt", "C:");
+  fse__.copy("C:\\Dir1", "C:\\Dir1");
+  fse__.close_journal();
+
+  File_system_emulator recovered__;
+  recovered__.set_compact_storage(true);
+  ASSERT_NO_THROW(recovered__.recover("", path__));
+  EXPECT_EQ(print_to_string(recovered__), print_to_string(fse__));
+
+  File_system_emulator default__;
+  ASSERT_NO_THROW(default__.recover("", path__));
+  EXPECT_EQ(print_to_string(default__), print_to_string(fse__));
+
+  std::remove(path__.c_str());
+}
+
+TEST(Node_table, Stats_count_entities_of_the_table)
+{
+  File_system_emulator fse__;
+  fse__.set_compact_storage(true);
+  EXPECT_TRUE(fse__.is_compact_storage());
+
+  fse__.make_dir("C:\\Dir1");
+  fse__.make_dir("C:\\Dir1\\Dir2");
+  fse__.make_file("C:\\Dir1\\Dir2\\file1.txt");
+  fse__.make_hlink("C:\\Dir1\\Dir2\\file1.txt", "C:");
+  fse__.make_dlink("C:\\Dir1", "C:");
+
+  File_system_emulator::Stats stats__ = fse__.stats();
+
+  EXPECT_EQ(stats__.m_nodes[static_cast<std::size_t>(NODE_TYPE::DIRECTORY)], 3u);
+  EXPECT_EQ(stats__.m_nodes[static_cast<std::size_t>(NODE_TYPE::FILE)], 1u);
+  EXPECT_EQ(stats__.m_nodes[static_cast<std::size_t>(NODE_TYPE::HLINK)], 1u);
+  EXPECT_EQ(stats__.m_nodes[static_cast<std::size_t>(NODE_TYPE::DLINK)], 1u);
+  EXPECT_EQ(stats__.m_node_bytes, 6 * Node_table::NODE_BYTES);
+  EXPECT_EQ(stats__.m_max_depth, 3u);
+  EXPECT_EQ(stats__.m_fanout[File_system_emulator::fanout_bucket(0)], 0u);
+  EXPECT_EQ(stats__.m_fanout[File_system_emulator::fanout_bucket(1)], 2u);
+  EXPECT_EQ(stats__.m_fanout[File_system_emulator::fanout_bucket(3)], 1u);
+
+  // Slots of removed entities are reused.
+  fse__.remove_file("C:\\dlink[C:\\Dir1]");
+  fse__.make_file("C:\\file2.txt");
+  EXPECT_EQ(fse__.stats().m_node_bytes, 6 * Node_table::NODE_BYTES);
+  EXPECT_EQ(fse__.size(), 6u);
+}
+
+TEST(Node_table, Features_of_the_default_storage_throw)
+{
+  File_system_emulator fse__;
+  fse__.set_compact_storage(true);
+  fse__.make_dir("C:\\Dir1");
+
+  EXPECT_THROW(fse__.begin(), std::runtime_error);
+  EXPECT_THROW(fse__.publish_view(), std::runtime_error);
+  EXPECT_THROW(fse__.save_snapshot(testing::TempDir() + "node_table.snapshot"), std::runtime_error);
+  EXPECT_THROW(fse__.load_snapshot(testing::TempDir() + "node_table.snapshot"), std::runtime_error);
+
+  // Storage is chosen for an empty drive only, the tree is never converted.
+  EXPECT_THROW(fse__.set_compact_storage(false), std::runtime_error);
+  EXPECT_TRUE(fse__.is_compact_storage());
+
+  fse__.remove_dir("C:\\Dir1");
+  EXPECT_NO_THROW(fse__.set_compact_storage(false));
+  EXPECT_FALSE(fse__.is_compact_storage());
+  EXPECT_NO_THROW(fse__.make_dir("C:\\Dir1"));
+  EXPECT_EQ(print_to_string(fse__), "\nC:\n|_Dir1\n\n");
+}
+
+int
+main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include "path_cache.hpp"
+
+TEST(Path_cache, Invalidates_path_and_paths_below)
+{
+  Path_cache cache__;
+  File file1__, file2__, file3__, file4__;
+
+  cache__.insert("C:\\Dir1", &file1__);
+  cache__.insert("C:\\Dir1\\file.txt", &file2__);
+  cache__.insert("C:\\Dir1.txt", &file3__);
+  cache__.insert("C:\\Dir10", &file4__);
+
+  EXPECT_EQ(cache__.find("C:\\Dir1\\file.txt"), &file2__);
+  EXPECT_EQ(cache__.find("C:\\Dir2"), nullptr);
+
+  cache__.invalidate("C:\\Dir1");
+
+  EXPECT_EQ(cache__.find("C:\\Dir1"), nullptr);
+  EXPECT_EQ(cache__.find("C:\\Dir1\\file.txt"), nullptr);
+  EXPECT_EQ(cache__.find("C:\\Dir1.txt"), &file3__);
+  EXPECT_EQ(cache__.find("C:\\Dir10"), &file4__);
+
+  Path_cache::Stats stats__ = cache__.stats();
+
+  EXPECT_EQ(stats__.m_hits, 3);
+  EXPECT_EQ(stats__.m_misses, 3);
+  EXPECT_EQ(stats__.m_invalidated, 2);
+  EXPECT_EQ(stats__.m_size, 2);
+};
+
+TEST(Path_cache, Stays_within_capacity)
+{
+  Path_cache cache__{ 2 };
+  File file__;
+
+  cache__.insert("C:\\Dir1", &file__);
+  cache__.insert("C:\\Dir2", &file__);
+  cache__.insert("C:\\Dir3", &file__);
+
+  EXPECT_EQ(cache__.stats().m_size, 2);
+  EXPECT_EQ(cache__.stats().m_evicted, 1);
+  EXPECT_EQ(cache__.find("C:\\Dir1"), nullptr);
+  EXPECT_EQ(cache__.find("C:\\Dir3"), &file__);
+
+  cache__.set_capacity(0);
+  cache__.insert("C:\\Dir1", &file__);
+
+  EXPECT_EQ(cache__.find("C:\\Dir1"), nullptr);
+};
+
+TEST(Path_cache, Keeps_hitting_working_set_over_capacity)
+{
+  Path_cache cache__{ 100 };
+  File file__;
+
+  // Paths are resolved round after round, each miss is cached as resolution does.
+  for(int round__ = 0; round__ < 50; ++round__)
+    for(int i = 0; i < 110; ++i)
+      {
+        std::string path__ = "C:\\Dir" + std::to_string(i);
+
+        if(!cache__.find(path__))
+          cache__.insert(path__, &file__);
+      }
+
+  Path_cache::Stats stats__ = cache__.stats();
+
+  EXPECT_EQ(stats__.m_size, 100);
+  EXPECT_GT(stats__.m_hits, 4 * stats__.m_misses);
+};
+
+int
+main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,95 @@
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+#include "file_system_emulator.hpp"
+#include "profiler.hpp"
+
+TEST(Latency_histogram, Reports_percentiles_within_a_bucket)
+{
+  Latency_histogram histogram__;
+
+  EXPECT_EQ(histogram__.percentile(50), 0);
+
+  for(std::uint64_t i = 1; i <= 1000; ++i)
+    histogram__.record(i * 1000);
+
+  EXPECT_EQ(histogram__.count(), 1000);
+  EXPECT_EQ(histogram__.min(), 1000);
+  EXPECT_EQ(histogram__.max(), 1000000);
+  EXPECT_EQ(histogram__.total(), 500500000);
+
+  // A bucket spans at most 1/16 of its values, percentiles are rounded up to the end of theirs.
+  EXPECT_GE(histogram__.percentile(50), 500000);
+  EXPECT_LE(histogram__.percentile(50), 500000 + 500000 / 16);
+  EXPECT_GE(histogram__.percentile(99), 990000);
+  EXPECT_EQ(histogram__.percentile(100), 1000000);
+  EXPECT_EQ(histogram__.percentile(0), histogram__.percentile(0.01));
+
+  // Small values and the largest ones have buckets of their own.
+  Latency_histogram edges__;
+  edges__.record(0);
+  edges__.record(7);
+  edges__.record(UINT64_MAX);
+
+  EXPECT_EQ(edges__.percentile(30), 0);
+  EXPECT_EQ(edges__.percentile(60), 7);
+  EXPECT_EQ(edges__.percentile(100), UINT64_MAX);
+};
+
+TEST(Profiler, Writes_counters_and_run_operations)
+{
+  Profiler profiler__;
+  profiler__.count(PROFILE_COUNTER::PATH_SEGMENTS, 3);
+  profiler__.latencies(COMMAND_TYPE::MAKE_DIR).record(120);
+
+  std::ostringstream stream__;
+  profiler__.write_json(stream__);
+
+  std::string json__ = stream__.str();
+
+  EXPECT_NE(json__.find("\"path_segments\": 3"), std::string::npos);
+  EXPECT_NE(json__.find("\"child_comparisons\": 0"), std::string::npos);
+  EXPECT_NE(json__.find("\"MD\": { \"count\": 1, \"total\": 120, \"min\": 120"), std::string::npos);
+  EXPECT_EQ(json__.find("\"COPY\""), std::string::npos);
+  EXPECT_EQ(json__.find("\"print\""), std::string::npos);
+};
+
+#ifdef FSE_PROFILE
+TEST(Profiler, Counts_work_of_the_emulator)
+{
+  File_system_emulator fse__;
+  fse__.set_path_cache_capacity(0);
+
+  std::vector<Command> commands__{ parse_command("MD C:\\Dir1"),
+                                   parse_command("MD C:\\Dir2"),
+                                   parse_command("MF C:\\Dir1\\file1.txt"),
+                                   parse_command("MDL C:\\Dir1\\file1.txt C:"),
+                                   parse_command("COPY C:\\Dir1 C:\\Dir2"),
+                                   parse_command("DELTREE C:\\Dir1") };
+  fse__.apply_batch(commands__);
+
+  std::ostringstream stream__;
+  fse__.print(stream__);
+
+  const Profiler& profiler__ = fse__.profiler();
+
+  EXPECT_GT(profiler__.counter(PROFILE_COUNTER::PATH_SEGMENTS), 0);
+  EXPECT_GT(profiler__.counter(PROFILE_COUNTER::CHILD_COMPARISONS), 0);
+  // The link isn't below the copied directory, but it's deleted together with its target.
+  EXPECT_EQ(profiler__.counter(PROFILE_COUNTER::COPIED_NODES), 2);
+  EXPECT_EQ(profiler__.counter(PROFILE_COUNTER::DELETED_NODES), 3);
+  EXPECT_EQ(profiler__.counter(PROFILE_COUNTER::LINK_UPDATES), 1);
+  EXPECT_EQ(profiler__.counter(PROFILE_COUNTER::PRINTED_NODES), 4);
+  EXPECT_EQ(profiler__.latencies(COMMAND_TYPE::MAKE_DIR).count(), 2);
+  EXPECT_EQ(profiler__.latencies(COMMAND_TYPE::COPY).count(), 1);
+  EXPECT_EQ(profiler__.print_latencies().count(), 1);
+};
+#endif
+
+int
+main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
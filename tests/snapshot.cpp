@@ -0,0 +1,126 @@
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "file_system_emulator.hpp"
+#include "snapshot.hpp"
+#include "test_utils.hpp"
+
+TEST(Snapshot, Restores_tree_links_and_current_directory)
+{
+  std::string path__ = testing::TempDir() + "snapshot_restore.fse";
+  File_system_emulator fse__;
+
+  fse__.make_dir("C:\\Dir1");
+  fse__.make_dir("C:\\Dir1\\Dir2");
+  fse__.make_file("C:\\Dir1\\Dir2\\file1.txt");
+  fse__.make_dir("C:\\BDir1");
+  fse__.make_file("C:\\BDir1\\file2.txt");
+  fse__.make_dlink("C:\\BDir1\\file2.txt", "C:\\Dir1");
+  fse__.make_hlink("C:\\Dir1\\Dir2", "C:");
+  fse__.make_dir("C:\\Removed");
+  fse__.remove_dir("C:\\Removed");
+  fse__.change_dir("C:\\Dir1\\Dir2");
+
+  fse__.save_snapshot(path__);
+
+  File_system_emulator loaded__;
+  loaded__.make_dir("C:\\Stale");
+  ASSERT_NO_THROW(loaded__.load_snapshot(path__));
+
+  EXPECT_EQ(print_to_string(loaded__), print_to_string(fse__));
+  EXPECT_EQ(loaded__.names().find("Removed"), Name_table::npos);
+
+  // Current directory and link bookkeeping are restored as well.
+  EXPECT_NO_THROW(loaded__.make_file("file3.txt"));
+  EXPECT_THROW(loaded__.change_dir("C:\\Stale"), std::runtime_error);
+  EXPECT_THROW(loaded__.move("C:\\Dir1", "C:\\BDir1"), std::runtime_error);
+  EXPECT_NO_THROW(loaded__.remove_file("C:\\BDir1\\file2.txt"));
+  EXPECT_THROW(loaded__.change_dir("C:\\Dir1\\dlink[C:\\BDir1\\file2.txt]"), std::runtime_error);
+
+  std::remove(path__.c_str());
+}
+
+TEST(Snapshot, Rejects_invalid_snapshots)
+{
+  std::string path__ = testing::TempDir() + "snapshot_invalid.fse";
+  File_system_emulator fse__;
+
+  fse__.make_dir("C:\\Dir1");
+  fse__.make_dir("C:\\Dir2");
+  fse__.make_file("C:\\Dir1\\file1.txt");
+  fse__.make_file("C:\\Dir1\\file2.txt");
+  fse__.make_dlink("C:\\Dir1\\file1.txt", "C:");
+  fse__.make_dlink("C:\\Dir1\\file2.txt", "C:");
+  fse__.save_snapshot(path__);
+
+  std::string content__;
+
+  {
+    std::ifstream file__{ path__, std::ios::binary };
+    content__.assign(std::istreambuf_iterator<char>(file__), {});
+  }
+
+  File_system_emulator loaded__;
+  loaded__.make_dir("C:\\Kept");
+
+  auto expect_rejected__ = [&](const std::string& crafted) {
+    {
+      std::ofstream file__{ path__, std::ios::binary | std::ios::trunc };
+      file__.write(crafted.data(), crafted.size());
+    }
+
+    EXPECT_THROW(loaded__.load_snapshot(path__), std::runtime_error);
+  };
+
+  // Cut the last record off.
+  expect_rejected__(content__.substr(0, content__.size() - 1));
+  EXPECT_THROW(loaded__.load_snapshot(path__ + ".missing"), std::runtime_error);
+
+  // Records end the snapshot, children of the drive are the two directories and the two links.
+  Snapshot_header header__;
+  std::memcpy(&header__, content__.data(), sizeof(header__));
+
+  std::size_t records_offset__ = content__.size() - header__.m_nodes * sizeof(Snapshot_record);
+  std::vector<Snapshot_record> records__(header__.m_nodes);
+  std::memcpy(records__.data(), content__.data() + records_offset__, content__.size() - records_offset__);
+
+  std::vector<std::size_t> dirs__;
+  std::vector<std::size_t> links__;
+
+  for(std::size_t i = 1; i < records__.size(); ++i)
+    if(records__[i].m_parent == 0)
+      (records__[i].m_type == static_cast<std::uint32_t>(NODE_TYPE::DIRECTORY) ? dirs__ : links__).push_back(i);
+
+  ASSERT_EQ(dirs__.size(), 2u);
+  ASSERT_EQ(links__.size(), 2u);
+
+  auto with_value__ = [&](std::size_t index, std::uint32_t value) {
+    std::string crafted__ = content__;
+    std::memcpy(crafted__.data() + records_offset__ + index * sizeof(Snapshot_record)
+                    + offsetof(Snapshot_record, m_value),
+                &value, sizeof(value));
+    return crafted__;
+  };
+
+  // Two directories with the same name, two links to the same target, a directory with the empty name.
+  expect_rejected__(with_value__(dirs__[1], records__[dirs__[0]].m_value));
+  expect_rejected__(with_value__(links__[1], records__[links__[0]].m_value));
+  expect_rejected__(with_value__(dirs__[0], 0));
+
+  EXPECT_NO_THROW(loaded__.change_dir("C:\\Kept"));
+
+  std::remove(path__.c_str());
+}
+
+int
+main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,31 @@
+#ifndef __TEST_UTILS_HPP__
+#define __TEST_UTILS_HPP__
+
+#include <sstream>
+#include <string>
+
+#include "file_system_emulator.hpp"
+
+/**
+ * @brief Returns the structure of the file system as it's printed.
+ */
+inline std::string
+print_to_string(const File_system_emulator& fse)
+{
+  std::ostringstream stream__;
+  fse.print(stream__);
+  return stream__.str();
+}
+
+/**
+ * @brief Returns the structure of a view as it's printed.
+ */
+inline std::string
+print_to_string(const Tree_view& view)
+{
+  std::ostringstream stream__;
+  view.print(stream__);
+  return stream__.str();
+}
+
+#endif
@@ -0,0 +1,210 @@
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "file_system_emulator.hpp"
+#include "test_utils.hpp"
+
+TEST(Tree_view, Matches_the_tree_it_was_published_from)
+{
+  File_system_emulator fse__;
+  EXPECT_EQ(fse__.view(), nullptr);
+
+  fse__.make_dir("C:\\Dir1");
+  fse__.make_dir("C:\\Dir1\\Dir2");
+  fse__.make_dir("C:\\Dir1\\Dir3");
+  fse__.make_file("C:\\Dir1\\Dir2\\file1.txt");
+  fse__.make_file("C:\\Dir1\\a.txt");
+  fse__.make_dlink("C:\\Dir1\\Dir2\\file1.txt", "C:\\Dir1\\Dir3");
+  fse__.make_hlink("C:\\Dir1\\Dir2", "C:");
+  fse__.change_dir("C:\\Dir1");
+  fse__.publish_view();
+
+  std::shared_ptr<const Tree_view> view__ = fse__.view();
+  ASSERT_NE(view__, nullptr);
+  EXPECT_EQ(view__->size(), 8u);
+  EXPECT_EQ(print_to_string(*view__), print_to_string(fse__));
+
+  // Absolute and relative paths, paths through files and links.
+  ASSERT_NE(view__->find("C:\\Dir1\\Dir2\\file1.txt"), nullptr);
+  EXPECT_EQ(view__->find("C:\\Dir1\\Dir2\\file1.txt")->m_name, "file1.txt");
+  EXPECT_EQ(view__->find("Dir2\\file1.txt"), view__->find("C:\\Dir1\\Dir2\\file1.txt"));
+  EXPECT_EQ(view__->find(""), &view__->current());
+  EXPECT_EQ(view__->find("C:"), &view__->root());
+  EXPECT_EQ(view__->find("Dir2"), view__->find("C:\\Dir1\\Dir2"));
+  EXPECT_EQ(view__->current_path(), "C:\\Dir1");
+  ASSERT_NE(view__->find("C:\\hlink[C:\\Dir1\\Dir2]"), nullptr);
+  EXPECT_EQ(view__->find("C:\\hlink[C:\\Dir1\\Dir2]")->m_type, NODE_TYPE::HLINK);
+  EXPECT_EQ(view__->find("Dir3\\dlink[Dir2\\file1.txt]"), view__->find("C:\\Dir1\\Dir3\\dlink[C:\\Dir1\\Dir2\\file1.txt]"));
+  EXPECT_NE(view__->find("Dir3\\dlink[Dir2\\file1.txt]"), nullptr);
+  EXPECT_EQ(view__->find("C:\\Dir4"), nullptr);
+  EXPECT_EQ(view__->find("C:\\dlink[C:\\Dir1]"), nullptr);
+  EXPECT_EQ(view__->find("D:"), nullptr);
+
+  // Children are listed by name.
+  std::vector<std::string_view> names__;
+
+  for(const Tree_view::Entry& child__ : view__->childs(*view__->find("C:\\Dir1")))
+    names__.push_back(child__.m_name);
+
+  EXPECT_EQ(names__, (std::vector<std::string_view>{ "Dir2", "Dir3", "a.txt" }));
+
+  // Held view doesn't change until a new one is published.
+  std::string printed__ = print_to_string(*view__);
+  fse__.move("C:\\Dir1\\Dir3", "C:");
+  fse__.remove_file("C:\\Dir1\\a.txt");
+  EXPECT_EQ(print_to_string(*view__), printed__);
+  EXPECT_EQ(fse__.view(), view__);
+
+  fse__.publish_view();
+  EXPECT_GT(fse__.view()->version(), view__->version());
+  EXPECT_EQ(print_to_string(*fse__.view()), print_to_string(fse__));
+  EXPECT_NE(fse__.view()->find("C:\\Dir3\\dlink[C:\\Dir1\\Dir2\\file1.txt]"), nullptr);
+  EXPECT_EQ(fse__.view()->find("C:\\Dir1\\a.txt"), nullptr);
+  EXPECT_NE(view__->find("C:\\Dir1\\a.txt"), nullptr);
+}
+
+TEST(Tree_view, Follows_every_change_of_the_tree)
+{
+  // Moves rename links below the moved entity, removals leave dangling links behind, copies share children and
+  // rollback puts back what a transaction changed. Every view has to match the tree after each of them.
+  for(bool deferred__ : { false, true })
+    {
+      File_system_emulator fse__;
+      fse__.set_copy_on_write(true);
+      fse__.set_deferred_dlink_removal(deferred__);
+      fse__.publish_view();
+
+      for(std::string_view line__ : { "MD A", "MD A\\B", "MF A\\B\\f.txt", "MD D", "MD L", "MDL A\\B\\f.txt L",
+                                      "MHL D C:", "COPY A D", "MF D\\A\\B\\g.txt", "MOVE A\\B D", "CD D\\B",
+                                      "DEL C:\\D\\B\\f.txt", "BEGIN", "DELTREE C:\\D\\A", "MF C:\\D\\h.txt",
+                                      "ROLLBACK", "BEGIN", "MD C:\\D\\B\\E", "MOVE C:\\D\\A C:\\D\\B\\E", "COMMIT",
+                                      "COPY C:\\D C:\\A", "MF C:\\A\\D\\B\\E\\A\\x.txt", "CD C:\\A\\D" })
+        {
+          std::vector<Command> batch__{ parse_command(line__) };
+          EXPECT_NO_THROW(fse__.apply_batch(batch__)) << line__;
+
+          fse__.publish_view();
+          EXPECT_EQ(print_to_string(*fse__.view()), print_to_string(fse__)) << line__;
+          EXPECT_EQ(fse__.view()->find("")->m_type, NODE_TYPE::DIRECTORY) << line__;
+        }
+
+      // Batches sweep dangling links right away, a removal on its own leaves them to compact().
+      fse__.make_file("C:\\A\\y.txt");
+      fse__.make_dlink("C:\\A\\y.txt", "C:\\L");
+      fse__.begin();
+      fse__.remove_file("C:\\A\\y.txt");
+      fse__.publish_view();
+      EXPECT_EQ(print_to_string(*fse__.view()), print_to_string(fse__));
+
+      fse__.rollback();
+      fse__.publish_view();
+      EXPECT_EQ(print_to_string(*fse__.view()), print_to_string(fse__));
+
+      fse__.remove_file("C:\\A\\y.txt");
+      fse__.publish_view();
+      EXPECT_EQ(print_to_string(*fse__.view()), print_to_string(fse__));
+
+      fse__.compact();
+      fse__.publish_view();
+      EXPECT_EQ(print_to_string(*fse__.view()), print_to_string(fse__));
+      EXPECT_EQ(fse__.view()->current_path(), "C:\\A\\D");
+    }
+}
+
+TEST(Tree_view, Shares_unchanged_directories_with_the_previous_view)
+{
+  File_system_emulator fse__;
+  fse__.make_dir("C:\\Dir1");
+  fse__.make_dir("C:\\Dir1\\Dir2");
+  fse__.make_file("C:\\Dir1\\Dir2\\file1.txt");
+  fse__.make_dir("C:\\Dir3");
+  fse__.publish_view();
+
+  std::shared_ptr<const Tree_view> before__ = fse__.view();
+  std::string printed__ = print_to_string(*before__);
+
+  fse__.make_file("C:\\Dir3\\file2.txt");
+  fse__.publish_view();
+
+  std::shared_ptr<const Tree_view> after__ = fse__.view();
+
+  // Only the changed directory and its ancestors are listed again.
+  EXPECT_EQ(before__->find("C:\\Dir1")->m_listing, after__->find("C:\\Dir1")->m_listing);
+  EXPECT_NE(before__->find("C:\\Dir3")->m_listing, after__->find("C:\\Dir3")->m_listing);
+  EXPECT_NE(before__->root().m_listing, after__->root().m_listing);
+  EXPECT_EQ(print_to_string(*before__), printed__);
+  EXPECT_EQ(after__->size(), 6u);
+
+  // Nothing changed, so the whole tree is shared.
+  fse__.publish_view();
+  EXPECT_EQ(fse__.view()->root().m_listing, after__->root().m_listing);
+}
+
+TEST(Tree_view, Readers_see_consistent_views_during_mutation)
+{
+  constexpr std::size_t DIRS = 200;
+  constexpr std::size_t READERS = 4;
+
+  File_system_emulator fse__;
+  fse__.publish_view();
+
+  std::atomic<bool> done__{ false };
+  std::atomic<std::size_t> failures__{ 0 };
+  std::vector<std::thread> readers__;
+
+  // Every view has to be a prefix of the writer's progress: directories 0..n-1, each with its file.
+  for(std::size_t r = 0; r < READERS; ++r)
+    readers__.emplace_back([&fse__, &done__, &failures__]() {
+      std::shared_ptr<const Tree_view> view__ = fse__.view();
+      std::uint64_t last_version__ = view__->version();
+
+      while(!done__.load(std::memory_order_acquire))
+        {
+          if(fse__.refresh_view(view__) && view__->version() <= last_version__)
+            ++failures__;
+
+          last_version__ = view__->version();
+
+          std::size_t dirs__ = view__->childs(view__->root()).size();
+
+          if(view__->size() != 1 + 2 * dirs__)
+            ++failures__;
+
+          for(std::size_t i = 0; i < dirs__; ++i)
+            {
+              std::string path__ = "C:\\Dir" + std::to_string(i) + "\\file.txt";
+
+              if(view__->find(path__) == nullptr)
+                ++failures__;
+            }
+        }
+    });
+
+  for(std::size_t i = 0; i < DIRS; ++i)
+    {
+      std::string path__ = "C:\\Dir" + std::to_string(i);
+      fse__.make_dir(path__);
+      fse__.make_file(path__ + "\\file.txt");
+      fse__.publish_view();
+    }
+
+  done__.store(true, std::memory_order_release);
+
+  for(std::thread& reader__ : readers__)
+    reader__.join();
+
+  EXPECT_EQ(failures__.load(), 0u);
+  EXPECT_EQ(fse__.view()->childs(fse__.view()->root()).size(), DIRS);
+}
+
+int
+main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}